@@ -62,5 +62,41 @@ bool BmpSaveHandler::save(const FString &fileName, const Image &img)
 	return res;
 }
 
+uint32 BmpSaveHandler::getEncodedSize(const Image &img)
+{
+	const uint32 numPadding = (4 - (img.getWidth() * 3) % 4) % 4;
+	return sizeof(SBmpFileMagic) + sizeof(SBmpFileHeader) + sizeof(SBitmapInfoHeader) + (img.getWidth() * 3 + numPadding) * img.getHeight();
+}
+
+void BmpSaveHandler::encode(const Image &img, uint8 *dst)
+{
+	const int32 fileSize = static_cast<int> (img.getSizeInBytes());
+	const int32 width = static_cast<int> (img.getWidth());
+	const int32 height = static_cast<int> (img.getHeight());
+
+	SBmpFileMagic bm = { {'B', 'M'} };
+	SBmpFileHeader bh = { 54 + fileSize, 0, 0, 54 };
+	SBitmapInfoHeader bmpInfoHeader = { 40, width, height, 1, 24, 0, 0, 0, 0, 0, 0 };
+
+	FMemory::Memcpy(dst, &bm, sizeof(bm));
+	dst += sizeof(bm);
+	FMemory::Memcpy(dst, &bh, sizeof(bh));
+	dst += sizeof(bh);
+	FMemory::Memcpy(dst, &bmpInfoHeader, sizeof(bmpInfoHeader));
+	dst += sizeof(bmpInfoHeader);
+
+	// rows bottom up, each padded to a multiple of 4 bytes
+	const uint8 *data = img.getRawPtr<uint8>();
+	const uint32 rowSize = width * 3;
+	const uint32 numPadding = (4 - rowSize % 4) % 4;
+	for (signed i = height - 1; i >= 0; --i)
+	{
+		FMemory::Memcpy(dst, data + rowSize * i, rowSize);
+		dst += rowSize;
+		for (uint32 j = 0; j < numPadding; ++j)
+			*dst++ = 0;
+	}
+}
+
 
 }	//	namespace
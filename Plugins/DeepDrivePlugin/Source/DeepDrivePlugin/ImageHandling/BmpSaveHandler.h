@@ -48,6 +48,15 @@ public:
 
 	virtual bool save(const FString &fileName, const Image &img);
 
+	/**
+		Size of the file save() writes for img
+	*/
+	static uint32 getEncodedSize(const Image &img);
+
+	/**
+		Encode img into dst byte by byte like save() writes it, dst has to hold getEncodedSize(img) bytes
+	*/
+	static void encode(const Image &img, uint8 *dst);
 	
 };
 
@@ -5,6 +5,33 @@
 namespace deepdrive
 {
 
+/**
+	Tables holding the 8 bit value of every half float bit pattern, gamma 0.45 color and depth in cm scaled down from [0, 65535].
+	Entries are computed exactly like the former per pixel conversions, so images stay bit identical.
+*/
+struct SConversionLUTs
+{
+	SConversionLUTs()
+	{
+		for(uint32 i = 0; i < 65536; ++i)
+		{
+			FFloat16 value;
+			value.Encoded = static_cast<uint16> (i);
+			gamma[i] = static_cast<uint8> (FMath::Clamp( static_cast<float> (pow(value.GetFloat(), 0.45f)), 0.0f, 1.0f) * 255.0f);
+			depth[i] = static_cast<uint8> (FMath::Clamp(value.GetFloat() / 65535.0f, 0.0f, 1.0f) * 255.0f);
+		}
+	}
+
+	uint8	gamma[65536];
+	uint8	depth[65536];
+};
+
+static const SConversionLUTs& getConversionLUTs()
+{
+	static const SConversionLUTs luts;
+	return luts;
+}
+
 Image::~Image()
 {
 	delete[] m_Data;
@@ -30,20 +57,23 @@ bool Image::allocate(Format format, uint32 width, uint32 height)
 	return res;
 }
 
-void Image::storeAsRGB(const uint8 *src, uint32 width, uint32 height)
+void Image::storeAsRGB(const uint8 *src, uint32 width, uint32 height, uint32 srcStride)
 {
 	init(RGB, width, height);
 	m_Data = new uint8[m_SizeInBytes];
 
+	srcStride = srcStride ? srcStride : width * 4;
+
 	uint8 *ptr = reinterpret_cast<uint8*> (m_Data);
 	for(unsigned y = 0; y < height; ++y)
 	{
+		const uint8 *srcRow = src + y * srcStride;
 		for(unsigned x = 0; x < width; ++x)
 		{
-			*ptr++ = src[0];
-			*ptr++ = src[1];
-			*ptr++ = src[2];
-			src += 4;
+			*ptr++ = srcRow[0];
+			*ptr++ = srcRow[1];
+			*ptr++ = srcRow[2];
+			srcRow += 4;
 		}
 	}
 }
@@ -76,50 +106,49 @@ void Image::storeAsRGB(const TArray<FLinearColor> &src, uint32 width, uint32 hei
 	}
 }
 
-void Image::storeAsRGB(const FFloat16 *src, uint32 width, uint32 height)
+void Image::storeAsRGB(const FFloat16 *src, uint32 width, uint32 height, uint32 srcStride)
 {
 	init(RGB, width, height, 2);
 	m_Data = new uint8[m_SizeInBytes];
 
+	const uint8 *gammaLUT = getConversionLUTs().gamma;
+	srcStride = srcStride ? srcStride : width * 4 * sizeof(FFloat16);
+
 	uint8 *ptr = reinterpret_cast<uint8*> (m_Data);
-	for(unsigned y = 0; y < height; ++y)
+	for(uint32 y = 0; y < height; ++y)
 	{
-		for(unsigned x = 0; x < width; ++x)
+		const FFloat16 *srcRow = reinterpret_cast<const FFloat16*> (reinterpret_cast<const uint8*> (src) + y * srcStride);
+		for(uint32 x = 0; x < width; ++x)
 		{
-#if 1
-
-			*ptr++ = static_cast<uint8> (FMath::Clamp( static_cast<float> (pow(src[2].GetFloat(), 0.45f)), 0.0f, 1.0f) * 255.0f);
-			*ptr++ = static_cast<uint8> (FMath::Clamp( static_cast<float> (pow(src[1].GetFloat(), 0.45f)), 0.0f, 1.0f) * 255.0f);
-			*ptr++ = static_cast<uint8> (FMath::Clamp( static_cast<float> (pow(src[0].GetFloat(), 0.45f)), 0.0f, 1.0f) * 255.0f);
-
-			// *ptr++ = static_cast<uint8> (FMath::Clamp(src[2].GetFloat(), 0.0f, 1.0f) * 255.0f);
-			// *ptr++ = static_cast<uint8> (FMath::Clamp(src[2].GetFloat(), 0.0f, 1.0f) * 255.0f);
-			// *ptr++ = static_cast<uint8> (FMath::Clamp(src[2].GetFloat(), 0.0f, 1.0f) * 255.0f);
-
-#else
-			*ptr++ = static_cast<uint8> (FMath::Clamp(src[2].GetFloat(), 0.0f, 1.0f) * 255.0f);
-			*ptr++ = static_cast<uint8> (FMath::Clamp(src[2].GetFloat(), 0.0f, 1.0f) * 255.0f);
-			*ptr++ = static_cast<uint8> (FMath::Clamp(src[2].GetFloat(), 0.0f, 1.0f) * 255.0f);
-#endif
-			src += 4;
+			ptr[0] = gammaLUT[srcRow[2].Encoded];
+			ptr[1] = gammaLUT[srcRow[1].Encoded];
+			ptr[2] = gammaLUT[srcRow[0].Encoded];
+			ptr += 3;
+			srcRow += 4;
 		}
 	}
 }
 
-void Image::storeAsGreyscale(const FFloat16 *src, uint32 width, uint32 height)
+void Image::storeAsGreyscale(const FFloat16 *src, uint32 width, uint32 height, uint32 srcStride)
 {
 	init(RGB, width, height, 2);
 	m_Data = new uint8[m_SizeInBytes];
 
+	const uint8 *depthLUT = getConversionLUTs().depth;
+	srcStride = srcStride ? srcStride : width * 4 * sizeof(FFloat16);
+
 	uint8 *ptr = reinterpret_cast<uint8*> (m_Data);
-	for(unsigned y = 0; y < height; ++y)
+	for(uint32 y = 0; y < height; ++y)
 	{
-		for(unsigned x = 0; x < width; ++x)
+		const FFloat16 *srcRow = reinterpret_cast<const FFloat16*> (reinterpret_cast<const uint8*> (src) + y * srcStride);
+		for(uint32 x = 0; x < width; ++x)
 		{
-			*ptr++ = static_cast<uint8> (FMath::Clamp(src[3].GetFloat() / 65535.0f, 0.0f, 1.0f) * 255.0f);
-			*ptr++ = static_cast<uint8> (FMath::Clamp(src[3].GetFloat() / 65535.0f, 0.0f, 1.0f) * 255.0f);
-			*ptr++ = static_cast<uint8> (FMath::Clamp(src[3].GetFloat() / 65535.0f, 0.0f, 1.0f) * 255.0f);
-			src += 4;
+			const uint8 grey = depthLUT[srcRow[3].Encoded];
+			ptr[0] = grey;
+			ptr[1] = grey;
+			ptr[2] = grey;
+			ptr += 3;
+			srcRow += 4;
 		}
 	}
 }
@@ -20,13 +20,16 @@ public:
 
 	bool allocate(Format format, uint32 width, uint32 height);
 
-	void storeAsRGB(const uint8 *src, uint32 width, uint32 height);
+	/**
+		The raw source overloads read rows srcStride bytes apart, 0 for tightly packed rows
+	*/
+	void storeAsRGB(const uint8 *src, uint32 width, uint32 height, uint32 srcStride = 0);
 	void storeAsRGB(const TArray<FColor> &src, uint32 width, uint32 height);
 	void storeAsRGB(const TArray<FLinearColor> &src, uint32 width, uint32 height);
-	void storeAsRGB(const FFloat16 *src, uint32 width, uint32 height);
+	void storeAsRGB(const FFloat16 *src, uint32 width, uint32 height, uint32 srcStride = 0);
 	void storeAsRGBA(const TArray<FColor> &src, uint32 width, uint32 height);
 	void storeAsGreyscale(const TArray<FColor> &src, uint32 width, uint32 height);
-	void storeAsGreyscale(const FFloat16 *src, uint32 width, uint32 height);
+	void storeAsGreyscale(const FFloat16 *src, uint32 width, uint32 height, uint32 srcStride = 0);
 
 	uint32 getWidth() const;
 	uint32 getHeight() const;
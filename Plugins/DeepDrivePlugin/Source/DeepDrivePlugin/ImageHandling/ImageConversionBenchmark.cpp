@@ -0,0 +1,107 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "ImageHandling/Image.h"
+#include "Private/ConsoleBenchmark.h"
+
+/**
+	Per pixel conversions Image used before switching to lookup tables, kept as reference
+*/
+static void storeAsRGBReference(const FFloat16 *src, uint32 numPixels, uint8 *ptr)
+{
+	for(uint32 i = 0; i < numPixels; ++i)
+	{
+		*ptr++ = static_cast<uint8> (FMath::Clamp( static_cast<float> (pow(src[2].GetFloat(), 0.45f)), 0.0f, 1.0f) * 255.0f);
+		*ptr++ = static_cast<uint8> (FMath::Clamp( static_cast<float> (pow(src[1].GetFloat(), 0.45f)), 0.0f, 1.0f) * 255.0f);
+		*ptr++ = static_cast<uint8> (FMath::Clamp( static_cast<float> (pow(src[0].GetFloat(), 0.45f)), 0.0f, 1.0f) * 255.0f);
+		src += 4;
+	}
+}
+
+static void storeAsGreyscaleReference(const FFloat16 *src, uint32 numPixels, uint8 *ptr)
+{
+	for(uint32 i = 0; i < numPixels; ++i)
+	{
+		*ptr++ = static_cast<uint8> (FMath::Clamp(src[3].GetFloat() / 65535.0f, 0.0f, 1.0f) * 255.0f);
+		*ptr++ = static_cast<uint8> (FMath::Clamp(src[3].GetFloat() / 65535.0f, 0.0f, 1.0f) * 255.0f);
+		*ptr++ = static_cast<uint8> (FMath::Clamp(src[3].GetFloat() / 65535.0f, 0.0f, 1.0f) * 255.0f);
+		src += 4;
+	}
+}
+
+/**
+	Checks the lookup table based half float to 8 bit conversions of Image against the per pixel reference and measures both, run from the console with
+	DeepDrive.BenchmarkImageConversion [Width] [Height] [NumIterations]
+	Source data covers every half float bit pattern.
+*/
+static void benchmarkImageConversion(const TArray<FString> &args)
+{
+	ConsoleBenchmark benchmark(TEXT("DeepDrive.BenchmarkImageConversion"), args);
+	const uint32 width = benchmark.getIntArg(0, 1024);
+	const uint32 height = benchmark.getIntArg(1, 1024);
+	const int32 numIterations = benchmark.getIntArg(2, 10);
+	const uint32 numPixels = width * height;
+	const double megaPixels = numPixels / 1.0e6;
+
+	FRandomStream random(0x0DEE9D82);
+
+	TArray<FFloat16> src;
+	src.SetNumUninitialized(numPixels * 4);
+	for(uint32 i = 0; i < numPixels * 4; ++i)
+		src[i].Encoded = static_cast<uint16> (random.RandHelper(65536));
+
+	TArray<uint8> reference;
+	reference.SetNumZeroed(numPixels * 3);
+
+	int32 numMismatched = 0;
+	for(int32 greyscale = 0; greyscale < 2; ++greyscale)
+	{
+		benchmark.start();
+		for(int32 i = 0; i < numIterations; ++i)
+		{
+			if(greyscale)
+				storeAsGreyscaleReference(src.GetData(), numPixels, reference.GetData());
+			else
+				storeAsRGBReference(src.GetData(), numPixels, reference.GetData());
+		}
+		const double referenceDuration = benchmark.getElapsed();
+
+		// first conversion builds the tables
+		deepdrive::Image img;
+		if(greyscale)
+			img.storeAsGreyscale(src.GetData(), width, height);
+		else
+			img.storeAsRGB(src.GetData(), width, height);
+
+		benchmark.start();
+		for(int32 i = 0; i < numIterations; ++i)
+		{
+			deepdrive::Image curImg;
+			if(greyscale)
+				curImg.storeAsGreyscale(src.GetData(), width, height);
+			else
+				curImg.storeAsRGB(src.GetData(), width, height);
+		}
+		const double lutDuration = benchmark.getElapsed();
+
+		const deepdrive::Image &constImg = img;
+		const bool isEqual = FMemory::Memcmp(constImg.getRawPtr<uint8>(), reference.GetData(), reference.Num()) == 0;
+		if(!isEqual)
+			++numMismatched;
+
+		const double referenceMSPerMP = referenceDuration * 1000.0 / (megaPixels * numIterations);
+		const double lutMSPerMP = lutDuration * 1000.0 / (megaPixels * numIterations);
+		UE_LOG	(	LogDeepDriveBenchmark, Log, TEXT("%s: per pixel %.2f ms/MP, lookup table %.2f ms/MP, speedup %.1fx, %s")
+				,	greyscale ? TEXT("storeAsGreyscale") : TEXT("storeAsRGB")
+				,	referenceMSPerMP, lutMSPerMP, ConsoleBenchmark::getRate(referenceMSPerMP, lutMSPerMP)
+				,	isEqual ? TEXT("identical") : TEXT("MISMATCH")
+				);
+	}
+
+	benchmark.logResult(numMismatched == 0);
+}
+
+static FAutoConsoleCommand BenchmarkImageConversionCommand
+	(	TEXT("DeepDrive.BenchmarkImageConversion")
+	,	TEXT("Verify lookup table based half float image conversions against the per pixel ones and measure their speed. Arguments: [Width] [Height] [NumIterations]")
+	,	FConsoleCommandWithArgsDelegate::CreateStatic(&benchmarkImageConversion)
+	);
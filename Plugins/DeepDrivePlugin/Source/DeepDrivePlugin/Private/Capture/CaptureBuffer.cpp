@@ -2,41 +2,134 @@
 #include "DeepDrivePluginPrivatePCH.h"
 #include "Private/Capture/CaptureBuffer.h"
 #include "Private/Capture/CaptureBufferPool.h"
+#include "Private/Capture/CaptureBufferMemory.h"
 
-CaptureBuffer::CaptureBuffer(CaptureBufferPool &captureBufferPool, EPixelFormat pixelFormat, uint32 width, uint32 height, uint32 stride)
-	:	m_CaptureBufferPool(captureBufferPool)
+CaptureBuffer::CaptureBuffer(CaptureBufferPool &captureBufferPool, EPixelFormat pixelFormat, uint32 width, uint32 height, uint32 stride, uint32 depthStride)
+	:	m_CaptureBufferPool(&captureBufferPool)
 	,	m_PixelFormat(pixelFormat)
 	,	m_Width(width)
 	,	m_Height(height)
 	,	m_Stride(stride)
+	,	m_DepthStride(depthStride)
+	,	m_BufferSize((stride + depthStride) * height)
 {
+	m_NumReferences.Set(1);
 }
 
-void CaptureBuffer::initialize(EPixelFormat pixelFormat, uint32 width, uint32 height, uint32 stride)
+CaptureBuffer::~CaptureBuffer()
+{
+	// views only reference the memory of their parent
+	if(m_Parent == 0)
+		freeMemory();
+}
+
+CaptureBuffer::CaptureBuffer()
+{
+}
+
+void CaptureBuffer::initializeView(CaptureBuffer &parent, uint32 x, uint32 y, uint32 width, uint32 height)
+{
+	m_CaptureBufferPool = parent.m_CaptureBufferPool;
+	m_Parent = &parent;
+	m_PixelFormat = parent.m_PixelFormat;
+	m_Width = width;
+	m_Height = height;
+	m_Stride = parent.m_Stride;
+	m_DepthStride = 0;
+	m_NumReferences.Set(1);
+
+	const uint32 bytesPerPixel = GPixelFormats[m_PixelFormat].BlockBytes;
+	m_Buffer = reinterpret_cast<uint8*> (parent.m_Buffer) + y * m_Stride + x * bytesPerPixel;
+	m_BufferSize = m_Stride * (height - 1) + width * bytesPerPixel;
+
+	m_RegionOffset = FIntPoint(0, 0);
+	m_DownscaleFactor = 1;
+	m_ColorFormat = EDeepDriveCaptureColorFormat::Default;
+	m_DepthFormat = EDeepDriveCaptureDepthFormat::Default;
+}
+
+void CaptureBuffer::reset()
+{
+	// views don't own their memory, so the destructor of a pooled view has nothing to free
+	m_Parent = 0;
+	m_Buffer = 0;
+}
+
+void CaptureBuffer::initialize(EPixelFormat pixelFormat, uint32 width, uint32 height, uint32 stride, uint32 depthStride)
 {
 	m_PixelFormat = pixelFormat;
 	m_Width = width;
 	m_Height = height;
 	m_Stride = stride;
+	m_DepthStride = depthStride;
+	m_BufferSize = (stride + depthStride) * height;
+	m_NumViews.Set(0);
+	m_NumReferences.Set(1);
+	m_RegionOffset = FIntPoint(0, 0);
+	m_DownscaleFactor = 1;
+	m_ColorFormat = EDeepDriveCaptureColorFormat::Default;
+	m_DepthFormat = EDeepDriveCaptureDepthFormat::Default;
 }
 
-bool CaptureBuffer::allocate()
+bool CaptureBuffer::allocate(uint32 capacity, EDeepDriveCaptureBufferMemory memoryMode, const CaptureBufferAllocatorPtr &allocator)
 {
 	bool allocated = false;
 
-	const uint32 bufferSize = m_Stride * m_Height;
-	m_Buffer = FMemory::Malloc(bufferSize, 4);
+	m_Buffer = allocator.IsValid() ? allocator->allocate(capacity) : CaptureBufferMemory::allocate(capacity, memoryMode);
 	if(m_Buffer)
 	{
 		allocated = true;
-		m_BufferSize = bufferSize;
+		m_Capacity = capacity;
+		m_MemoryMode = memoryMode;
+		m_Allocator = allocator;
 	}
 	return allocated;
 }
 
+void CaptureBuffer::addReference()
+{
+	m_NumReferences.Increment();
+}
+
 void CaptureBuffer::release()
 {
-	m_CaptureBufferPool.release(*this);
+	if(m_NumReferences.Decrement() > 0)
+		return;
+
+	if(m_Parent)
+	{
+		// the view may be reused by another thread as soon as it is back in the pool
+		CaptureBuffer *parent = m_Parent;
+		m_CaptureBufferPool->m_ViewPool.release(this);
+		parent->releaseView();
+	}
+	else
+		m_CaptureBufferPool->release(*this);
+}
+
+CaptureBuffer* CaptureBuffer::createView(uint32 x, uint32 y, uint32 width, uint32 height)
+{
+	m_NumViews.Increment();
+	CaptureBuffer *view = m_CaptureBufferPool->m_ViewPool.acquire();
+	view->initializeView(*this, x, y, width, height);
+	return view;
+}
+
+void CaptureBuffer::releaseView()
+{
+	if(m_NumViews.Decrement() == 0)
+		m_CaptureBufferPool->release(*this);
+}
+
+void CaptureBuffer::freeMemory()
+{
+	if(m_Allocator.IsValid())
+		m_Allocator->free(m_Buffer, m_Capacity);
+	else
+		CaptureBufferMemory::free(m_Buffer, m_Capacity, m_MemoryMode);
+	m_Allocator.Reset();
+	m_Buffer = 0;
+	m_Capacity = 0;
 }
 
 CaptureBuffer::DataType CaptureBuffer::getDataType() const
@@ -2,8 +2,11 @@
 #pragma once
 
 #include "Engine.h"
+#include "Public/Capture/CaptureDefines.h"
+#include "Private/Capture/ICaptureBufferAllocator.h"
 
 class CaptureBufferPool;
+template<typename T> class CaptureObjectPool;
 
 class CaptureBuffer
 {
@@ -17,37 +20,118 @@ public:
 		Float32
 	};
 
-	CaptureBuffer(CaptureBufferPool &captureBufferPool, EPixelFormat pixelFormat, uint32 width, uint32 height, uint32 stride);
+	CaptureBuffer(CaptureBufferPool &captureBufferPool, EPixelFormat pixelFormat, uint32 width, uint32 height, uint32 stride, uint32 depthStride = 0);
+	~CaptureBuffer();
 
-	void initialize(EPixelFormat pixelFormat, uint32 width, uint32 height, uint32 stride);
+	void initialize(EPixelFormat pixelFormat, uint32 width, uint32 height, uint32 stride, uint32 depthStride = 0);
 
-	bool allocate();
+	/**
+		Allocate capacity bytes, data of any size up to capacity can be stored afterwards
+	*/
+	bool allocate(uint32 capacity, EDeepDriveCaptureBufferMemory memoryMode = EDeepDriveCaptureBufferMemory::Default, const CaptureBufferAllocatorPtr &allocator = CaptureBufferAllocatorPtr());
 
+	/**
+		Keep buffer alive beyond the next release, every call requires an additional call to release
+	*/
+	void addReference();
+
+	/**
+		Drop a reference, the buffer is returned to its pool once the last reference has been dropped
+	*/
 	void release();
 
+	/**
+		Create a view onto a region of this buffer. Views share the memory of this buffer,
+		which is returned to its pool once all of its views have been released.
+		View objects are recycled by the pool, so creating one per frame doesn't allocate.
+	*/
+	CaptureBuffer* createView(uint32 x, uint32 y, uint32 width, uint32 height);
+
 	template<class T>
 	T* getBuffer();
 	template<class T>
 	const T* getBuffer() const;
 
+	/**
+		Separate depth plane following the color data, only present for packed captures
+	*/
+	template<class T>
+	T* getDepthBuffer();
+	template<class T>
+	const T* getDepthBuffer() const;
+
 	EPixelFormat getPixelFormat() const;
 	uint32 getWidth() const;
 	uint32 getHeight() const;
 	uint32 getStride() const;
+	uint32 getDepthStride() const;
 	uint32 getBufferSize() const;
+	uint32 getCapacity() const;
 
 	DataType getDataType() const;
 
+	/**
+		Geometry of the captured data relative to the full render target
+	*/
+	void setSourceGeometry(const FIntPoint &regionOffset, uint32 downscaleFactor);
+	const FIntPoint& getRegionOffset() const;
+	uint32 getDownscaleFactor() const;
+
+	/**
+		Formats sinks convert this capture into
+	*/
+	void setOutputFormat(EDeepDriveCaptureColorFormat colorFormat, EDeepDriveCaptureDepthFormat depthFormat);
+	EDeepDriveCaptureColorFormat getColorFormat() const;
+	EDeepDriveCaptureDepthFormat getDepthFormat() const;
+
 private:
 
-	CaptureBufferPool		&m_CaptureBufferPool;
+	friend class CaptureBufferPool;
+	friend class CaptureObjectPool<CaptureBuffer>;
+
+	/**
+		View objects are default constructed by the view pool and set up by initializeView
+	*/
+	CaptureBuffer();
+
+	void initializeView(CaptureBuffer &parent, uint32 x, uint32 y, uint32 width, uint32 height);
+
+	/**
+		Clear a released view for reuse
+	*/
+	void reset();
+
+	void releaseView();
+
+	void freeMemory();
+
+	CaptureBufferPool		*m_CaptureBufferPool = 0;
+
+	CaptureBuffer			*m_Parent = 0;
+	FThreadSafeCounter		m_NumViews;
+	FThreadSafeCounter		m_NumReferences;
 
 	void					*m_Buffer = 0;
 	EPixelFormat			m_PixelFormat = PF_Unknown;
 	uint32					m_Width = 0;
 	uint32					m_Height = 0;
 	uint32					m_Stride = 0;
+	uint32					m_DepthStride = 0;
 	uint32					m_BufferSize = 0;
+	uint32					m_Capacity = 0;
+	EDeepDriveCaptureBufferMemory	m_MemoryMode = EDeepDriveCaptureBufferMemory::Default;
+	CaptureBufferAllocatorPtr		m_Allocator;
+
+	// intrusive free list link and size class, owned by CaptureBufferPool
+	uint32					m_PoolIndex = 0;
+	uint32					m_SizeClass = 0;
+	uint32					m_NextFree = 0;
+
+	FIntPoint				m_RegionOffset = FIntPoint(0, 0);
+	uint32					m_DownscaleFactor = 1;
+
+	EDeepDriveCaptureColorFormat	m_ColorFormat = EDeepDriveCaptureColorFormat::Default;
+	EDeepDriveCaptureDepthFormat	m_DepthFormat = EDeepDriveCaptureDepthFormat::Default;
 
 };
 
@@ -63,6 +147,18 @@ inline const T* CaptureBuffer::getBuffer() const
 	return reinterpret_cast<const T*> (m_Buffer);
 }
 
+template<class T>
+inline T* CaptureBuffer::getDepthBuffer()
+{
+	return m_DepthStride > 0 ? reinterpret_cast<T*> (reinterpret_cast<uint8*> (m_Buffer) + m_Stride * m_Height) : 0;
+}
+
+template<class T>
+inline const T* CaptureBuffer::getDepthBuffer() const
+{
+	return m_DepthStride > 0 ? reinterpret_cast<const T*> (reinterpret_cast<const uint8*> (m_Buffer) + m_Stride * m_Height) : 0;
+}
+
 inline EPixelFormat CaptureBuffer::getPixelFormat() const
 {
 	return m_PixelFormat;
@@ -83,7 +179,49 @@ inline uint32 CaptureBuffer::getStride() const
 	return m_Stride;
 }
 
+inline uint32 CaptureBuffer::getDepthStride() const
+{
+	return m_DepthStride;
+}
+
+inline void CaptureBuffer::setSourceGeometry(const FIntPoint &regionOffset, uint32 downscaleFactor)
+{
+	m_RegionOffset = regionOffset;
+	m_DownscaleFactor = downscaleFactor;
+}
+
+inline const FIntPoint& CaptureBuffer::getRegionOffset() const
+{
+	return m_RegionOffset;
+}
+
+inline uint32 CaptureBuffer::getDownscaleFactor() const
+{
+	return m_DownscaleFactor;
+}
+
+inline void CaptureBuffer::setOutputFormat(EDeepDriveCaptureColorFormat colorFormat, EDeepDriveCaptureDepthFormat depthFormat)
+{
+	m_ColorFormat = colorFormat;
+	m_DepthFormat = depthFormat;
+}
+
+inline EDeepDriveCaptureColorFormat CaptureBuffer::getColorFormat() const
+{
+	return m_ColorFormat;
+}
+
+inline EDeepDriveCaptureDepthFormat CaptureBuffer::getDepthFormat() const
+{
+	return m_DepthFormat;
+}
+
 inline uint32 CaptureBuffer::getBufferSize() const
 {
 	return m_BufferSize;
 }
+
+inline uint32 CaptureBuffer::getCapacity() const
+{
+	return m_Capacity;
+}
@@ -0,0 +1,113 @@
+
+#pragma once
+
+#include "Private/Capture/CaptureBuffer.h"
+
+/**
+	Shared ownership of a capture buffer handed to sinks. Every lease holds a reference on the buffer,
+	which returns to its pool once the last reference has been dropped.
+*/
+class CaptureBufferLease
+{
+public:
+
+	CaptureBufferLease()
+		{	}
+
+	explicit CaptureBufferLease(CaptureBuffer &captureBuffer);
+
+	CaptureBufferLease(const CaptureBufferLease &other);
+
+	CaptureBufferLease(CaptureBufferLease &&other);
+
+	~CaptureBufferLease();
+
+	CaptureBufferLease& operator=(const CaptureBufferLease &other);
+
+	CaptureBufferLease& operator=(CaptureBufferLease &&other);
+
+	void reset();
+
+	CaptureBuffer* get() const;
+
+	CaptureBuffer* operator->() const;
+
+	bool isValid() const;
+
+private:
+
+	CaptureBuffer			*m_CaptureBuffer = 0;
+
+};
+
+
+inline CaptureBufferLease::CaptureBufferLease(CaptureBuffer &captureBuffer)
+	:	m_CaptureBuffer(&captureBuffer)
+{
+	m_CaptureBuffer->addReference();
+}
+
+inline CaptureBufferLease::CaptureBufferLease(const CaptureBufferLease &other)
+	:	m_CaptureBuffer(other.m_CaptureBuffer)
+{
+	if(m_CaptureBuffer)
+		m_CaptureBuffer->addReference();
+}
+
+inline CaptureBufferLease::CaptureBufferLease(CaptureBufferLease &&other)
+	:	m_CaptureBuffer(other.m_CaptureBuffer)
+{
+	other.m_CaptureBuffer = 0;
+}
+
+inline CaptureBufferLease::~CaptureBufferLease()
+{
+	reset();
+}
+
+inline CaptureBufferLease& CaptureBufferLease::operator=(const CaptureBufferLease &other)
+{
+	if(other.m_CaptureBuffer != m_CaptureBuffer)
+	{
+		reset();
+		m_CaptureBuffer = other.m_CaptureBuffer;
+		if(m_CaptureBuffer)
+			m_CaptureBuffer->addReference();
+	}
+	return *this;
+}
+
+inline CaptureBufferLease& CaptureBufferLease::operator=(CaptureBufferLease &&other)
+{
+	if(&other != this)
+	{
+		reset();
+		m_CaptureBuffer = other.m_CaptureBuffer;
+		other.m_CaptureBuffer = 0;
+	}
+	return *this;
+}
+
+inline void CaptureBufferLease::reset()
+{
+	if(m_CaptureBuffer)
+	{
+		m_CaptureBuffer->release();
+		m_CaptureBuffer = 0;
+	}
+}
+
+inline CaptureBuffer* CaptureBufferLease::get() const
+{
+	return m_CaptureBuffer;
+}
+
+inline CaptureBuffer* CaptureBufferLease::operator->() const
+{
+	return m_CaptureBuffer;
+}
+
+inline bool CaptureBufferLease::isValid() const
+{
+	return m_CaptureBuffer != 0;
+}
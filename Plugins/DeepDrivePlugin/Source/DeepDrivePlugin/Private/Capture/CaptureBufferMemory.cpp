@@ -0,0 +1,131 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/Capture/CaptureBufferMemory.h"
+
+#if defined(DEEPDRIVE_PLATFORM_LINUX)
+#include <sys/mman.h>
+#include <errno.h>
+#elif defined(DEEPDRIVE_PLATFORM_WINDOWS)
+#include <windows.h>
+#endif
+
+DEFINE_LOG_CATEGORY(LogCaptureBufferMemory);
+
+void* CaptureBufferMemory::allocate(uint32 size, EDeepDriveCaptureBufferMemory memoryMode)
+{
+	void *buffer = 0;
+	if(memoryMode == EDeepDriveCaptureBufferMemory::Default)
+		buffer = FMemory::Malloc(size, Alignment);
+	else
+		buffer = mapPages(getMappedSize(size, memoryMode), memoryMode);
+	return buffer;
+}
+
+void CaptureBufferMemory::free(void *buffer, uint32 size, EDeepDriveCaptureBufferMemory memoryMode)
+{
+	if(buffer)
+	{
+		if(memoryMode == EDeepDriveCaptureBufferMemory::Default)
+			FMemory::Free(buffer);
+		else
+			unmapPages(buffer, getMappedSize(size, memoryMode));
+	}
+}
+
+uint64 CaptureBufferMemory::getMappedSize(uint32 size, EDeepDriveCaptureBufferMemory memoryMode)
+{
+	const uint64 pageSize = memoryMode == EDeepDriveCaptureBufferMemory::HugePages ? HugePageSize : FPlatformMemory::GetConstants().PageSize;
+	return Align(static_cast<uint64> (size), pageSize);
+}
+
+#if defined(DEEPDRIVE_PLATFORM_LINUX)
+
+void* CaptureBufferMemory::mapPages(uint64 mappedSize, EDeepDriveCaptureBufferMemory memoryMode)
+{
+	void *buffer = MAP_FAILED;
+
+	// MAP_POPULATE pre-faults all pages so the first copy into the buffer doesn't take page faults
+	if(memoryMode == EDeepDriveCaptureBufferMemory::HugePages)
+	{
+		buffer = mmap(0, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+		if(buffer == MAP_FAILED)
+			UE_LOG(LogCaptureBufferMemory, Log, TEXT("No huge pages available for %llu bytes (errno %d), using transparent huge pages"), mappedSize, errno);
+	}
+
+	if(buffer == MAP_FAILED)
+	{
+		buffer = mmap(0, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | (memoryMode == EDeepDriveCaptureBufferMemory::HugePages ? 0 : MAP_POPULATE), -1, 0);
+		if	(	buffer != MAP_FAILED
+			&&	memoryMode == EDeepDriveCaptureBufferMemory::HugePages
+			)
+		{
+			// advise before populating so the kernel can back the range with transparent huge pages right away
+			madvise(buffer, mappedSize, MADV_HUGEPAGE);
+			FMemory::Memzero(buffer, mappedSize);
+		}
+	}
+
+	if(buffer == MAP_FAILED)
+	{
+		UE_LOG(LogCaptureBufferMemory, Error, TEXT("Mapping %llu bytes failed with errno %d"), mappedSize, errno);
+		buffer = 0;
+	}
+
+	return buffer;
+}
+
+void CaptureBufferMemory::unmapPages(void *buffer, uint64 mappedSize)
+{
+	munmap(buffer, mappedSize);
+}
+
+#elif defined(DEEPDRIVE_PLATFORM_WINDOWS)
+
+void* CaptureBufferMemory::mapPages(uint64 mappedSize, EDeepDriveCaptureBufferMemory memoryMode)
+{
+	void *buffer = 0;
+
+	// large pages require the SeLockMemoryPrivilege, they are always committed and locked
+	if	(	memoryMode == EDeepDriveCaptureBufferMemory::HugePages
+		&&	GetLargePageMinimum() > 0
+		)
+	{
+		buffer = VirtualAlloc(0, Align(mappedSize, static_cast<uint64> (GetLargePageMinimum())), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if(buffer == 0)
+			UE_LOG(LogCaptureBufferMemory, Log, TEXT("No large pages available for %llu bytes (error %d), using regular pages"), mappedSize, GetLastError());
+	}
+
+	if(buffer == 0)
+	{
+		buffer = VirtualAlloc(0, mappedSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		// touch all pages once so the first copy into the buffer doesn't take page faults
+		if(buffer)
+			FMemory::Memzero(buffer, mappedSize);
+		else
+			UE_LOG(LogCaptureBufferMemory, Error, TEXT("Allocating %llu bytes failed with error %d"), mappedSize, GetLastError());
+	}
+
+	return buffer;
+}
+
+void CaptureBufferMemory::unmapPages(void *buffer, uint64 mappedSize)
+{
+	VirtualFree(buffer, 0, MEM_RELEASE);
+}
+
+#else
+
+void* CaptureBufferMemory::mapPages(uint64 mappedSize, EDeepDriveCaptureBufferMemory memoryMode)
+{
+	void *buffer = FMemory::Malloc(mappedSize, FPlatformMemory::GetConstants().PageSize);
+	if(buffer)
+		FMemory::Memzero(buffer, mappedSize);
+	return buffer;
+}
+
+void CaptureBufferMemory::unmapPages(void *buffer, uint64 mappedSize)
+{
+	FMemory::Free(buffer);
+}
+
+#endif
@@ -0,0 +1,39 @@
+
+#pragma once
+
+#include "Engine.h"
+#include "Public/Capture/CaptureDefines.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogCaptureBufferMemory, Log, All);
+
+/**
+	Allocates backing storage for capture buffers.
+	Default uses the engine allocator with cache line alignment, PageAligned maps pre-faulted pages directly from the OS
+	and HugePages additionally tries to back the buffer with 2 MB pages, falling back to regular pages if none are available.
+*/
+class CaptureBufferMemory
+{
+public:
+
+	enum
+	{
+		Alignment = 64,
+		HugePageSize = 2 * 1024 * 1024
+	};
+
+	static void* allocate(uint32 size, EDeepDriveCaptureBufferMemory memoryMode);
+
+	/**
+		size and memoryMode must match the values passed to allocate
+	*/
+	static void free(void *buffer, uint32 size, EDeepDriveCaptureBufferMemory memoryMode);
+
+private:
+
+	static uint64 getMappedSize(uint32 size, EDeepDriveCaptureBufferMemory memoryMode);
+
+	static void* mapPages(uint64 mappedSize, EDeepDriveCaptureBufferMemory memoryMode);
+
+	static void unmapPages(void *buffer, uint64 mappedSize);
+
+};
@@ -5,71 +5,335 @@
 
 DEFINE_LOG_CATEGORY(LogCaptureBufferPool);
 
-CaptureBuffer* CaptureBufferPool::acquire(EPixelFormat pixelFormat, uint32 width, uint32 height, uint32 stride)
+CaptureBufferPool::CaptureBufferPool()
+{
+	for(uint32 i = 0; i < NumSizeClasses; ++i)
+	{
+		m_FreeLists[i] = 0;
+		m_PeakInUseBuffers[i] = 0;
+		m_ReservedBuffers[i] = 0;
+		m_LastAcquireTime[i] = 0.0;
+	}
+	FMemory::Memzero(m_Buffers, sizeof(m_Buffers));
+}
+
+CaptureBufferPool::~CaptureBufferPool()
+{
+	const int32 numBuffers = FMath::Min(m_NumBuffers.GetValue(), static_cast<int32> (MaxBuffers));
+	for(int32 i = 0; i < numBuffers; ++i)
+		delete m_Buffers[i];
+}
+
+CaptureBuffer* CaptureBufferPool::acquire(EPixelFormat pixelFormat, uint32 width, uint32 height, uint32 stride, uint32 depthStride)
 {
 	CaptureBuffer *captureBuffer = 0;
-	const uint32 bufferSize = stride * height;
+	const uint64 bufferSize = static_cast<uint64> (stride + depthStride) * height;
+
+	if(bufferSize <= MaxBufferSize)
+	{
+		const uint32 sizeClass = getSizeClass(static_cast<uint32> (bufferSize));
+
+		captureBuffer = pop(sizeClass);
+		if(captureBuffer == 0)
+			captureBuffer = allocate(sizeClass);
+
+		if(captureBuffer)
+		{
+			captureBuffer->initialize(pixelFormat, width, height, stride, depthStride);
+			m_UsedBytes.Add(captureBuffer->m_Capacity);
+			m_LastAcquireTime[sizeClass] = FPlatformTime::Seconds();
+			updatePeakInUse(sizeClass, m_InUseBuffers[sizeClass].Increment());
+		}
+	}
+	else
+	{
+		m_AllocationFailures.Increment();
+		UE_LOG(LogCaptureBufferPool, Error, TEXT("Buffer size %llu exceeds maximum size"), bufferSize);
+	}
+
+	return captureBuffer;
+}
+
+void CaptureBufferPool::release(CaptureBuffer &buffer)
+{
+	m_UsedBytes.Subtract(buffer.m_Capacity);
+	m_InUseBuffers[buffer.m_SizeClass].Decrement();
+
+	if(buffer.m_Allocator.Get() == m_CurrentAllocator)
+		push(buffer);
+	else
+		discard(buffer);
+}
+
+void CaptureBufferPool::setAllocator(const CaptureBufferAllocatorPtr &allocator)
+{
+	FScopeLock lock(&m_AllocationMutex);
 
-	m_Mutex.Lock();
-	if(!m_BufferSlots.Contains(bufferSize))
+	if(allocator != m_Allocator)
 	{
-		m_BufferSlots.Add(bufferSize, SBufferSlot());
+		m_Allocator = allocator;
+		FPlatformAtomics::InterlockedExchangePtr(reinterpret_cast<void* volatile*> (&m_CurrentAllocator), allocator.Get());
+
+		for(uint32 i = 0; i < NumSizeClasses; ++i)
+		{
+			freeAvailable(i, m_AllocatedBuffers[i].GetValue());
+			prewarm(i);
+		}
+
+		UE_LOG(LogCaptureBufferPool, Log, TEXT("Capture buffer allocator %s"), allocator.IsValid() ? TEXT("set") : TEXT("removed"));
 	}
+}
+
+void CaptureBufferPool::trim(double idleTime)
+{
+	const double now = FPlatformTime::Seconds();
+
+	FScopeLock lock(&m_AllocationMutex);
 
-	SBufferSlot &bufferSlot = m_BufferSlots[bufferSize];
-	if(bufferSlot.available_buffers.Num() > 0)
+	uint64 trimmedBytes = 0;
+	for(uint32 i = 0; i < NumSizeClasses; ++i)
 	{
-		captureBuffer = bufferSlot.available_buffers.Pop();
-		bufferSlot.used_buffers.Push(captureBuffer);
+		const int32 numAllocated = m_AllocatedBuffers[i].GetValue();
+		if(numAllocated > 0)
+		{
+			const int32 numInUse = m_InUseBuffers[i].GetValue();
+			const bool isIdle = idleTime > 0.0 && now - m_LastAcquireTime[i] >= idleTime;
+			// keep as many buffers as were in use at the same time since the last trim, but never less than reserved
+			const int32 numToKeep = FMath::Max(isIdle ? 0 : FMath::Max(static_cast<int32> (m_PeakInUseBuffers[i]), numInUse), m_ReservedBuffers[i]);
+
+			if(numAllocated > numToKeep)
+				trimmedBytes += freeAvailable(i, numAllocated - numToKeep);
 
-		captureBuffer->initialize(pixelFormat, width, height, stride);
+			FPlatformAtomics::InterlockedExchange(&m_PeakInUseBuffers[i], numInUse);
+		}
 	}
-	else
+
+	if(trimmedBytes > 0)
+		UE_LOG(LogCaptureBufferPool, Log, TEXT("Trimmed %llu bytes, %llu bytes remain allocated"), trimmedBytes, m_AllocatedBytes);
+}
+
+void CaptureBufferPool::getStatistics(SCaptureBufferPoolStatistics &statistics)
+{
+	FScopeLock lock(&m_AllocationMutex);
+
+	statistics.allocated_bytes = m_AllocatedBytes;
+	statistics.used_bytes = getUsedBytes();
+	statistics.peak_allocated_bytes = m_PeakAllocatedBytes;
+	statistics.max_allocated_bytes = m_MaxAllocatedBytes;
+	statistics.allocation_failures = static_cast<uint32> (m_AllocationFailures.GetValue());
+	statistics.trimmed_bytes = m_TrimmedBytes;
+
+	statistics.slots.Reset();
+	for(uint32 i = 0; i < NumSizeClasses; ++i)
 	{
-		captureBuffer = new CaptureBuffer(*this, pixelFormat, width, height, stride);
-		if	(	captureBuffer
-			&&	captureBuffer->allocate()
-			)
+		const int32 numAllocated = m_AllocatedBuffers[i].GetValue();
+		if(numAllocated > 0)
 		{
-			bufferSlot.allocated_buffers.Push(captureBuffer);
-			bufferSlot.used_buffers.Push(captureBuffer);
+			SCaptureBufferSlotStatistics slotStatistics;
+			slotStatistics.slot_size = getSizeClassCapacity(i);
+			slotStatistics.num_allocated = static_cast<uint32> (numAllocated);
+			slotStatistics.num_in_use = static_cast<uint32> (m_InUseBuffers[i].GetValue());
+			slotStatistics.peak_in_use = static_cast<uint32> (m_PeakInUseBuffers[i]);
+			statistics.slots.Add(slotStatistics);
 		}
-		logMemorySize();
 	}
+}
+
+void CaptureBufferPool::reserve(uint32 bufferSize, int32 count)
+{
+	if	(	bufferSize == 0
+		||	bufferSize > MaxBufferSize
+		||	count <= 0
+		)
+		return;
+
+	const uint32 sizeClass = getSizeClass(bufferSize);
 
-	m_Mutex.Unlock();
+	FScopeLock lock(&m_AllocationMutex);
 
+	m_ReservedBuffers[sizeClass] += count;
+	prewarm(sizeClass);
+
+	UE_LOG(LogCaptureBufferPool, Log, TEXT("Reserved %d buffers of %d bytes, %d allocated"), m_ReservedBuffers[sizeClass], getSizeClassCapacity(sizeClass), m_AllocatedBuffers[sizeClass].GetValue());
+}
+
+void CaptureBufferPool::unreserve(uint32 bufferSize, int32 count)
+{
+	if	(	bufferSize > 0
+		&&	bufferSize <= MaxBufferSize
+		)
+	{
+		const uint32 sizeClass = getSizeClass(bufferSize);
+
+		FScopeLock lock(&m_AllocationMutex);
+		m_ReservedBuffers[sizeClass] = FMath::Max(m_ReservedBuffers[sizeClass] - count, 0);
+	}
+}
+
+void CaptureBufferPool::prewarm(uint32 sizeClass)
+{
+	const int32 numMissing = m_ReservedBuffers[sizeClass] - m_AllocatedBuffers[sizeClass].GetValue();
+	for(int32 i = 0; i < numMissing; ++i)
+	{
+		CaptureBuffer *captureBuffer = allocate(sizeClass);
+		if(captureBuffer == 0)
+			break;
+
+		// touch every page now instead of on the first copy of a capture into the buffer
+		FMemory::Memzero(captureBuffer->getBuffer<void>(), captureBuffer->getCapacity());
+		push(*captureBuffer);
+	}
+}
+
+CaptureBuffer* CaptureBufferPool::pop(uint32 sizeClass)
+{
+	volatile int64 &freeList = m_FreeLists[sizeClass];
+	CaptureBuffer *captureBuffer = 0;
+	int64 head = 0;
+	int64 newHead = 0;
+	do
+	{
+		head = freeList;
+		const uint32 index = static_cast<uint32> (head);
+		captureBuffer = index > 0 ? m_Buffers[index - 1] : 0;
+
+		// a concurrent pop may already have taken the buffer, the tag makes the exchange below fail in that case
+		newHead = captureBuffer ? (((head >> 32) + 1) << 32 | captureBuffer->m_NextFree) : head;
+	} while	(	captureBuffer
+			&&	FPlatformAtomics::InterlockedCompareExchange(&freeList, newHead, head) != head
+			);
 
 	return captureBuffer;
 }
 
-void CaptureBufferPool::release(CaptureBuffer &buffer)
+void CaptureBufferPool::push(CaptureBuffer &buffer)
+{
+	volatile int64 &freeList = m_FreeLists[buffer.m_SizeClass];
+	int64 head = 0;
+	int64 newHead = 0;
+	do
+	{
+		head = freeList;
+		buffer.m_NextFree = static_cast<uint32> (head);
+		newHead = ((head >> 32) + 1) << 32 | (buffer.m_PoolIndex + 1);
+	} while(FPlatformAtomics::InterlockedCompareExchange(&freeList, newHead, head) != head);
+}
+
+CaptureBuffer* CaptureBufferPool::allocate(uint32 sizeClass)
 {
-	const int32 bufferSize = buffer.getBufferSize();
+	CaptureBuffer *captureBuffer = 0;
+	const uint32 capacity = getSizeClassCapacity(sizeClass);
+
+	FScopeLock lock(&m_AllocationMutex);
 
-	m_Mutex.Lock();
-	if(m_BufferSlots.Contains(bufferSize))
+	if	(	m_MaxAllocatedBytes > 0
+		&&	m_AllocatedBytes + capacity > m_MaxAllocatedBytes
+		)
 	{
-		SBufferSlot &bufferSlot = m_BufferSlots[bufferSize];
+		// make room by giving back buffers currently not needed by other size classes
+		for(uint32 i = 0; i < NumSizeClasses && m_AllocatedBytes + capacity > m_MaxAllocatedBytes; ++i)
+		{
+			if(i != sizeClass)
+				freeAvailable(i, m_AllocatedBuffers[i].GetValue());
+		}
+	}
 
-		const int32 ind = bufferSlot.used_buffers.Find(&buffer);
-		if(ind != INDEX_NONE)
+	if	(	m_MaxAllocatedBytes > 0
+		&&	m_AllocatedBytes + capacity > m_MaxAllocatedBytes
+		)
+	{
+		m_AllocationFailures.Increment();
+		UE_LOG(LogCaptureBufferPool, Warning, TEXT("Allocating %d bytes would exceed pool limit of %llu bytes, %llu bytes allocated"), capacity, m_MaxAllocatedBytes, m_AllocatedBytes);
+	}
+	else if(m_UnusedBuffers.Num() > 0 || m_NumBuffers.GetValue() < MaxBuffers)
+	{
+		bool isNew = false;
+		if(m_UnusedBuffers.Num() > 0)
+			captureBuffer = m_UnusedBuffers.Pop();
+		else
+		{
+			captureBuffer = new CaptureBuffer(*this, PF_Unknown, 0, 0, 0);
+			isNew = true;
+		}
+
+		if	(	captureBuffer
+			&&	captureBuffer->allocate(capacity, m_MemoryMode, m_Allocator)
+			)
+		{
+			if(isNew)
+			{
+				const int32 index = m_NumBuffers.GetValue();
+				captureBuffer->m_PoolIndex = static_cast<uint32> (index);
+				m_Buffers[index] = captureBuffer;
+				m_NumBuffers.Increment();
+			}
+			captureBuffer->m_SizeClass = sizeClass;
+			m_AllocatedBuffers[sizeClass].Increment();
+
+			m_AllocatedBytes += capacity;
+			m_PeakAllocatedBytes = FMath::Max(m_PeakAllocatedBytes, m_AllocatedBytes);
+			UE_LOG(LogCaptureBufferPool, Verbose, TEXT("Allocated buffer of %d bytes, %llu bytes allocated"), capacity, m_AllocatedBytes);
+		}
+		else
 		{
-			bufferSlot.used_buffers.RemoveAt(ind);
-			bufferSlot.available_buffers.Push(&buffer);
+			m_AllocationFailures.Increment();
+			UE_LOG(LogCaptureBufferPool, Error, TEXT("Allocating buffer of %d bytes failed"), capacity);
+
+			if(isNew)
+				delete captureBuffer;
+			else if(captureBuffer)
+				m_UnusedBuffers.Push(captureBuffer);
+			captureBuffer = 0;
 		}
 	}
-	m_Mutex.Unlock();
+	else
+	{
+		m_AllocationFailures.Increment();
+		UE_LOG(LogCaptureBufferPool, Error, TEXT("Maximum number of %d buffers reached"), static_cast<int32> (MaxBuffers));
+	}
+
+	return captureBuffer;
 }
 
-void CaptureBufferPool::logMemorySize()
+uint64 CaptureBufferPool::freeAvailable(uint32 sizeClass, int32 maxCount)
 {
-	uint32 totalSize = 0;
-	for (auto &slot : m_BufferSlots)
+	uint64 freedBytes = 0;
+	for(int32 i = 0; i < maxCount; ++i)
+	{
+		CaptureBuffer *captureBuffer = pop(sizeClass);
+		if(captureBuffer == 0)
+			break;
+
+		freedBytes += captureBuffer->m_Capacity;
+		captureBuffer->freeMemory();
+		m_UnusedBuffers.Push(captureBuffer);
+		m_AllocatedBuffers[sizeClass].Decrement();
+	}
+
+	m_AllocatedBytes -= freedBytes;
+	m_TrimmedBytes += freedBytes;
+	return freedBytes;
+}
+
+void CaptureBufferPool::discard(CaptureBuffer &buffer)
+{
+	FScopeLock lock(&m_AllocationMutex);
+
+	const uint32 capacity = buffer.m_Capacity;
+	buffer.freeMemory();
+	m_UnusedBuffers.Push(&buffer);
+	m_AllocatedBuffers[buffer.m_SizeClass].Decrement();
+	m_AllocatedBytes -= capacity;
+}
+
+void CaptureBufferPool::updatePeakInUse(uint32 sizeClass, int32 numInUse)
+{
+	volatile int32 &peakInUse = m_PeakInUseBuffers[sizeClass];
+	int32 curPeak = peakInUse;
+	while	(	numInUse > curPeak
+			&&	FPlatformAtomics::InterlockedCompareExchange(&peakInUse, numInUse, curPeak) != curPeak
+			)
 	{
-		const uint32 curSize = slot.Key * slot.Value.allocated_buffers.Num();
-		totalSize += curSize;
-		UE_LOG(LogCaptureBufferPool, Log, TEXT("SlotSize %d Allocated %d"), slot.Key, curSize);
+		curPeak = peakInUse;
 	}
-	UE_LOG(LogCaptureBufferPool, Log, TEXT("Total size %d"), totalSize);
 }
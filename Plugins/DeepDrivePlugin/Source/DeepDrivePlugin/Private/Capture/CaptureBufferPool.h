@@ -1,35 +1,200 @@
-
 #pragma once
 
 #include "Engine.h"
+#include "Public/Capture/CaptureDefines.h"
+#include "Private/Capture/ICaptureBufferAllocator.h"
+#include "Private/Capture/CaptureObjectPool.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogCaptureBufferPool, Log, All);
 
 class CaptureBuffer;
 
+/**
+	Statistics of a single size class
+*/
+struct SCaptureBufferSlotStatistics
+{
+	uint32					slot_size = 0;
+	uint32					num_allocated = 0;
+	uint32					num_in_use = 0;
+	uint32					peak_in_use = 0;
+};
+
+struct SCaptureBufferPoolStatistics
+{
+	uint64									allocated_bytes = 0;
+	uint64									used_bytes = 0;
+	uint64									peak_allocated_bytes = 0;
+	uint64									max_allocated_bytes = 0;
+	uint32									allocation_failures = 0;
+	uint64									trimmed_bytes = 0;
+
+	TArray<SCaptureBufferSlotStatistics>	slots;
+};
+
+/**
+	Pool of capture buffers grouped into size classes. Every size class keeps a lock-free free list linked through the buffers themselves,
+	so acquire and release are O(1) and never block the render thread or the sink threads. Only allocating and trimming buffers take a lock.
+	Memory of available buffers is returned to the OS by trim, allocations exceeding the configured byte cap fail.
+*/
 class CaptureBufferPool
 {
-	typedef TArray<CaptureBuffer*>	Buffers;
+public:
 
-	struct SBufferSlot
+	enum
 	{
-		Buffers			allocated_buffers;
-		Buffers			available_buffers;
-		Buffers			used_buffers;
+		MinSizeClassLog2 = 12,
+		MinSizeClassBytes = 1 << MinSizeClassLog2,
+		// four size classes per power of two up to buffers of 2 GB
+		MaxBufferSize = 1u << 31,
+		NumSizeClasses = 1 + (31 - MinSizeClassLog2) * 4,
+		MaxBuffers = 1024
 	};
 
-public:
+	CaptureBufferPool();
+	~CaptureBufferPool();
 
-	CaptureBuffer* acquire(EPixelFormat pixelFormat, uint32 width, uint32 height, uint32 stride);
+	CaptureBuffer* acquire(EPixelFormat pixelFormat, uint32 width, uint32 height, uint32 stride, uint32 depthStride = 0);
 
 	void release(CaptureBuffer &buffer);
 
+	/**
+		Memory used for newly allocated buffers, already allocated buffers keep their memory
+	*/
+	void setMemoryMode(EDeepDriveCaptureBufferMemory memoryMode);
+
+	/**
+		Carve new buffers out of allocator instead of allocating them according to the memory mode, pass an empty pointer to stop.
+		Available buffers are freed, buffers still in use are freed once released.
+	*/
+	void setAllocator(const CaptureBufferAllocatorPtr &allocator);
+
+	/**
+		Maximum number of bytes allocated by the pool, 0 means unlimited.
+		Available buffers of other size classes are freed before an allocation is refused.
+	*/
+	void setMaxAllocatedBytes(uint64 maxAllocatedBytes);
+
+	/**
+		Free available buffers not needed according to the peak usage since the last trim.
+		Size classes not acquired from for idleTime seconds are released completely, idleTime <= 0 keeps idle classes at their peak.
+	*/
+	void trim(double idleTime);
+
+	void getStatistics(SCaptureBufferPoolStatistics &statistics);
+
+	/**
+		Allocate and pre-fault buffers up front so that count buffers of bufferSize bytes can be acquired without allocating.
+		Reserved buffers are kept when trimming until the reservation is dropped again.
+	*/
+	void reserve(uint32 bufferSize, int32 count);
+
+	void unreserve(uint32 bufferSize, int32 count);
+
+	/**
+		Number of bytes currently handed out by the pool
+	*/
+	uint64 getUsedBytes() const;
+
+	static uint32 getSizeClass(uint32 size);
+
+	static uint32 getSizeClassCapacity(uint32 sizeClass);
+
 private:
 
-	void logMemorySize();
+	friend class CaptureBuffer;
+
+	CaptureBuffer* pop(uint32 sizeClass);
+
+	void push(CaptureBuffer &buffer);
+
+	CaptureBuffer* allocate(uint32 sizeClass);
 
-	FCriticalSection				m_Mutex;
+	void prewarm(uint32 sizeClass);
 
-	TMap<uint32, SBufferSlot>		m_BufferSlots;
+	/**
+		Free memory of up to maxCount available buffers of a size class, must be called with m_AllocationMutex locked
+	*/
+	uint64 freeAvailable(uint32 sizeClass, int32 maxCount);
+
+	/**
+		Free memory of a released buffer not matching the current allocator
+	*/
+	void discard(CaptureBuffer &buffer);
+
+	void updatePeakInUse(uint32 sizeClass, int32 numInUse);
+
+	/**
+		Free list heads, lower 32 bits hold buffer index + 1, upper 32 bits a tag incremented on every change to avoid ABA
+	*/
+	volatile int64					m_FreeLists[NumSizeClasses];
+
+	// buffers are never deleted while the pool exists, so they can be safely accessed through their index.
+	// Trimmed buffers only give back their memory and are reused for later allocations.
+	CaptureBuffer					*m_Buffers[MaxBuffers];
+	FThreadSafeCounter				m_NumBuffers;
+	TArray<CaptureBuffer*>			m_UnusedBuffers;
+
+	CaptureObjectPool<CaptureBuffer>	m_ViewPool;						// views created by CaptureBuffer::createView
+
+	FThreadSafeCounter				m_AllocatedBuffers[NumSizeClasses];
+	FThreadSafeCounter				m_InUseBuffers[NumSizeClasses];
+	int32							m_ReservedBuffers[NumSizeClasses];
+	volatile int32					m_PeakInUseBuffers[NumSizeClasses];
+	volatile double					m_LastAcquireTime[NumSizeClasses];
+
+	FCriticalSection				m_AllocationMutex;
+
+	EDeepDriveCaptureBufferMemory	m_MemoryMode = EDeepDriveCaptureBufferMemory::Default;
+	CaptureBufferAllocatorPtr		m_Allocator;
+	ICaptureBufferAllocator			* volatile m_CurrentAllocator = 0;		// compared against on release without taking the lock
+
+	uint64							m_MaxAllocatedBytes = 0;
+	uint64							m_AllocatedBytes = 0;
+	uint64							m_PeakAllocatedBytes = 0;
+	uint64							m_TrimmedBytes = 0;
+	FThreadSafeCounter				m_AllocationFailures;
+
+	FThreadSafeCounter64			m_UsedBytes;
 
 };
+
+inline void CaptureBufferPool::setMemoryMode(EDeepDriveCaptureBufferMemory memoryMode)
+{
+	m_MemoryMode = memoryMode;
+}
+
+inline void CaptureBufferPool::setMaxAllocatedBytes(uint64 maxAllocatedBytes)
+{
+	m_MaxAllocatedBytes = maxAllocatedBytes;
+}
+
+inline uint64 CaptureBufferPool::getUsedBytes() const
+{
+	return static_cast<uint64> (m_UsedBytes.GetValue());
+}
+
+inline uint32 CaptureBufferPool::getSizeClass(uint32 size)
+{
+	uint32 sizeClass = 0;
+	if(size > MinSizeClassBytes)
+	{
+		// size - 1 so that sizes hitting a class boundary exactly map to that class
+		const uint32 log2 = FMath::FloorLog2(size - 1);
+		const uint32 subClass = ((size - 1) >> (log2 - 2)) & 3;
+		sizeClass = 1 + (log2 - MinSizeClassLog2) * 4 + subClass;
+	}
+	return sizeClass;
+}
+
+inline uint32 CaptureBufferPool::getSizeClassCapacity(uint32 sizeClass)
+{
+	uint32 capacity = MinSizeClassBytes;
+	if(sizeClass > 0)
+	{
+		const uint32 log2 = MinSizeClassLog2 + (sizeClass - 1) / 4;
+		const uint32 subClass = (sizeClass - 1) % 4;
+		capacity = (5 + subClass) << (log2 - 2);
+	}
+	return capacity;
+}
@@ -0,0 +1,60 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/Capture/CaptureBufferPool.h"
+#include "Private/Capture/CaptureBuffer.h"
+#include "Private/ConsoleBenchmark.h"
+
+#include "Async/ParallelFor.h"
+
+enum
+{
+	BuffersPerIteration = 4
+};
+
+/**
+	Contention micro benchmark for CaptureBufferPool, run from the console with
+	DeepDrive.BenchmarkCaptureBufferPool [MaxThreads] [NumIterations]
+	Every thread repeatedly acquires a handful of buffers of slightly varying sizes and releases them again.
+*/
+static void benchmarkCaptureBufferPool(const TArray<FString> &args)
+{
+	ConsoleBenchmark benchmark(TEXT("DeepDrive.BenchmarkCaptureBufferPool"), args);
+	const int32 maxThreads = benchmark.getIntArg(0, 8);
+	const int32 numIterations = benchmark.getIntArg(1, 100000);
+
+	CaptureBufferPool captureBufferPool;
+	for(int32 numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+	{
+		benchmark.start();
+
+		ParallelFor(numThreads, [&captureBufferPool, numIterations](int32 threadIndex)
+			{
+				CaptureBuffer *buffers[BuffersPerIteration];
+				for(int32 i = 0; i < numIterations; ++i)
+				{
+					for(int32 j = 0; j < BuffersPerIteration; ++j)
+					{
+						const uint32 width = 1024 + ((threadIndex + i + j) & 15);
+						buffers[j] = captureBufferPool.acquire(PF_B8G8R8A8, width, 64, width * 4);
+					}
+
+					for(int32 j = 0; j < BuffersPerIteration; ++j)
+					{
+						if(buffers[j])
+							buffers[j]->release();
+					}
+				}
+			}
+		);
+
+		const double duration = benchmark.getElapsed();
+		const double numOperations = 2.0 * BuffersPerIteration * numIterations * numThreads;
+		UE_LOG(LogDeepDriveBenchmark, Log, TEXT("%d threads: %.3f ms total, %.1f ns per acquire/release"), numThreads, duration * 1000.0, duration * 1.0e9 / numOperations);
+	}
+}
+
+static FAutoConsoleCommand BenchmarkCaptureBufferPoolCommand
+	(	TEXT("DeepDrive.BenchmarkCaptureBufferPool")
+	,	TEXT("Measure CaptureBufferPool acquire/release throughput under contention. Arguments: [MaxThreads] [NumIterations]")
+	,	FConsoleCommandWithArgsDelegate::CreateStatic(&benchmarkCaptureBufferPool)
+	);
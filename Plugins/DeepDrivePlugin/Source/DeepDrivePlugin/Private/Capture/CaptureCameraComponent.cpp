@@ -5,6 +5,8 @@
 #include "Private/Capture/DeepDriveCapture.h"
 #include "Public/Capture/CaptureDefines.h"
 #include "Private/Capture/CaptureJob.h"
+#include "Private/Capture/CapturePacking.h"
+#include "Public/Capture/DeepDriveCaptureProxy.h"
 
 
 DEFINE_LOG_CATEGORY(DeepDriveCaptureComponent);
@@ -17,7 +19,11 @@ UCaptureCameraComponent::UCaptureCameraComponent()
 
 void UCaptureCameraComponent::Initialize(UTextureRenderTarget2D *RenderTarget, float FoV)
 {
-	CameraId = DeepDriveCapture::GetInstance().RegisterCaptureComponent(this);
+	// render target needs to be known when registering so that capture buffers can be reserved for it
+	SceneRenderTarget = RenderTarget;
+
+	DeepDriveCapture *captureContext = getCaptureContext();
+	CameraId = captureContext ? captureContext->RegisterCaptureComponent(this) : 0;
 
 	AActor *owningActor = GetOwner();
 	FString compName = "SceneCaptureComponent_" + FString::FromInt(CameraId);
@@ -29,7 +35,6 @@ void UCaptureCameraComponent::Initialize(UTextureRenderTarget2D *RenderTarget, f
 
 	if (m_SceneCapture)
 	{
-		SceneRenderTarget = RenderTarget;
 		m_SceneCapture->TextureTarget = RenderTarget;			
 		m_SceneCapture->CaptureSource = ESceneCaptureSource::SCS_SceneColorSceneDepth;
 
@@ -57,7 +62,9 @@ void UCaptureCameraComponent::Initialize(UTextureRenderTarget2D *RenderTarget, f
 
 void UCaptureCameraComponent::Remove()
 {
-	DeepDriveCapture::GetInstance().UnregisterCaptureComponent(CameraId);
+	DeepDriveCapture *captureContext = getCaptureContext();
+	if(captureContext)
+		captureContext->UnregisterCaptureComponent(CameraId);
 	m_SceneCapture->DestroyComponent();
 	//DestroyComponent();
 }
@@ -101,9 +108,66 @@ bool UCaptureCameraComponent::capture(SCaptureRequest &reqData)
 			reqData.capture_source = sceneSrc;
 			reqData.camera_type = CameraType;
 			reqData.camera_id = CameraId;
+			reqData.pack_color_depth = PackColorAndDepth;
+			reqData.capture_region = getCaptureRegion();
+			reqData.downscale_factor = static_cast<uint32> (FMath::Max(DownscaleFactor, 1));
+			reqData.color_format = ColorFormat;
+			reqData.depth_format = DepthFormat;
 			shallCapture = true;
 		}
 	}
 
 	return shallCapture;
 }
+
+uint32 UCaptureCameraComponent::getReadbackSize() const
+{
+	uint32 readbackSize = 0;
+	if(SceneRenderTarget)
+	{
+		const FIntRect region = getCaptureRegion();
+		const uint32 numPixels = region.Area() > 0 ? region.Area() : SceneRenderTarget->SizeX * SceneRenderTarget->SizeY;
+		readbackSize = numPixels * GPixelFormats[SceneRenderTarget->GetFormat()].BlockBytes;
+	}
+	return readbackSize;
+}
+
+uint32 UCaptureCameraComponent::getCaptureBufferSize() const
+{
+	uint32 bufferSize = 0;
+	if(SceneRenderTarget)
+	{
+		const FIntRect region = getCaptureRegion();
+		const uint32 factor = static_cast<uint32> (FMath::Max(DownscaleFactor, 1));
+		const uint32 width = FMath::Max( (region.Area() > 0 ? region.Width() : SceneRenderTarget->SizeX) / factor, 1u);
+		const uint32 height = FMath::Max( (region.Area() > 0 ? region.Height() : SceneRenderTarget->SizeY) / factor, 1u);
+		const EPixelFormat pixelFormat = SceneRenderTarget->GetFormat();
+
+		if	(	PackColorAndDepth
+			&&	pixelFormat == PF_FloatRGBA
+			)
+			bufferSize = width * height * (CapturePacking::BytesPerColorValue + CapturePacking::BytesPerDepthValue);
+		else
+			bufferSize = width * height * GPixelFormats[pixelFormat].BlockBytes;
+	}
+	return bufferSize;
+}
+
+FIntRect UCaptureCameraComponent::getCaptureRegion() const
+{
+	FIntRect region;
+	if	(	SceneRenderTarget
+		&&	RegionSize.X > 0
+		&&	RegionSize.Y > 0
+		)
+	{
+		region = FIntRect(RegionOffset, RegionOffset + RegionSize);
+		region.Clip(FIntRect(0, 0, SceneRenderTarget->SizeX, SceneRenderTarget->SizeY));
+	}
+	return region;
+}
+
+DeepDriveCapture* UCaptureCameraComponent::getCaptureContext()
+{
+	return CaptureProxy ? CaptureProxy->getCaptureContext() : &DeepDriveCapture::GetInstance();
+}
@@ -0,0 +1,313 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/Capture/CaptureConversion.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+	#define DEEPDRIVE_CONVERSION_X86	1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define DEEPDRIVE_TARGET_SSE41
+		#define DEEPDRIVE_TARGET_AVX2
+	#else
+		#include <cpuid.h>
+		#define DEEPDRIVE_TARGET_SSE41		__attribute__((target("sse4.1,f16c")))
+		#define DEEPDRIVE_TARGET_AVX2		__attribute__((target("avx2,f16c")))
+	#endif
+#else
+	#define DEEPDRIVE_CONVERSION_X86	0
+#endif
+
+DEFINE_LOG_CATEGORY(LogCaptureConversion);
+
+enum
+{
+	PixelsPerBlock = 8
+};
+
+static void splitColorDepthScalar(const FFloat16 *src, uint32 numPixels, FFloat16 *colorDst, FFloat16 *depthDst, float depthDivisor, bool nonTemporal)
+{
+	for(uint32 x = 0; x < numPixels; x++)
+	{
+		*colorDst++ = src[0];
+		*colorDst++ = src[1];
+		*colorDst++ = src[2];
+
+		depthDst->Set(src[3].GetFloat() / depthDivisor);
+		depthDst++;
+
+		src += 4;
+	}
+}
+
+#if DEEPDRIVE_CONVERSION_X86
+
+struct SCpuFeatures
+{
+	SCpuFeatures();
+
+	bool	sse41_f16c = false;
+	bool	avx2_f16c = false;
+};
+
+static void getCpuId(int32 info[4], int32 leaf, int32 subLeaf)
+{
+#if defined(_MSC_VER)
+	__cpuidex(info, leaf, subLeaf);
+#else
+	__cpuid_count(leaf, subLeaf, info[0], info[1], info[2], info[3]);
+#endif
+}
+
+static uint64 getExtendedControlRegister()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	uint32 eax = 0;
+	uint32 edx = 0;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<uint64> (edx) << 32) | eax;
+#endif
+}
+
+SCpuFeatures::SCpuFeatures()
+{
+	int32 info[4] = {0};
+	getCpuId(info, 0, 0);
+	const int32 maxLeaf = info[0];
+
+	getCpuId(info, 1, 0);
+	const bool hasSSSE3 = (info[2] & (1 << 9)) != 0;
+	const bool hasSSE41 = (info[2] & (1 << 19)) != 0;
+	const bool hasOSXSave = (info[2] & (1 << 27)) != 0;
+	const bool hasAVX = (info[2] & (1 << 28)) != 0;
+	const bool hasF16C = (info[2] & (1 << 29)) != 0;
+
+	// F16C instructions are VEX encoded, so the OS has to save AVX registers even for the SSE kernel
+	const bool hasOSAVX = hasOSXSave && hasAVX && (getExtendedControlRegister() & 6) == 6;
+
+	bool hasAVX2 = false;
+	if(maxLeaf >= 7)
+	{
+		getCpuId(info, 7, 0);
+		hasAVX2 = (info[1] & (1 << 5)) != 0;
+	}
+
+	sse41_f16c = hasSSSE3 && hasSSE41 && hasF16C && hasOSAVX;
+	avx2_f16c = sse41_f16c && hasAVX2;
+}
+
+static const SCpuFeatures& getCpuFeatures()
+{
+	static const SCpuFeatures cpuFeatures;
+	return cpuFeatures;
+}
+
+static FORCEINLINE void storeBlock(__m128i *dst, __m128i value, bool nonTemporal)
+{
+	if(nonTemporal)
+		_mm_stream_si128(dst, value);
+	else
+		_mm_storeu_si128(dst, value);
+}
+
+/**
+	Same semantics as FFloat16::Set: values too small for a normalized half become signed zero, values too large are clamped
+	to 65504 and the mantissa is truncated
+*/
+DEEPDRIVE_TARGET_SSE41 static FORCEINLINE __m128i floatToHalf(__m128 value)
+{
+	const __m128i bits = _mm_castps_si128(value);
+	const __m128i sign = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(0x8000));
+	const __m128i exponent = _mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xFF));
+	const __m128i mantissa = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(0x3FF));
+
+	const __m128i normal = _mm_or_si128(sign, _mm_or_si128(_mm_slli_epi32(_mm_sub_epi32(exponent, _mm_set1_epi32(112)), 10), mantissa));
+	const __m128i tooSmall = _mm_cmplt_epi32(exponent, _mm_set1_epi32(113));
+	const __m128i tooLarge = _mm_cmpgt_epi32(exponent, _mm_set1_epi32(142));
+
+	__m128i half = _mm_blendv_epi8(normal, _mm_or_si128(sign, _mm_set1_epi32(0x7BFF)), tooLarge);
+	half = _mm_blendv_epi8(half, sign, tooSmall);
+	return half;
+}
+
+DEEPDRIVE_TARGET_AVX2 static FORCEINLINE __m256i floatToHalf(__m256 value)
+{
+	const __m256i bits = _mm256_castps_si256(value);
+	const __m256i sign = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x8000));
+	const __m256i exponent = _mm256_and_si256(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0xFF));
+	const __m256i mantissa = _mm256_and_si256(_mm256_srli_epi32(bits, 13), _mm256_set1_epi32(0x3FF));
+
+	const __m256i normal = _mm256_or_si256(sign, _mm256_or_si256(_mm256_slli_epi32(_mm256_sub_epi32(exponent, _mm256_set1_epi32(112)), 10), mantissa));
+	const __m256i tooSmall = _mm256_cmpgt_epi32(_mm256_set1_epi32(113), exponent);
+	const __m256i tooLarge = _mm256_cmpgt_epi32(exponent, _mm256_set1_epi32(142));
+
+	__m256i half = _mm256_blendv_epi8(normal, _mm256_or_si256(sign, _mm256_set1_epi32(0x7BFF)), tooLarge);
+	half = _mm256_blendv_epi8(half, sign, tooSmall);
+	return half;
+}
+
+/**
+	Splits 8 pixels into 48 bytes of RGB and returns their 8 depth values. Returns false if any depth value is a denormal, infinity or NaN,
+	FFloat16 treats those differently than F16C, so the block has to be converted by the scalar kernel.
+*/
+DEEPDRIVE_TARGET_SSE41 static FORCEINLINE bool splitBlock(const FFloat16 *src, FFloat16 *colorDst, bool nonTemporal, __m128i &depth)
+{
+	const __m128i colorMask = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1);
+	const __m128i depthMask = _mm_setr_epi8(6, 7, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	const __m128i *srcBlock = reinterpret_cast<const __m128i*> (src);
+	const __m128i p0 = _mm_loadu_si128(srcBlock + 0);
+	const __m128i p1 = _mm_loadu_si128(srcBlock + 1);
+	const __m128i p2 = _mm_loadu_si128(srcBlock + 2);
+	const __m128i p3 = _mm_loadu_si128(srcBlock + 3);
+
+	depth = _mm_or_si128	(	_mm_or_si128(_mm_shuffle_epi8(p0, depthMask), _mm_slli_si128(_mm_shuffle_epi8(p1, depthMask), 4))
+						,	_mm_or_si128(_mm_slli_si128(_mm_shuffle_epi8(p2, depthMask), 8), _mm_slli_si128(_mm_shuffle_epi8(p3, depthMask), 12))
+						);
+
+	const __m128i exponent = _mm_and_si128(depth, _mm_set1_epi16(0x7C00));
+	const __m128i isSpecial = _mm_or_si128	(	_mm_cmpeq_epi16(exponent, _mm_set1_epi16(0x7C00))
+											,	_mm_andnot_si128(_mm_cmpeq_epi16(_mm_and_si128(depth, _mm_set1_epi16(0x03FF)), _mm_setzero_si128()), _mm_cmpeq_epi16(exponent, _mm_setzero_si128()))
+											);
+	if(_mm_movemask_epi8(isSpecial) != 0)
+		return false;
+
+	// each pixel pair yields 12 bytes of RGB, stitch them into three 16 byte stores
+	const __m128i c0 = _mm_shuffle_epi8(p0, colorMask);
+	const __m128i c1 = _mm_shuffle_epi8(p1, colorMask);
+	const __m128i c2 = _mm_shuffle_epi8(p2, colorMask);
+	const __m128i c3 = _mm_shuffle_epi8(p3, colorMask);
+
+	__m128i *colorBlock = reinterpret_cast<__m128i*> (colorDst);
+	storeBlock(colorBlock + 0, _mm_or_si128(c0, _mm_slli_si128(c1, 12)), nonTemporal);
+	storeBlock(colorBlock + 1, _mm_or_si128(_mm_srli_si128(c1, 4), _mm_slli_si128(c2, 8)), nonTemporal);
+	storeBlock(colorBlock + 2, _mm_or_si128(_mm_srli_si128(c2, 8), _mm_slli_si128(c3, 4)), nonTemporal);
+
+	return true;
+}
+
+DEEPDRIVE_TARGET_SSE41 static void splitColorDepthSSE41(const FFloat16 *src, uint32 numPixels, FFloat16 *colorDst, FFloat16 *depthDst, float depthDivisor, bool nonTemporal)
+{
+	// streaming stores need 16 byte aligned destinations, advancing by whole blocks keeps them aligned
+	nonTemporal	=	nonTemporal
+				&&	(reinterpret_cast<UPTRINT> (colorDst) & 15) == 0
+				&&	(reinterpret_cast<UPTRINT> (depthDst) & 15) == 0;
+
+	const __m128 divisor = _mm_set1_ps(depthDivisor);
+
+	uint32 x = 0;
+	for(; x + PixelsPerBlock <= numPixels; x += PixelsPerBlock)
+	{
+		__m128i depth;
+		if(splitBlock(src, colorDst, nonTemporal, depth))
+		{
+			const __m128i depthLo = floatToHalf(_mm_div_ps(_mm_cvtph_ps(depth), divisor));
+			const __m128i depthHi = floatToHalf(_mm_div_ps(_mm_cvtph_ps(_mm_srli_si128(depth, 8)), divisor));
+			storeBlock(reinterpret_cast<__m128i*> (depthDst), _mm_packus_epi32(depthLo, depthHi), nonTemporal);
+		}
+		else
+			splitColorDepthScalar(src, PixelsPerBlock, colorDst, depthDst, depthDivisor, false);
+
+		src += 4 * PixelsPerBlock;
+		colorDst += 3 * PixelsPerBlock;
+		depthDst += PixelsPerBlock;
+	}
+
+	splitColorDepthScalar(src, numPixels - x, colorDst, depthDst, depthDivisor, false);
+
+	if(nonTemporal)
+		_mm_sfence();
+}
+
+DEEPDRIVE_TARGET_AVX2 static void splitColorDepthAVX2(const FFloat16 *src, uint32 numPixels, FFloat16 *colorDst, FFloat16 *depthDst, float depthDivisor, bool nonTemporal)
+{
+	nonTemporal	=	nonTemporal
+				&&	(reinterpret_cast<UPTRINT> (colorDst) & 15) == 0
+				&&	(reinterpret_cast<UPTRINT> (depthDst) & 15) == 0;
+
+	const __m256 divisor = _mm256_set1_ps(depthDivisor);
+
+	uint32 x = 0;
+	for(; x + PixelsPerBlock <= numPixels; x += PixelsPerBlock)
+	{
+		__m128i depth;
+		if(splitBlock(src, colorDst, nonTemporal, depth))
+		{
+			// all 8 depth values in one go, packing works per 128 bit lane so the 64 bit halves need reordering
+			const __m256i depthHalf = floatToHalf(_mm256_div_ps(_mm256_cvtph_ps(depth), divisor));
+			const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(depthHalf, depthHalf), _MM_SHUFFLE(3, 1, 2, 0));
+			storeBlock(reinterpret_cast<__m128i*> (depthDst), _mm256_castsi256_si128(packed), nonTemporal);
+		}
+		else
+			splitColorDepthScalar(src, PixelsPerBlock, colorDst, depthDst, depthDivisor, false);
+
+		src += 4 * PixelsPerBlock;
+		colorDst += 3 * PixelsPerBlock;
+		depthDst += PixelsPerBlock;
+	}
+
+	splitColorDepthScalar(src, numPixels - x, colorDst, depthDst, depthDivisor, false);
+
+	if(nonTemporal)
+		_mm_sfence();
+}
+
+#endif
+
+void CaptureConversion::splitColorDepth(const FFloat16 *src, uint32 numPixels, FFloat16 *colorDst, FFloat16 *depthDst, float depthDivisor, bool nonTemporal)
+{
+	static const SplitColorDepthFunc bestKernel = getKernel(getBestKernel());
+	bestKernel(src, numPixels, colorDst, depthDst, depthDivisor, nonTemporal);
+}
+
+CaptureConversion::SplitColorDepthFunc CaptureConversion::getKernel(Kernel kernel)
+{
+	SplitColorDepthFunc func = 0;
+	switch(kernel)
+	{
+		case Scalar:
+			func = &splitColorDepthScalar;
+			break;
+
+#if DEEPDRIVE_CONVERSION_X86
+		case SSE41:
+			func = getCpuFeatures().sse41_f16c ? &splitColorDepthSSE41 : 0;
+			break;
+
+		case AVX2:
+			func = getCpuFeatures().avx2_f16c ? &splitColorDepthAVX2 : 0;
+			break;
+#endif
+
+		default:
+			break;
+	}
+	return func;
+}
+
+CaptureConversion::Kernel CaptureConversion::getBestKernel()
+{
+	Kernel kernel = Scalar;
+	for(int32 i = NumKernels - 1; i > Scalar; --i)
+	{
+		if(getKernel(static_cast<Kernel> (i)))
+		{
+			kernel = static_cast<Kernel> (i);
+			break;
+		}
+	}
+	return kernel;
+}
+
+const TCHAR* CaptureConversion::getKernelName(Kernel kernel)
+{
+	switch(kernel)
+	{
+		case Scalar:	return TEXT("Scalar");
+		case SSE41:		return TEXT("SSE4.1+F16C");
+		case AVX2:		return TEXT("AVX2+F16C");
+		default:		return TEXT("Unknown");
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Engine.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogCaptureConversion, Log, All);
+
+/**
+	Kernels splitting FloatRGBA captures into interleaved half float RGB color and half float depth divided by depthDivisor.
+	Vectorized kernels are picked at runtime depending on CPU support and produce exactly the same bits as the scalar one,
+	which uses FFloat16 conversions. Non-temporal stores bypass the cache for destinations not read again by this process, e.g. shared memory.
+*/
+class CaptureConversion
+{
+public:
+
+	enum Kernel
+	{
+		Scalar,
+		SSE41,			// SSE4.1 + F16C
+		AVX2,			// AVX2 + F16C
+		NumKernels
+	};
+
+	typedef void (*SplitColorDepthFunc)(const FFloat16 *src, uint32 numPixels, FFloat16 *colorDst, FFloat16 *depthDst, float depthDivisor, bool nonTemporal);
+
+	/**
+		Convert numPixels pixels using the fastest kernel supported
+	*/
+	static void splitColorDepth(const FFloat16 *src, uint32 numPixels, FFloat16 *colorDst, FFloat16 *depthDst, float depthDivisor, bool nonTemporal = false);
+
+	/**
+		Kernel function, 0 if kernel isn't supported by this CPU or build
+	*/
+	static SplitColorDepthFunc getKernel(Kernel kernel);
+
+	static Kernel getBestKernel();
+
+	static const TCHAR* getKernelName(Kernel kernel);
+
+};
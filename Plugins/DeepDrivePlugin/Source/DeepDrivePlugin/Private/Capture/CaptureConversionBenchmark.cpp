@@ -0,0 +1,97 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/Capture/CaptureConversion.h"
+#include "Private/ConsoleBenchmark.h"
+
+/**
+	Checks every supported CaptureConversion kernel against the scalar one and measures its throughput, run from the console with
+	DeepDrive.BenchmarkCaptureConversion [Width] [Height] [NumIterations]
+	Source data is random half float color with depth values covering denormals, infinities and NaN.
+*/
+static void benchmarkCaptureConversion(const TArray<FString> &args)
+{
+	ConsoleBenchmark benchmark(TEXT("DeepDrive.BenchmarkCaptureConversion"), args);
+	const uint32 width = benchmark.getIntArg(0, 1024);
+	const uint32 height = benchmark.getIntArg(1, 1024);
+	const int32 numIterations = benchmark.getIntArg(2, 20);
+	const uint32 numPixels = width * height;
+
+	FRandomStream random(0x0DEE9D81);
+
+	TArray<FFloat16> src;
+	src.SetNumUninitialized(numPixels * 4);
+	for(uint32 i = 0; i < numPixels * 4; ++i)
+	{
+		src[i].Encoded = static_cast<uint16> (random.RandHelper(65536));
+
+		// mostly plausible depth values, with every kind of special value mixed in
+		if((i & 3) == 3)
+		{
+			const int32 kind = random.RandHelper(64);
+			if(kind == 0)
+				src[i].Encoded = static_cast<uint16> (random.RandHelper(0x400));
+			else if(kind == 1)
+				src[i].Encoded = static_cast<uint16> (0x7C00 | random.RandHelper(0x400));
+			else if(kind > 2)
+				src[i].Encoded = static_cast<uint16> (0x3C00 + random.RandHelper(0x3800));
+		}
+	}
+
+	TArray<FFloat16> refColor;
+	TArray<FFloat16> refDepth;
+	refColor.SetNumZeroed(numPixels * 3);
+	refDepth.SetNumZeroed(numPixels);
+	CaptureConversion::getKernel(CaptureConversion::Scalar)(src.GetData(), numPixels, refColor.GetData(), refDepth.GetData(), 65535.0f, false);
+
+	TArray<FFloat16> color;
+	TArray<FFloat16> depth;
+	color.SetNumZeroed(numPixels * 3);
+	depth.SetNumZeroed(numPixels);
+
+	int32 numMismatched = 0;
+	for(int32 i = 0; i < CaptureConversion::NumKernels; ++i)
+	{
+		const CaptureConversion::Kernel kernel = static_cast<CaptureConversion::Kernel> (i);
+		CaptureConversion::SplitColorDepthFunc splitColorDepth = CaptureConversion::getKernel(kernel);
+		if(splitColorDepth == 0)
+		{
+			UE_LOG(LogDeepDriveBenchmark, Log, TEXT("%s not supported"), CaptureConversion::getKernelName(kernel));
+			continue;
+		}
+
+		for(int32 nonTemporal = 0; nonTemporal < 2; ++nonTemporal)
+		{
+			FMemory::Memzero(color.GetData(), color.Num() * sizeof(FFloat16));
+			FMemory::Memzero(depth.GetData(), depth.Num() * sizeof(FFloat16));
+
+			benchmark.start();
+			for(int32 j = 0; j < numIterations; ++j)
+			{
+				for(uint32 y = 0; y < height; ++y)
+					splitColorDepth(src.GetData() + y * width * 4, width, color.GetData() + y * width * 3, depth.GetData() + y * width, 65535.0f, nonTemporal != 0);
+			}
+			const double duration = benchmark.getElapsed();
+
+			const bool isEqual	=	FMemory::Memcmp(color.GetData(), refColor.GetData(), color.Num() * sizeof(FFloat16)) == 0
+								&&	FMemory::Memcmp(depth.GetData(), refDepth.GetData(), depth.Num() * sizeof(FFloat16)) == 0;
+			if(!isEqual)
+				++numMismatched;
+
+			// 8 bytes read, 8 bytes written per pixel
+			const double gigaBytesPerSecond = ConsoleBenchmark::getRate(16.0 * numPixels * numIterations, duration) / 1.0e9;
+			UE_LOG	(	LogDeepDriveBenchmark, Log, TEXT("%s%s: %.2f GB/s, %s")
+					,	CaptureConversion::getKernelName(kernel), nonTemporal ? TEXT(" non-temporal") : TEXT("")
+					,	gigaBytesPerSecond, isEqual ? TEXT("matches scalar") : TEXT("MISMATCH")
+					);
+		}
+	}
+
+	UE_LOG(LogDeepDriveBenchmark, Log, TEXT("Using %s"), CaptureConversion::getKernelName(CaptureConversion::getBestKernel()));
+	benchmark.logResult(numMismatched == 0);
+}
+
+static FAutoConsoleCommand BenchmarkCaptureConversionCommand
+	(	TEXT("DeepDrive.BenchmarkCaptureConversion")
+	,	TEXT("Verify capture conversion kernels against the scalar one and measure their throughput. Arguments: [Width] [Height] [NumIterations]")
+	,	FConsoleCommandWithArgsDelegate::CreateStatic(&benchmarkCaptureConversion)
+	);
@@ -0,0 +1,45 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/Capture/CaptureDispatcher.h"
+#include "Private/Capture/DeepDriveCapture.h"
+
+DEFINE_LOG_CATEGORY(LogCaptureDispatcher);
+
+CaptureDispatcher::CaptureDispatcher(DeepDriveCapture &captureContext)
+	:	m_CaptureContext(captureContext)
+{
+	m_JobsFinished = FGenericPlatformProcess::GetSynchEventFromPool(false);
+	m_DispatchThread = FRunnableThread::Create(this, TEXT("CaptureDispatcher"), 0, TPri_AboveNormal);
+
+	UE_LOG(LogCaptureDispatcher, Log, TEXT("Capture dispatcher started"));
+}
+
+CaptureDispatcher::~CaptureDispatcher()
+{
+	if(m_DispatchThread)
+	{
+		Stop();
+		delete m_DispatchThread;
+	}
+
+	if(m_JobsFinished)
+		FGenericPlatformProcess::ReturnSynchEventToPool(m_JobsFinished);
+}
+
+uint32 CaptureDispatcher::Run()
+{
+	while(!m_isStopped)
+	{
+		(void) m_JobsFinished->Wait();
+		if(!m_isStopped)
+			m_CaptureContext.processFinishedJobs();
+	}
+
+	return 0;
+}
+
+void CaptureDispatcher::Stop()
+{
+	m_isStopped = true;
+	m_JobsFinished->Trigger();
+}
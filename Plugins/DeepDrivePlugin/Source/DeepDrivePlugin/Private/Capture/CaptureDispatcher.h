@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Engine.h"
+#include "Runtime/Core/Public/HAL/Runnable.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogCaptureDispatcher, Log, All);
+
+class DeepDriveCapture;
+
+/**
+	Hands finished capture jobs of a capture context to its sinks on a thread of its own. The render thread
+	triggers getJobsFinishedEvent() whenever it has completed a job, so captures reach the sinks without waiting for the next game tick.
+*/
+class CaptureDispatcher	:	public FRunnable
+{
+public:
+
+	CaptureDispatcher(DeepDriveCapture &captureContext);
+	virtual ~CaptureDispatcher();
+
+	virtual uint32 Run();
+	virtual void Stop();
+
+	FEvent* getJobsFinishedEvent();
+
+private:
+
+	DeepDriveCapture				&m_CaptureContext;
+
+	FRunnableThread					*m_DispatchThread = 0;
+	FEvent							*m_JobsFinished = 0;
+	volatile bool					m_isStopped = false;
+};
+
+
+inline FEvent* CaptureDispatcher::getJobsFinishedEvent()
+{
+	return m_JobsFinished;
+}
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "Engine.h"
+#include "Public/DeepDriveData.h"
 
 class CaptureBuffer;
 class CaptureBufferPool;
+class CaptureReadbackRing;
+class CaptureJobQueue;
 
 struct SCaptureDestinationData
 {
@@ -21,16 +24,66 @@ struct SCaptureRequest
 	int32							camera_id = 0;
 	FTextureRenderTargetResource	*capture_source = 0;
 	CaptureBuffer					*capture_buffer = 0;
+	bool							pack_color_depth = false;
+	FIntRect						capture_region;					// empty for whole capture source
+	uint32							downscale_factor = 1;
+	EDeepDriveCaptureColorFormat	color_format = EDeepDriveCaptureColorFormat::Default;
+	EDeepDriveCaptureDepthFormat	depth_format = EDeepDriveCaptureDepthFormat::Default;
+
+	/**
+		Region of capture source to read back, clipped against source size
+	*/
+	FIntRect getSourceRegion(int32 sourceWidth, int32 sourceHeight) const;
 };
 
-struct SCaptureJob;
+inline FIntRect SCaptureRequest::getSourceRegion(int32 sourceWidth, int32 sourceHeight) const
+{
+	FIntRect region(0, 0, sourceWidth, sourceHeight);
+	if(capture_region.Area() > 0)
+	{
+		FIntRect clipped = capture_region;
+		clipped.Clip(region);
+		if(clipped.Area() > 0)
+			region = clipped;
+	}
+	return region;
+}
+
+/**
+	Link of a job in a CaptureJobQueue
+*/
+struct SCaptureJobLink
+{
+	SCaptureJobLink * volatile	next_job = 0;
+};
 
-struct SCaptureJob
+struct SCaptureJob	:	public SCaptureJobLink
 {
-	double						timestamp;
+	double						timestamp = 0.0;
 	int32						sequence_number = 0;
 	TArray<SCaptureRequest>		capture_requests;
 
 	CaptureBufferPool			*capture_buffer_pool = 0;
-	TQueue<SCaptureJob*>		*result_queue = 0;
+	CaptureReadbackRing			*readback_ring = 0;
+	CaptureJobQueue				*result_queue = 0;
+	FEvent						*result_event = 0;				// triggered after job has been added to result queue, may be 0
+
+	FDeepDriveDataOut			deep_drive_data;				// snapshot of the agent's state at capture time
+
+	/**
+		Clear job for reuse, capture requests keep their allocation
+	*/
+	void reset();
 };
+
+inline void SCaptureJob::reset()
+{
+	timestamp = 0.0;
+	sequence_number = 0;
+	capture_requests.Reset();
+	capture_buffer_pool = 0;
+	readback_ring = 0;
+	result_queue = 0;
+	result_event = 0;
+	next_job = 0;
+}
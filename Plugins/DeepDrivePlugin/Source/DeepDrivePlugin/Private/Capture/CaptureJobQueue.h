@@ -0,0 +1,91 @@
+
+#pragma once
+
+#include "Engine.h"
+#include "Private/Capture/CaptureJob.h"
+
+/**
+	Queue of finished capture jobs, linked through the jobs themselves so enqueueing never allocates.
+	Any number of threads may enqueue, a single thread dequeues. Follows Dmitry Vyukov's intrusive MPSC queue:
+	a stub link keeps the queue non-empty, so producers and consumer never touch the same link except for the last one.
+	dequeue() may miss a job whose enqueue() is still in progress, it is found by the next dequeue() after enqueue() returned.
+*/
+class CaptureJobQueue
+{
+public:
+
+	CaptureJobQueue();
+
+	void enqueue(SCaptureJob *job);
+
+	/**
+		Oldest job, false if there is none
+	*/
+	bool dequeue(SCaptureJob *&job);
+
+private:
+
+	CaptureJobQueue(const CaptureJobQueue&) = delete;
+	CaptureJobQueue& operator=(const CaptureJobQueue&) = delete;
+
+	void push(SCaptureJobLink *link);
+
+	SCaptureJobLink * volatile		m_Head;							// most recently enqueued, written by producers
+	SCaptureJobLink					*m_Tail;						// next to dequeue, consumer only
+	SCaptureJobLink					m_Stub;
+};
+
+
+inline CaptureJobQueue::CaptureJobQueue()
+	:	m_Head(&m_Stub)
+	,	m_Tail(&m_Stub)
+{
+}
+
+inline void CaptureJobQueue::enqueue(SCaptureJob *job)
+{
+	if(job)
+		push(job);
+}
+
+inline void CaptureJobQueue::push(SCaptureJobLink *link)
+{
+	link->next_job = 0;
+	SCaptureJobLink *prev = reinterpret_cast<SCaptureJobLink*> (FPlatformAtomics::InterlockedExchangePtr(reinterpret_cast<void**> (const_cast<SCaptureJobLink**> (&m_Head)), link));
+
+	// publishes the job's contents along with the link
+	FPlatformMisc::MemoryBarrier();
+	prev->next_job = link;
+}
+
+inline bool CaptureJobQueue::dequeue(SCaptureJob *&job)
+{
+	SCaptureJobLink *tail = m_Tail;
+	SCaptureJobLink *next = tail->next_job;
+
+	if(tail == &m_Stub)
+	{
+		if(next == 0)
+			return false;
+		m_Tail = next;
+		tail = next;
+		next = next->next_job;
+	}
+
+	if(next == 0)
+	{
+		// tail is the last job unless a producer is about to link another one
+		if(tail != m_Head)
+			return false;
+
+		push(&m_Stub);
+		next = tail->next_job;
+		if(next == 0)
+			return false;
+	}
+
+	FPlatformMisc::MemoryBarrier();
+	m_Tail = next;
+	job = static_cast<SCaptureJob*> (tail);
+	return true;
+}
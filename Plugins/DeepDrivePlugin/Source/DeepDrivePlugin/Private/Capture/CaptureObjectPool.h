@@ -0,0 +1,76 @@
+
+#pragma once
+
+#include "Engine.h"
+#include "LockFreeList.h"
+
+/**
+	Recycles per frame objects like capture jobs and sink job data instead of allocating them every frame.
+	Objects may be acquired and released on any thread. T needs a default constructor and a reset() method
+	which clears an object for reuse while keeping its allocations. All objects have to be released before the pool is destroyed.
+*/
+template<typename T>
+class CaptureObjectPool
+{
+public:
+
+	CaptureObjectPool()
+	{
+	}
+
+	~CaptureObjectPool();
+
+	T* acquire();
+
+	void release(T *object);
+
+	/**
+		Number of objects allocated by this pool so far, in use or not
+	*/
+	int32 getNumAllocated() const;
+
+private:
+
+	CaptureObjectPool(const CaptureObjectPool&) = delete;
+	CaptureObjectPool& operator=(const CaptureObjectPool&) = delete;
+
+	TLockFreePointerListLIFO<T>		m_FreeObjects;
+	FThreadSafeCounter				m_NumAllocated;
+};
+
+
+template<typename T>
+inline CaptureObjectPool<T>::~CaptureObjectPool()
+{
+	T *object = 0;
+	while((object = m_FreeObjects.Pop()) != 0)
+		delete object;
+}
+
+template<typename T>
+inline T* CaptureObjectPool<T>::acquire()
+{
+	T *object = m_FreeObjects.Pop();
+	if(object == 0)
+	{
+		object = new T;
+		m_NumAllocated.Increment();
+	}
+	return object;
+}
+
+template<typename T>
+inline void CaptureObjectPool<T>::release(T *object)
+{
+	if(object)
+	{
+		object->reset();
+		m_FreeObjects.Push(object);
+	}
+}
+
+template<typename T>
+inline int32 CaptureObjectPool<T>::getNumAllocated() const
+{
+	return m_NumAllocated.GetValue();
+}
@@ -0,0 +1,75 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/Capture/CapturePacking.h"
+
+void CapturePacking::packColorDepth(const void *src, uint32 srcStride, uint32 width, uint32 height, uint8 *colorDst, uint32 colorStride, uint16 *depthDst, uint32 depthStride, uint32 srcPixelStep)
+{
+	const uint8 *colorLUT = getColorLUT();
+
+	for(uint32 y = 0; y < height; ++y)
+	{
+		const FFloat16 *f16Src = reinterpret_cast<const FFloat16*> (reinterpret_cast<const uint8*> (src) + y * srcStride);
+		uint8 *colRow = colorDst + y * colorStride;
+		uint16 *depthRow = reinterpret_cast<uint16*> (reinterpret_cast<uint8*> (depthDst) + y * depthStride);
+
+		for(uint32 x = 0; x < width; ++x)
+		{
+			*colRow++ = colorLUT[f16Src[2].Encoded];
+			*colRow++ = colorLUT[f16Src[1].Encoded];
+			*colRow++ = colorLUT[f16Src[0].Encoded];
+			*colRow++ = 255;
+
+			*depthRow++ = packDepth(f16Src[3]);
+
+			f16Src += 4 * srcPixelStep;
+		}
+	}
+}
+
+const uint8* CapturePacking::getColorLUT()
+{
+	// one entry per half float bit pattern holding its sRGB encoding, negative values and NaN map to 0
+	struct SColorLUT
+	{
+		SColorLUT()
+		{
+			for(uint32 i = 0; i < 65536; ++i)
+			{
+				FFloat16 value;
+				value.Encoded = static_cast<uint16> (i);
+				const float linear = value.GetFloat();
+				// negated comparison also maps NaN to 0
+				const float encoded	=	!(linear > 0.0f) ? 0.0f
+									:	linear <= 0.0031308f ? linear * 12.92f
+									:	FMath::Min(1.055f * FMath::Pow(linear, 1.0f / 2.4f) - 0.055f, 1.0f);
+				lut[i] = static_cast<uint8> (encoded * 255.0f + 0.5f);
+			}
+		}
+
+		uint8	lut[65536];
+	};
+
+	static const SColorLUT colorLUT;
+	return colorLUT.lut;
+}
+
+const float* CapturePacking::getLinearLUT()
+{
+	// inverse of the sRGB encoding for every 8 bit value
+	struct SLinearLUT
+	{
+		SLinearLUT()
+		{
+			for(uint32 i = 0; i < 256; ++i)
+			{
+				const float encoded = i / 255.0f;
+				lut[i] = encoded <= 0.04045f ? encoded / 12.92f : FMath::Pow((encoded + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+
+		float	lut[256];
+	};
+
+	static const SLinearLUT linearLUT;
+	return linearLUT.lut;
+}
@@ -0,0 +1,61 @@
+
+#pragma once
+
+#include "Engine.h"
+
+/**
+	Packs FloatRGBA scene color / scene depth captures into a compact layout:
+	a B8G8R8A8 color plane (sRGB encoded, alpha 255) followed by an unsigned 16 bit depth plane (depth in cm, clamped to 65535).
+	This is the reference definition of the packed layout, every other packing path must produce identical bytes.
+	Packing runs on the CPU while copying out of the staging texture, the GPU still reads back full FloatRGBA data.
+	DeepDrive.CheckCapturePacking verifies that packed captures are published exactly like unpacked ones converted by the sinks.
+*/
+class CapturePacking
+{
+public:
+
+	enum
+	{
+		BytesPerColorValue = 4,
+		BytesPerDepthValue = 2
+	};
+
+	/**
+		Pack width x height pixels, srcPixelStep allows skipping source pixels when downscaling
+	*/
+	static void packColorDepth(const void *src, uint32 srcStride, uint32 width, uint32 height, uint8 *colorDst, uint32 colorStride, uint16 *depthDst, uint32 depthStride, uint32 srcPixelStep = 1);
+
+	static uint8 packColor(FFloat16 value);
+
+	/**
+		Linear value of an sRGB encoded 8 bit color value
+	*/
+	static float unpackColor(uint8 value);
+
+	static uint16 packDepth(FFloat16 value);
+
+private:
+
+	static const uint8* getColorLUT();
+
+	static const float* getLinearLUT();
+
+};
+
+
+inline uint8 CapturePacking::packColor(FFloat16 value)
+{
+	return getColorLUT()[value.Encoded];
+}
+
+inline float CapturePacking::unpackColor(uint8 value)
+{
+	return getLinearLUT()[value];
+}
+
+inline uint16 CapturePacking::packDepth(FFloat16 value)
+{
+	const float depth = value.GetFloat();
+	// negated comparison also maps NaN to 0
+	return !(depth > 0.0f) ? 0 : (depth >= 65535.0f ? 65535 : static_cast<uint16> (depth + 0.5f));
+}
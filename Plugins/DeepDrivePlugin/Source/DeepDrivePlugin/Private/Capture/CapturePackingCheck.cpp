@@ -0,0 +1,120 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/Capture/CapturePacking.h"
+#include "Private/Capture/CaptureBuffer.h"
+#include "Private/Capture/CaptureBufferPool.h"
+#include "Private/CaptureSink/SharedMemSink/SharedMemCaptureMessageBuilder.h"
+#include "Private/ConsoleBenchmark.h"
+
+#include "Public/Messages/DeepDriveCaptureMessage.h"
+#include "Public/DeepDriveData.h"
+
+/**
+	Publish captureBuffer as the only camera of a message built into message, returns the camera or 0 if it didn't fit
+*/
+static const DeepDriveCaptureCamera* buildMessage(CaptureBuffer &captureBuffer, TArray<uint8> &message)
+{
+	FMemory::Memzero(message.GetData(), message.Num());
+
+	SharedMemCaptureMessageBuilder messageBuilder(message.GetData(), message.Num());
+	messageBuilder.begin(FDeepDriveDataOut(), 0.0, 1);
+	messageBuilder.addCamera(EDeepDriveCameraType::DDC_CAMERA_FRONT, 1, captureBuffer);
+	messageBuilder.flush();
+
+	const DeepDriveCaptureMessage *captureMessage = reinterpret_cast<const DeepDriveCaptureMessage*> (message.GetData());
+	return captureMessage->num_cameras == 1 ? &captureMessage->cameras[0] : 0;
+}
+
+/**
+	Checks that captures packed on the render thread are published bit-exactly like unpacked captures converted by the shared memory sink,
+	for every output format available to packed captures. Run from the console with
+	DeepDrive.CheckCapturePacking [Width] [Height] [DownscaleFactor]
+	Source data is random half float color including negative values, values above 1 and NaN, with depth values exceeding the 16 bit range.
+*/
+static void checkCapturePacking(const TArray<FString> &args)
+{
+	ConsoleBenchmark benchmark(TEXT("DeepDrive.CheckCapturePacking"), args);
+	const uint32 srcWidth = benchmark.getIntArg(0, 640);
+	const uint32 srcHeight = benchmark.getIntArg(1, 480);
+	const uint32 factor = benchmark.getIntArg(2, 1);
+	const uint32 width = FMath::Max(srcWidth / factor, 1u);
+	const uint32 height = FMath::Max(srcHeight / factor, 1u);
+	const uint32 srcStride = srcWidth * 4 * sizeof(FFloat16);
+
+	FRandomStream random(0x0DEE9D83);
+
+	TArray<FFloat16> src;
+	src.SetNumUninitialized(srcWidth * srcHeight * 4);
+	for(int32 i = 0; i < src.Num(); ++i)
+	{
+		if((i & 3) == 3)
+			src[i].Set(random.FRandRange(-10.0f, 70000.0f));
+		else
+			src[i].Encoded = static_cast<uint16> (random.RandHelper(65536));
+	}
+
+	CaptureBufferPool captureBufferPool;
+
+	// unpacked capture as the readback ring copies it, keeping every factor-th pixel of every factor-th row
+	CaptureBuffer *unpacked = captureBufferPool.acquire(PF_FloatRGBA, width, height, width * 4 * sizeof(FFloat16));
+	CaptureBuffer *packed = captureBufferPool.acquire(PF_B8G8R8A8, width, height, width * CapturePacking::BytesPerColorValue, width * CapturePacking::BytesPerDepthValue);
+	if(unpacked == 0 || packed == 0)
+	{
+		UE_LOG(LogDeepDriveBenchmark, Error, TEXT("Couldn't acquire capture buffers"));
+		if(unpacked)
+			unpacked->release();
+		if(packed)
+			packed->release();
+		return;
+	}
+
+	FFloat16 *unpackedDst = unpacked->getBuffer<FFloat16>();
+	for(uint32 y = 0; y < height; ++y)
+		for(uint32 x = 0; x < width; ++x)
+			FMemory::Memcpy(unpackedDst + (y * width + x) * 4, src.GetData() + (y * factor * srcWidth + x * factor) * 4, 4 * sizeof(FFloat16));
+
+	CapturePacking::packColorDepth(src.GetData(), srcStride * factor, width, height, packed->getBuffer<uint8>(), width * CapturePacking::BytesPerColorValue, packed->getDepthBuffer<uint16>(), width * CapturePacking::BytesPerDepthValue, factor);
+
+	const uint32 maxMessageSize = sizeof(DeepDriveCaptureMessage) + width * height * 8 + 64;
+	TArray<uint8> unpackedMessage;
+	TArray<uint8> packedMessage;
+	unpackedMessage.SetNumUninitialized(maxMessageSize);
+	packedMessage.SetNumUninitialized(maxMessageSize);
+
+	const EDeepDriveCaptureColorFormat colorFormats[] = { EDeepDriveCaptureColorFormat::RGB8, EDeepDriveCaptureColorFormat::Gray8 };
+	int32 numFailed = 0;
+	for(const EDeepDriveCaptureColorFormat colorFormat : colorFormats)
+	{
+		unpacked->setOutputFormat(colorFormat, EDeepDriveCaptureDepthFormat::UInt16Centimeters);
+		packed->setOutputFormat(colorFormat, EDeepDriveCaptureDepthFormat::UInt16Centimeters);
+
+		const DeepDriveCaptureCamera *unpackedCam = buildMessage(*unpacked, unpackedMessage);
+		const DeepDriveCaptureCamera *packedCam = buildMessage(*packed, packedMessage);
+
+		const bool isEqual	=	unpackedCam
+							&&	packedCam
+							&&	unpackedCam->color_format == packedCam->color_format
+							&&	unpackedCam->depth_format == packedCam->depth_format
+							&&	unpackedCam->bytes_per_pixel == packedCam->bytes_per_pixel
+							&&	unpackedCam->depth_offset == packedCam->depth_offset
+							&&	FMemory::Memcmp(unpackedCam->data, packedCam->data, unpackedCam->depth_offset + width * height * unpackedCam->bytes_per_depth_value) == 0;
+
+		if(!isEqual)
+			++numFailed;
+
+		UE_LOG	(	LogDeepDriveBenchmark, Log, TEXT("%dx%d downscaled by %d, color format %d: packed %s unpacked")
+				,	width, height, factor, static_cast<int32> (colorFormat), isEqual ? TEXT("matches") : TEXT("DOESN'T MATCH")
+				);
+	}
+
+	unpacked->release();
+	packed->release();
+
+	benchmark.logResult(numFailed == 0);
+}
+
+static FAutoConsoleCommand CheckCapturePackingCommand
+	(	TEXT("DeepDrive.CheckCapturePacking")
+	,	TEXT("Verify that packed captures are published bit-exactly like unpacked ones. Arguments: [Width] [Height] [DownscaleFactor]")
+	,	FConsoleCommandWithArgsDelegate::CreateStatic(&checkCapturePacking)
+	);
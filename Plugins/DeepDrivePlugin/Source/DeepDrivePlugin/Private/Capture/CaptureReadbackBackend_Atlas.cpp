@@ -0,0 +1,174 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/Capture/CaptureReadbackBackend_Atlas.h"
+
+#include "Public/Capture/CaptureDefines.h"
+#include "Private/Capture/CaptureJob.h"
+
+DEFINE_LOG_CATEGORY(LogCaptureReadbackBackend_Atlas);
+
+CaptureReadbackBackend_Atlas::CaptureReadbackBackend_Atlas(uint32 numSlots)
+{
+	m_Atlases.SetNum(numSlots);
+}
+
+CaptureReadbackBackend_Atlas::~CaptureReadbackBackend_Atlas()
+{
+}
+
+void CaptureReadbackBackend_Atlas::enqueueCopy(uint32 slotIndex, const SCaptureJob &job)
+{
+	SAtlas &atlas = m_Atlases[slotIndex];
+	atlas.has_data = false;
+	atlas.regions.Reset();
+	atlas.regions.SetNum(job.capture_requests.Num());
+
+	m_SourceTextures.Reset();
+	m_SourceTextures.SetNumZeroed(job.capture_requests.Num());
+	m_SourceRegions.Reset();
+	m_SourceRegions.SetNum(job.capture_requests.Num());
+
+	EPixelFormat pixelFormat = PF_Unknown;
+	uint32 atlasWidth = 0;
+	uint32 atlasHeight = 0;
+	uint32 curX = 0;
+	uint32 shelfY = 0;
+	uint32 shelfHeight = 0;
+
+	for(int32 i = 0; i < job.capture_requests.Num(); ++i)
+	{
+		const SCaptureRequest &captureReq = job.capture_requests[i];
+		FRHITexture2D *srcTexture = captureReq.capture_source && captureReq.capture_source->TextureRHI ? captureReq.capture_source->TextureRHI->GetTexture2D() : 0;
+		if(srcTexture == 0)
+			continue;
+
+		if(pixelFormat == PF_Unknown)
+			pixelFormat = srcTexture->GetFormat();
+		else if(srcTexture->GetFormat() != pixelFormat)
+		{
+			if(!m_hasReportedFormatMismatch)
+			{
+				UE_LOG(LogCaptureReadbackBackend_Atlas, Warning, TEXT("Camera %d doesn't match atlas pixel format, skipping it"), captureReq.camera_id);
+				m_hasReportedFormatMismatch = true;
+			}
+			continue;
+		}
+
+		const FIntRect srcRegion = captureReq.getSourceRegion(srcTexture->GetSizeX(), srcTexture->GetSizeY());
+		const uint32 width = srcRegion.Width();
+		const uint32 height = srcRegion.Height();
+
+		// start new shelf if tile doesn't fit anymore
+		if	(	curX > 0
+			&&	curX + width > MaxAtlasWidth
+			)
+		{
+			shelfY += shelfHeight;
+			curX = 0;
+			shelfHeight = 0;
+		}
+
+		SCaptureReadbackRegion &region = atlas.regions[i];
+		region.x = curX;
+		region.y = shelfY;
+		region.width = width;
+		region.height = height;
+
+		curX += width;
+		shelfHeight = FMath::Max(shelfHeight, height);
+		atlasWidth = FMath::Max(atlasWidth, curX);
+		atlasHeight = FMath::Max(atlasHeight, shelfY + shelfHeight);
+
+		m_SourceTextures[i] = srcTexture;
+		m_SourceRegions[i] = srcRegion;
+	}
+
+	if(atlasWidth == 0)
+		return;
+
+	if	(	!atlas.texture
+		||	atlas.texture->GetFormat() != pixelFormat
+		||	atlas.texture->GetSizeX() != atlasWidth
+		||	atlas.texture->GetSizeY() != atlasHeight
+		)
+	{
+		FRHIResourceCreateInfo createInfo;
+		atlas.texture = RHICreateTexture2D(atlasWidth, atlasHeight, pixelFormat, 1, 1, TexCreate_CPUReadback, createInfo);
+		UE_LOG(LogCaptureReadbackBackend_Atlas, Log, TEXT("Created atlas staging texture %d x %d for slot %d"), atlasWidth, atlasHeight, slotIndex);
+	}
+
+	if(atlas.texture)
+	{
+		for(int32 i = 0; i < m_SourceTextures.Num(); ++i)
+		{
+			if(m_SourceTextures[i])
+			{
+				const SCaptureReadbackRegion &region = atlas.regions[i];
+				const FIntRect &srcRegion = m_SourceRegions[i];
+				const FBox2D srcBox(FVector2D(srcRegion.Min.X, srcRegion.Min.Y), FVector2D(srcRegion.Max.X, srcRegion.Max.Y));
+				const FBox2D dstBox(FVector2D(region.x, region.y), FVector2D(region.x + region.width, region.y + region.height));
+				RHICopySubTextureRegion(m_SourceTextures[i], atlas.texture, srcBox, dstBox);
+			}
+		}
+		atlas.has_data = true;
+	}
+}
+
+const void* CaptureReadbackBackend_Atlas::map(uint32 slotIndex, uint32 requestIndex, SCaptureReadbackData &readbackData)
+{
+	// requests are only accessible through the shared atlas
+	return 0;
+}
+
+void CaptureReadbackBackend_Atlas::unmap(uint32 slotIndex, uint32 requestIndex)
+{
+}
+
+const void* CaptureReadbackBackend_Atlas::mapShared(uint32 slotIndex, SCaptureReadbackData &readbackData)
+{
+	void *data = 0;
+
+	SAtlas &atlas = m_Atlases[slotIndex];
+	if(atlas.has_data)
+	{
+		int32 width = 0;
+		int32 height = 0;
+		FRHICommandListExecutor::GetImmediateCommandList().MapStagingSurface(atlas.texture, data, width, height);
+
+		if(data)
+		{
+			// width returned by MapStagingSurface is the row pitch in pixels
+			readbackData.pixel_format = atlas.texture->GetFormat();
+			readbackData.width = atlas.texture->GetSizeX();
+			readbackData.height = atlas.texture->GetSizeY();
+			readbackData.stride = static_cast<uint32> (width) * GPixelFormats[readbackData.pixel_format].BlockBytes;
+			atlas.is_mapped = true;
+		}
+	}
+
+	return data;
+}
+
+bool CaptureReadbackBackend_Atlas::getRegion(uint32 slotIndex, uint32 requestIndex, SCaptureReadbackRegion &region) const
+{
+	const SAtlas &atlas = m_Atlases[slotIndex];
+	if	(	atlas.has_data
+		&&	static_cast<int32> (requestIndex) < atlas.regions.Num()
+		&&	atlas.regions[requestIndex].width > 0
+		)
+	{
+		region = atlas.regions[requestIndex];
+		return true;
+	}
+	return false;
+}
+
+void CaptureReadbackBackend_Atlas::unmapShared(uint32 slotIndex)
+{
+	SAtlas &atlas = m_Atlases[slotIndex];
+	if(atlas.is_mapped)
+	{
+		FRHICommandListExecutor::GetImmediateCommandList().UnmapStagingSurface(atlas.texture);
+		atlas.is_mapped = false;
+	}
+}
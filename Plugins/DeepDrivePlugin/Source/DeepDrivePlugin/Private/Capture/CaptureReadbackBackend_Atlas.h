@@ -0,0 +1,53 @@
+
+#pragma once
+
+#include "Private/Capture/ICaptureReadbackBackend.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogCaptureReadbackBackend_Atlas, Log, All);
+
+/**
+	Copies the render targets of all capture requests of a job into tiles of one staging texture per slot,
+	so a whole job is read back with a single map. Tiles are laid out on shelves of at most MaxAtlasWidth pixels.
+	All capture sources of a job must share the same pixel format, sources of other formats are skipped.
+*/
+class CaptureReadbackBackend_Atlas	:	public ICaptureReadbackBackend
+{
+	struct SAtlas
+	{
+		FTexture2DRHIRef					texture;
+		TArray<SCaptureReadbackRegion>		regions;
+		bool								has_data = false;
+		bool								is_mapped = false;
+	};
+
+public:
+
+	enum
+	{
+		MaxAtlasWidth = 4096
+	};
+
+	CaptureReadbackBackend_Atlas(uint32 numSlots);
+	virtual ~CaptureReadbackBackend_Atlas();
+
+	virtual void enqueueCopy(uint32 slotIndex, const SCaptureJob &job);
+
+	virtual const void* map(uint32 slotIndex, uint32 requestIndex, SCaptureReadbackData &readbackData);
+
+	virtual void unmap(uint32 slotIndex, uint32 requestIndex);
+
+	virtual const void* mapShared(uint32 slotIndex, SCaptureReadbackData &readbackData);
+
+	virtual bool getRegion(uint32 slotIndex, uint32 requestIndex, SCaptureReadbackRegion &region) const;
+
+	virtual void unmapShared(uint32 slotIndex);
+
+private:
+
+	TArray<SAtlas>					m_Atlases;
+	TArray<FRHITexture2D*>			m_SourceTextures;
+	TArray<FIntRect>				m_SourceRegions;
+
+	bool							m_hasReportedFormatMismatch = false;
+
+};
@@ -0,0 +1,69 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/Capture/CaptureReadbackBackend_CPU.h"
+
+#include "Public/Capture/CaptureDefines.h"
+#include "Private/Capture/CaptureJob.h"
+
+CaptureReadbackBackend_CPU::CaptureReadbackBackend_CPU(uint32 numSlots)
+{
+	m_StagingBuffers.SetNum(numSlots);
+}
+
+CaptureReadbackBackend_CPU::~CaptureReadbackBackend_CPU()
+{
+}
+
+void CaptureReadbackBackend_CPU::enqueueCopy(uint32 slotIndex, const SCaptureJob &job)
+{
+	StagingBuffers &stagingBuffers = m_StagingBuffers[slotIndex];
+	stagingBuffers.SetNum(job.capture_requests.Num());
+
+	for(int32 i = 0; i < job.capture_requests.Num(); ++i)
+	{
+		const SCaptureRequest &captureReq = job.capture_requests[i];
+		SStagingBuffer &stagingBuffer = stagingBuffers[i];
+
+		FIntPoint size = captureReq.capture_source ? captureReq.capture_source->GetSizeXY() : FIntPoint(DefaultWidth, DefaultHeight);
+		size.X = size.X > 0 ? size.X : DefaultWidth;
+		size.Y = size.Y > 0 ? size.Y : DefaultHeight;
+		const FIntRect region = captureReq.getSourceRegion(size.X, size.Y);
+		stagingBuffer.width = region.Width();
+		stagingBuffer.height = region.Height();
+
+		const uint32 bytesPerPixel = GPixelFormats[PF_FloatRGBA].BlockBytes;
+		stagingBuffer.data.SetNumUninitialized(stagingBuffer.width * stagingBuffer.height * bytesPerPixel);
+
+		uint8 *dst = stagingBuffer.data.GetData();
+		for(uint32 y = 0; y < stagingBuffer.height; ++y)
+			FMemory::Memset(dst + y * stagingBuffer.width * bytesPerPixel, static_cast<uint8> (y), stagingBuffer.width * bytesPerPixel);
+
+		uint32 *stamp = reinterpret_cast<uint32*> (dst);
+		stamp[0] = static_cast<uint32> (job.sequence_number);
+		stamp[1] = static_cast<uint32> (captureReq.camera_id);
+	}
+}
+
+const void* CaptureReadbackBackend_CPU::map(uint32 slotIndex, uint32 requestIndex, SCaptureReadbackData &readbackData)
+{
+	const void *data = 0;
+
+	StagingBuffers &stagingBuffers = m_StagingBuffers[slotIndex];
+	if(static_cast<int32> (requestIndex) < stagingBuffers.Num())
+	{
+		const SStagingBuffer &stagingBuffer = stagingBuffers[requestIndex];
+
+		readbackData.pixel_format = PF_FloatRGBA;
+		readbackData.width = stagingBuffer.width;
+		readbackData.height = stagingBuffer.height;
+		readbackData.stride = stagingBuffer.width * GPixelFormats[PF_FloatRGBA].BlockBytes;
+
+		data = stagingBuffer.data.GetData();
+	}
+
+	return data;
+}
+
+void CaptureReadbackBackend_CPU::unmap(uint32 slotIndex, uint32 requestIndex)
+{
+}
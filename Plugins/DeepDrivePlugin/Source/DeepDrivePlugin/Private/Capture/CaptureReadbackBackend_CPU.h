@@ -0,0 +1,43 @@
+
+#pragma once
+
+#include "Private/Capture/ICaptureReadbackBackend.h"
+
+/**
+	CPU stand-in for CaptureReadbackBackend_RHI, used when running without a GPU (i.e. -nullrhi).
+	Instead of copying the render target every staging buffer is filled with a test pattern whose first
+	pixel holds the sequence number and camera id of the request it was created for.
+*/
+class CaptureReadbackBackend_CPU	:	public ICaptureReadbackBackend
+{
+	struct SStagingBuffer
+	{
+		TArray<uint8>			data;
+		uint32					width = 0;
+		uint32					height = 0;
+	};
+
+	typedef TArray<SStagingBuffer>		StagingBuffers;
+
+public:
+
+	enum
+	{
+		DefaultWidth = 64,
+		DefaultHeight = 64
+	};
+
+	CaptureReadbackBackend_CPU(uint32 numSlots);
+	virtual ~CaptureReadbackBackend_CPU();
+
+	virtual void enqueueCopy(uint32 slotIndex, const SCaptureJob &job);
+
+	virtual const void* map(uint32 slotIndex, uint32 requestIndex, SCaptureReadbackData &readbackData);
+
+	virtual void unmap(uint32 slotIndex, uint32 requestIndex);
+
+private:
+
+	TArray<StagingBuffers>			m_StagingBuffers;
+
+};
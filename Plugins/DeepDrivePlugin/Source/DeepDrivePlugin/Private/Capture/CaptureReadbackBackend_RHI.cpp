@@ -0,0 +1,103 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/Capture/CaptureReadbackBackend_RHI.h"
+
+#include "Public/Capture/CaptureDefines.h"
+#include "Private/Capture/CaptureJob.h"
+
+DEFINE_LOG_CATEGORY(LogCaptureReadbackBackend_RHI);
+
+CaptureReadbackBackend_RHI::CaptureReadbackBackend_RHI(uint32 numSlots)
+{
+	m_StagingTextures.SetNum(numSlots);
+}
+
+CaptureReadbackBackend_RHI::~CaptureReadbackBackend_RHI()
+{
+}
+
+void CaptureReadbackBackend_RHI::enqueueCopy(uint32 slotIndex, const SCaptureJob &job)
+{
+	FRHICommandListImmediate &rhiCmdList = FRHICommandListExecutor::GetImmediateCommandList();
+
+	for(SStagingTexture &stagingTexture : m_StagingTextures[slotIndex])
+		stagingTexture.has_data = false;
+
+	for(int32 i = 0; i < job.capture_requests.Num(); ++i)
+	{
+		const SCaptureRequest &captureReq = job.capture_requests[i];
+		FRHITexture2D *srcTexture = captureReq.capture_source && captureReq.capture_source->TextureRHI ? captureReq.capture_source->TextureRHI->GetTexture2D() : 0;
+		if(srcTexture)
+		{
+			const FIntRect region = captureReq.getSourceRegion(srcTexture->GetSizeX(), srcTexture->GetSizeY());
+			SStagingTexture &stagingTexture = getStagingTexture(slotIndex, i, srcTexture->GetFormat(), region.Width(), region.Height());
+			if(stagingTexture.texture)
+			{
+				if(region == FIntRect(0, 0, srcTexture->GetSizeX(), srcTexture->GetSizeY()))
+					rhiCmdList.CopyToResolveTarget(srcTexture, stagingTexture.texture, true, FResolveParams());
+				else
+				{
+					// only read back the requested region
+					const FBox2D srcBox(FVector2D(region.Min.X, region.Min.Y), FVector2D(region.Max.X, region.Max.Y));
+					const FBox2D dstBox(FVector2D(0.0f, 0.0f), FVector2D(region.Width(), region.Height()));
+					RHICopySubTextureRegion(srcTexture, stagingTexture.texture, srcBox, dstBox);
+				}
+				stagingTexture.has_data = true;
+			}
+		}
+	}
+}
+
+const void* CaptureReadbackBackend_RHI::map(uint32 slotIndex, uint32 requestIndex, SCaptureReadbackData &readbackData)
+{
+	void *data = 0;
+
+	StagingTextures &stagingTextures = m_StagingTextures[slotIndex];
+	if(static_cast<int32> (requestIndex) < stagingTextures.Num() && stagingTextures[requestIndex].has_data)
+	{
+		FTexture2DRHIRef &stagingTexture = stagingTextures[requestIndex].texture;
+
+		int32 width = 0;
+		int32 height = 0;
+		FRHICommandListExecutor::GetImmediateCommandList().MapStagingSurface(stagingTexture, data, width, height);
+
+		if(data)
+		{
+			// width returned by MapStagingSurface is the row pitch in pixels
+			readbackData.pixel_format = stagingTexture->GetFormat();
+			readbackData.width = stagingTexture->GetSizeX();
+			readbackData.height = stagingTexture->GetSizeY();
+			readbackData.stride = static_cast<uint32> (width) * GPixelFormats[readbackData.pixel_format].BlockBytes;
+		}
+	}
+
+	return data;
+}
+
+void CaptureReadbackBackend_RHI::unmap(uint32 slotIndex, uint32 requestIndex)
+{
+	StagingTextures &stagingTextures = m_StagingTextures[slotIndex];
+	if(static_cast<int32> (requestIndex) < stagingTextures.Num() && stagingTextures[requestIndex].has_data)
+		FRHICommandListExecutor::GetImmediateCommandList().UnmapStagingSurface(stagingTextures[requestIndex].texture);
+}
+
+CaptureReadbackBackend_RHI::SStagingTexture& CaptureReadbackBackend_RHI::getStagingTexture(uint32 slotIndex, uint32 requestIndex, EPixelFormat pixelFormat, uint32 width, uint32 height)
+{
+	StagingTextures &stagingTextures = m_StagingTextures[slotIndex];
+	if(static_cast<int32> (requestIndex) >= stagingTextures.Num())
+		stagingTextures.SetNum(requestIndex + 1);
+
+	SStagingTexture &stagingTexture = stagingTextures[requestIndex];
+	if	(	!stagingTexture.texture
+		||	stagingTexture.texture->GetFormat() != pixelFormat
+		||	stagingTexture.texture->GetSizeX() != width
+		||	stagingTexture.texture->GetSizeY() != height
+		)
+	{
+		FRHIResourceCreateInfo createInfo;
+		stagingTexture.texture = RHICreateTexture2D(width, height, pixelFormat, 1, 1, TexCreate_CPUReadback, createInfo);
+		UE_LOG(LogCaptureReadbackBackend_RHI, Log, TEXT("Created staging texture %d x %d for slot %d request %d"), width, height, slotIndex, requestIndex);
+	}
+
+	return stagingTexture;
+}
@@ -0,0 +1,38 @@
+
+#pragma once
+
+#include "Private/Capture/ICaptureReadbackBackend.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogCaptureReadbackBackend_RHI, Log, All);
+
+/**
+	Copies capture render targets into CPU readable staging textures
+*/
+class CaptureReadbackBackend_RHI	:	public ICaptureReadbackBackend
+{
+	struct SStagingTexture
+	{
+		FTexture2DRHIRef		texture;
+		bool					has_data = false;
+	};
+
+	typedef TArray<SStagingTexture>		StagingTextures;
+
+public:
+
+	CaptureReadbackBackend_RHI(uint32 numSlots);
+	virtual ~CaptureReadbackBackend_RHI();
+
+	virtual void enqueueCopy(uint32 slotIndex, const SCaptureJob &job);
+
+	virtual const void* map(uint32 slotIndex, uint32 requestIndex, SCaptureReadbackData &readbackData);
+
+	virtual void unmap(uint32 slotIndex, uint32 requestIndex);
+
+private:
+
+	SStagingTexture& getStagingTexture(uint32 slotIndex, uint32 requestIndex, EPixelFormat pixelFormat, uint32 width, uint32 height);
+
+	TArray<StagingTextures>			m_StagingTextures;
+
+};
@@ -0,0 +1,202 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/Capture/CaptureReadbackRing.h"
+#include "Private/Capture/ICaptureReadbackBackend.h"
+
+#include "Public/Capture/CaptureDefines.h"
+#include "Private/Capture/CaptureJob.h"
+#include "Private/Capture/CaptureJobQueue.h"
+#include "Private/Capture/CaptureBuffer.h"
+#include "Private/Capture/CaptureBufferPool.h"
+#include "Private/Capture/CapturePacking.h"
+
+DEFINE_LOG_CATEGORY(LogCaptureReadbackRing);
+
+CaptureReadbackRing::CaptureReadbackRing(ICaptureReadbackBackend &backend, uint32 numSlots)
+	:	m_Backend(backend)
+{
+	numSlots = FMath::Clamp<uint32>(numSlots, MinSlots, MaxSlots);
+	m_Slots.SetNum(numSlots);
+
+	// map a slot just before it would be needed again
+	m_LatencyFrames = numSlots - 1;
+}
+
+void CaptureReadbackRing::issue(SCaptureJob &job)
+{
+	if(m_NumPending == getNumSlots())
+		completeOldest();
+
+	const uint32 slotIndex = (m_Head + m_NumPending) % getNumSlots();
+	SReadbackSlot &slot = m_Slots[slotIndex];
+
+	m_Backend.enqueueCopy(slotIndex, job);
+	slot.job = &job;
+	slot.issue_frame = m_curFrame;
+
+	++m_NumPending;
+}
+
+void CaptureReadbackRing::update()
+{
+	++m_curFrame;
+
+	while	(	m_NumPending > 0
+			&&	m_curFrame - m_Slots[m_Head].issue_frame >= m_LatencyFrames
+			)
+	{
+		completeOldest();
+	}
+}
+
+void CaptureReadbackRing::flush()
+{
+	while(m_NumPending > 0)
+		completeOldest();
+}
+
+void CaptureReadbackRing::completeOldest()
+{
+	SReadbackSlot &slot = m_Slots[m_Head];
+	SCaptureJob &job = *slot.job;
+
+	SCaptureReadbackData sharedData;
+	const void *sharedSrc = m_Backend.mapShared(m_Head, sharedData);
+	if(sharedSrc)
+	{
+		completeShared(job, sharedSrc, sharedData);
+		m_Backend.unmapShared(m_Head);
+	}
+	else
+	{
+		for(int32 i = 0; i < job.capture_requests.Num(); ++i)
+		{
+			SCaptureRequest &captureReq = job.capture_requests[i];
+
+			SCaptureReadbackData readbackData;
+			const void *src = m_Backend.map(m_Head, i, readbackData);
+			if(src)
+			{
+				captureReq.capture_buffer = copyCapture(job, captureReq, src, readbackData);
+				m_Backend.unmap(m_Head, i);
+			}
+		}
+	}
+
+	if(job.sequence_number <= m_lastSequenceNumber)
+		UE_LOG(LogCaptureReadbackRing, Warning, TEXT("Readback out of order, sequence number %d after %d"), job.sequence_number, m_lastSequenceNumber);
+	m_lastSequenceNumber = job.sequence_number;
+
+	slot.job = 0;
+	m_Head = (m_Head + 1) % getNumSlots();
+	--m_NumPending;
+
+	// job may be delivered and recycled as soon as it is queued
+	FEvent *resultEvent = job.result_event;
+	job.result_queue->enqueue(&job);
+	if(resultEvent)
+		resultEvent->Trigger();
+}
+
+void CaptureReadbackRing::completeShared(SCaptureJob &job, const void *src, const SCaptureReadbackData &sharedData)
+{
+	const uint32 bytesPerPixel = GPixelFormats[sharedData.pixel_format].BlockBytes;
+
+	// the whole shared surface is copied once, requests which don't need packing or downscaling just get a view onto it
+	CaptureBuffer *sharedBuffer = 0;
+
+	for(int32 i = 0; i < job.capture_requests.Num(); ++i)
+	{
+		SCaptureReadbackRegion region;
+		if(!m_Backend.getRegion(m_Head, i, region))
+			continue;
+
+		SCaptureRequest &captureReq = job.capture_requests[i];
+		if	(	captureReq.pack_color_depth
+			||	captureReq.downscale_factor > 1
+			)
+		{
+			SCaptureReadbackData regionData = sharedData;
+			regionData.width = region.width;
+			regionData.height = region.height;
+			const void *regionSrc = reinterpret_cast<const uint8*> (src) + region.y * sharedData.stride + region.x * bytesPerPixel;
+
+			captureReq.capture_buffer = copyCapture(job, captureReq, regionSrc, regionData);
+		}
+		else
+		{
+			if(sharedBuffer == 0)
+			{
+				// requests which are packed or downscaled don't need the shared buffer, so they are still copied if it isn't available
+				sharedBuffer = job.capture_buffer_pool->acquire(sharedData.pixel_format, sharedData.width, sharedData.height, sharedData.stride);
+				if(sharedBuffer == 0)
+					continue;
+
+				FMemory::BigBlockMemcpy(sharedBuffer->getBuffer<void>(), src, sharedBuffer->getBufferSize());
+			}
+
+			captureReq.capture_buffer = sharedBuffer->createView(region.x, region.y, region.width, region.height);
+			captureReq.capture_buffer->setSourceGeometry(captureReq.capture_region.Min, 1);
+			captureReq.capture_buffer->setOutputFormat(captureReq.color_format, captureReq.depth_format);
+		}
+	}
+}
+
+CaptureBuffer* CaptureReadbackRing::copyCapture(SCaptureJob &job, const SCaptureRequest &captureReq, const void *src, const SCaptureReadbackData &readbackData)
+{
+	// downscaling keeps every factor-th pixel of every factor-th row
+	const uint32 factor = FMath::Max(captureReq.downscale_factor, 1u);
+	const uint32 width = FMath::Max(readbackData.width / factor, 1u);
+	const uint32 height = FMath::Max(readbackData.height / factor, 1u);
+	const uint32 srcStride = readbackData.stride * factor;
+
+	CaptureBuffer *captureBuffer = 0;
+	if	(	captureReq.pack_color_depth
+		&&	readbackData.pixel_format == PF_FloatRGBA
+		)
+	{
+		const uint32 colorStride = width * CapturePacking::BytesPerColorValue;
+		const uint32 depthStride = width * CapturePacking::BytesPerDepthValue;
+		captureBuffer = job.capture_buffer_pool->acquire(PF_B8G8R8A8, width, height, colorStride, depthStride);
+		if(captureBuffer)
+		{
+			CapturePacking::packColorDepth(src, srcStride, width, height, captureBuffer->getBuffer<uint8>(), colorStride, captureBuffer->getDepthBuffer<uint16>(), depthStride, factor);
+		}
+	}
+	else if(factor == 1)
+	{
+		captureBuffer = job.capture_buffer_pool->acquire(readbackData.pixel_format, readbackData.width, readbackData.height, readbackData.stride);
+		if(captureBuffer)
+		{
+			// stride of staging data and capture buffer match, so rows can be copied in one go
+			FMemory::BigBlockMemcpy(captureBuffer->getBuffer<void>(), src, captureBuffer->getBufferSize());
+		}
+	}
+	else
+	{
+		const uint32 bytesPerPixel = GPixelFormats[readbackData.pixel_format].BlockBytes;
+		captureBuffer = job.capture_buffer_pool->acquire(readbackData.pixel_format, width, height, width * bytesPerPixel);
+		if(captureBuffer)
+		{
+			uint8 *dst = captureBuffer->getBuffer<uint8>();
+			for(uint32 y = 0; y < height; ++y)
+			{
+				const uint8 *srcRow = reinterpret_cast<const uint8*> (src) + y * srcStride;
+				for(uint32 x = 0; x < width; ++x)
+				{
+					FMemory::Memcpy(dst, srcRow, bytesPerPixel);
+					dst += bytesPerPixel;
+					srcRow += factor * bytesPerPixel;
+				}
+			}
+		}
+	}
+
+	if(captureBuffer)
+	{
+		captureBuffer->setSourceGeometry(captureReq.capture_region.Min, factor);
+		captureBuffer->setOutputFormat(captureReq.color_format, captureReq.depth_format);
+	}
+
+	return captureBuffer;
+}
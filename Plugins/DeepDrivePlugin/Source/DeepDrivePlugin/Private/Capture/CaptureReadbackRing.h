@@ -0,0 +1,84 @@
+
+#pragma once
+
+#include "Engine.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogCaptureReadbackRing, Log, All);
+
+class ICaptureReadbackBackend;
+class CaptureBuffer;
+struct SCaptureJob;
+struct SCaptureRequest;
+struct SCaptureReadbackData;
+
+/**
+	Ring of readback slots. A capture job occupies one slot from the moment its copies are issued until
+	its staging data gets mapped latencyFrames later. Jobs are completed strictly in the order they were issued.
+	All methods must be called on the render thread.
+*/
+class CaptureReadbackRing
+{
+	struct SReadbackSlot
+	{
+		SCaptureJob				*job = 0;
+		uint32					issue_frame = 0;
+	};
+
+public:
+
+	enum
+	{
+		MinSlots = 2,
+		MaxSlots = 4
+	};
+
+	CaptureReadbackRing(ICaptureReadbackBackend &backend, uint32 numSlots);
+
+	/**
+		Issue copies for job, if no slot is free the oldest pending job is completed first
+	*/
+	void issue(SCaptureJob &job);
+
+	/**
+		Advance one frame and complete all pending jobs whose latency has elapsed
+	*/
+	void update();
+
+	/**
+		Complete all pending jobs regardless of their latency
+	*/
+	void flush();
+
+	uint32 getNumSlots() const;
+	uint32 getNumPending() const;
+
+private:
+
+	void completeOldest();
+
+	void completeShared(SCaptureJob &job, const void *src, const SCaptureReadbackData &sharedData);
+
+	CaptureBuffer* copyCapture(SCaptureJob &job, const SCaptureRequest &captureReq, const void *src, const SCaptureReadbackData &readbackData);
+
+	ICaptureReadbackBackend			&m_Backend;
+
+	TArray<SReadbackSlot>			m_Slots;
+	uint32							m_LatencyFrames = 1;
+
+	uint32							m_Head = 0;
+	uint32							m_NumPending = 0;
+	uint32							m_curFrame = 0;
+
+	int32							m_lastSequenceNumber = 0;
+};
+
+
+inline uint32 CaptureReadbackRing::getNumSlots() const
+{
+	return static_cast<uint32> (m_Slots.Num());
+}
+
+inline uint32 CaptureReadbackRing::getNumPending() const
+{
+	return m_NumPending;
+}
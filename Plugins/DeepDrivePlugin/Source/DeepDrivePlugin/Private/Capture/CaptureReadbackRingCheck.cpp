@@ -0,0 +1,158 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/Capture/CaptureReadbackRing.h"
+#include "Private/Capture/CaptureReadbackBackend_CPU.h"
+
+#include "Public/Capture/CaptureDefines.h"
+#include "Private/Capture/CaptureJob.h"
+#include "Private/Capture/CaptureJobQueue.h"
+#include "Private/Capture/CaptureBuffer.h"
+#include "Private/Capture/CaptureBufferPool.h"
+#include "Private/ConsoleBenchmark.h"
+
+struct SReadbackRingCheckData
+{
+	CaptureReadbackRing			*readback_ring = 0;
+	TArray<SCaptureJob>			*jobs = 0;
+	uint32						num_slots = 0;
+	uint32						max_pending = 0;
+	bool						slots_exceeded = false;
+};
+
+/**
+	Issue jobs in bursts of random size, so the ring completes jobs both by latency and because it runs out of slots
+*/
+static void issueReadbackJobs(SReadbackRingCheckData &checkData)
+{
+	FRandomStream random(0x0DEE9D01);
+
+	TArray<SCaptureJob> &jobs = *checkData.jobs;
+	int32 i = 0;
+	while(i < jobs.Num())
+	{
+		const int32 burst = FMath::Min(random.RandRange(0, checkData.num_slots + 1), jobs.Num() - i);
+		for(int32 j = 0; j < burst; ++j, ++i)
+		{
+			checkData.readback_ring->issue(jobs[i]);
+
+			const uint32 numPending = checkData.readback_ring->getNumPending();
+			checkData.max_pending = FMath::Max(checkData.max_pending, numPending);
+			checkData.slots_exceeded |= numPending > checkData.num_slots;
+		}
+
+		checkData.readback_ring->update();
+	}
+
+	checkData.readback_ring->flush();
+}
+
+/**
+	Checks that the readback ring hands jobs to the result queue strictly in issue order, each request holding the data read back for it.
+	Runs the ring on the CPU backend, which stamps every staging buffer with sequence number and camera id. Run from the console with
+	DeepDrive.CheckReadbackRing [NumSlots] [NumJobs] [NumCameras]
+*/
+static void checkReadbackRing(const TArray<FString> &args)
+{
+	ConsoleBenchmark benchmark(TEXT("DeepDrive.CheckReadbackRing"), args);
+	const uint32 numSlots = FMath::Clamp<uint32>(benchmark.getIntArg(0, CaptureReadbackRing::MaxSlots), CaptureReadbackRing::MinSlots, CaptureReadbackRing::MaxSlots);
+	const int32 numJobs = benchmark.getIntArg(1, 1000);
+	const int32 numCameras = benchmark.getIntArg(2, 2);
+
+	CaptureBufferPool captureBufferPool;
+	CaptureJobQueue resultQueue;
+	CaptureReadbackBackend_CPU readbackBackend(numSlots);
+	CaptureReadbackRing readbackRing(readbackBackend, numSlots);
+
+	TArray<SCaptureJob> jobs;
+	jobs.SetNum(numJobs);
+	for(int32 i = 0; i < numJobs; ++i)
+	{
+		SCaptureJob &job = jobs[i];
+		job.sequence_number = i + 1;
+		job.capture_buffer_pool = &captureBufferPool;
+		job.readback_ring = &readbackRing;
+		job.result_queue = &resultQueue;
+
+		for(int32 j = 0; j < numCameras; ++j)
+		{
+			SCaptureRequest &captureReq = job.capture_requests[job.capture_requests.AddDefaulted()];
+			captureReq.camera_type = EDeepDriveCameraType::DDC_CAMERA_FRONT;
+			captureReq.camera_id = j + 1;
+		}
+	}
+
+	SReadbackRingCheckData checkData;
+	checkData.readback_ring = &readbackRing;
+	checkData.jobs = &jobs;
+	checkData.num_slots = numSlots;
+
+	// the ring must only be used on the render thread
+	ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER
+	(
+		CheckCaptureReadbackRing, SReadbackRingCheckData*, checkDataPtr, &checkData,
+		{
+			issueReadbackJobs(*checkDataPtr);
+		}
+	);
+	FlushRenderingCommands();
+
+	int32 numDelivered = 0;
+	int32 numOutOfOrder = 0;
+	int32 numMismatched = 0;
+	int32 numMissing = 0;
+	int32 lastSequenceNumber = 0;
+
+	SCaptureJob *job = 0;
+	while(resultQueue.dequeue(job))
+	{
+		++numDelivered;
+		if(job->sequence_number != lastSequenceNumber + 1)
+		{
+			if(numOutOfOrder == 0)
+				UE_LOG(LogDeepDriveBenchmark, Error, TEXT("Sequence number %d delivered after %d"), job->sequence_number, lastSequenceNumber);
+			++numOutOfOrder;
+		}
+		lastSequenceNumber = job->sequence_number;
+
+		for(SCaptureRequest &captureReq : job->capture_requests)
+		{
+			if(captureReq.capture_buffer == 0)
+			{
+				++numMissing;
+				continue;
+			}
+
+			// stamp written by the CPU backend into the first pixel
+			const uint32 *stamp = captureReq.capture_buffer->getBuffer<uint32>();
+			if	(	stamp[0] != static_cast<uint32> (job->sequence_number)
+				||	stamp[1] != static_cast<uint32> (captureReq.camera_id)
+				)
+			{
+				if(numMismatched == 0)
+					UE_LOG(LogDeepDriveBenchmark, Error, TEXT("Job %d camera %d holds data of job %u camera %u"), job->sequence_number, captureReq.camera_id, stamp[0], stamp[1]);
+				++numMismatched;
+			}
+
+			captureReq.capture_buffer->release();
+			captureReq.capture_buffer = 0;
+		}
+	}
+
+	const bool passed	=	numDelivered == numJobs
+						&&	numOutOfOrder == 0
+						&&	numMismatched == 0
+						&&	numMissing == 0
+						&&	!checkData.slots_exceeded
+						&&	readbackRing.getNumPending() == 0;
+
+	UE_LOG	(	LogDeepDriveBenchmark, Log, TEXT("%d slots, %d jobs with %d cameras: %d delivered, %d out of order, %d mismatched, %d without buffer, max %u pending")
+			,	numSlots, numJobs, numCameras, numDelivered, numOutOfOrder, numMismatched, numMissing, checkData.max_pending
+			);
+	benchmark.logResult(passed);
+}
+
+static FAutoConsoleCommand CheckReadbackRingCommand
+	(	TEXT("DeepDrive.CheckReadbackRing")
+	,	TEXT("Verify that the readback ring delivers captures in order on the CPU backend. Arguments: [NumSlots] [NumJobs] [NumCameras]")
+	,	FConsoleCommandWithArgsDelegate::CreateStatic(&checkReadbackRing)
+	);
@@ -4,15 +4,25 @@
 
 #include "Public/Capture/CaptureDefines.h"
 #include "Private/Capture/CaptureJob.h"
+#include "Private/Capture/CaptureBuffer.h"
+#include "Private/Capture/CaptureReadbackRing.h"
+#include "Private/Capture/CaptureDispatcher.h"
+#include "Private/Capture/CaptureReadbackBackend_RHI.h"
+#include "Private/Capture/CaptureReadbackBackend_Atlas.h"
+#include "Private/Capture/CaptureReadbackBackend_CPU.h"
 
 #include "Public/Capture/CaptureCameraComponent.h"
 #include "Public/Capture/DeepDriveCaptureProxy.h"
 #include "Public/CaptureSink/CaptureSinkComponentBase.h"
+#include "Public/CaptureSink/SharedMemSink/SharedMemCaptureSinkComponent.h"
 
 DEFINE_LOG_CATEGORY(LogDeepDriveCapture);
 
 
 DeepDriveCapture* DeepDriveCapture::theInstance = 0;
+TArray<DeepDriveCapture*> DeepDriveCapture::theContexts;
+FCriticalSection DeepDriveCapture::theContextsMutex;
+bool DeepDriveCapture::theLockstepMode = false;
 float DeepDriveCapture::m_TotalCaptureTime = 0.0f;
 float DeepDriveCapture::m_CaptureCount = 0.0f;
 double DeepDriveCapture::m_lastLoggingTimestamp = 0.0;
@@ -30,13 +40,84 @@ DeepDriveCapture& DeepDriveCapture::GetInstance()
 
 void DeepDriveCapture::Destroy()
 {
+	{
+		FScopeLock lock(&theContextsMutex);
+		theContexts.Remove(theInstance);
+	}
 	delete theInstance;
 	theInstance = 0;
 }
 
+DeepDriveCapture* DeepDriveCapture::CreateContext(ADeepDriveCaptureProxy &proxy)
+{
+	DeepDriveCapture *context = &GetInstance();
+	if(context->m_Proxy)
+		context = new DeepDriveCapture;
+
+	context->RegisterProxy(proxy);
+	context->m_isLockstepMode = theLockstepMode;
+	{
+		FScopeLock lock(&theContextsMutex);
+		theContexts.Add(context);
+	}
+
+	UE_LOG(LogDeepDriveCapture, Log, TEXT("Created capture context for [%s], %d contexts active"), *(proxy.GetFullName()), theContexts.Num());
+
+	return context;
+}
+
+void DeepDriveCapture::DestroyContext(DeepDriveCapture *context, ADeepDriveCaptureProxy &proxy)
+{
+	if(context)
+	{
+		context->UnregisterProxy(proxy);
+		{
+			FScopeLock lock(&theContextsMutex);
+			theContexts.Remove(context);
+			context->m_SharedMemoryName.Empty();
+			context->m_SharedMemorySize = 0;
+		}
+
+		if(context != theInstance)
+			delete context;
+	}
+}
+
+bool DeepDriveCapture::GetSharedMemory(uint32 contextIndex, FString &name, uint32 &maxSize)
+{
+	FScopeLock lock(&theContextsMutex);
+	const DeepDriveCapture *context = GetContext(contextIndex);
+	if	(	context == 0
+		||	context->m_SharedMemoryName.IsEmpty()
+		)
+		return false;
+
+	name = context->m_SharedMemoryName;
+	maxSize = context->m_SharedMemorySize;
+	return true;
+}
+
+void DeepDriveCapture::SetLockstepMode(bool enabled)
+{
+	theLockstepMode = enabled;
+	for(DeepDriveCapture *captureContext : theContexts)
+		captureContext->m_isLockstepMode = enabled;
+}
+
 
 DeepDriveCapture::DeepDriveCapture()
 {
+	m_JobDelivered = FGenericPlatformProcess::GetSynchEventFromPool(false);
+}
+
+DeepDriveCapture::~DeepDriveCapture()
+{
+	// jobs still on the render thread or waiting for delivery go back to the job pool before it is destroyed
+	destroyReadback();
+	if(m_InFlightJobCount.GetValue() != 0)
+		UE_LOG(LogDeepDriveCapture, Warning, TEXT("Destroying capture context with %d capture jobs in flight"), m_InFlightJobCount.GetValue());
+
+	FGenericPlatformProcess::ReturnSynchEventToPool(m_JobDelivered);
 }
 
 void DeepDriveCapture::RegisterProxy(ADeepDriveCaptureProxy &proxy)
@@ -45,23 +126,47 @@ void DeepDriveCapture::RegisterProxy(ADeepDriveCaptureProxy &proxy)
 
 	m_lastCaptureTS = FPlatformTime::Seconds();
 	m_Proxy = &proxy;
+
+	m_CaptureBufferPool.setMemoryMode(proxy.CaptureBufferMemory);
+	m_CaptureBufferPool.setMaxAllocatedBytes(static_cast<uint64> (FMath::Max(proxy.MaxCaptureBufferPoolMB, 0)) * 1024 * 1024);
+	m_nextCaptureBufferTrimTS = m_lastCaptureTS + CaptureBufferTrimInterval;
+	createReadback(proxy.ReadbackBufferCount, proxy.UseCaptureAtlas);
+
+	// cameras registered before the proxy couldn't reserve buffers without its settings
+	for (auto &captureCmp : m_CaptureComponentMap)
+		reserveCaptureBuffers(captureCmp.Value);
+
+	if(proxy.DispatchCapturesOnWorkerThread)
+		m_Dispatcher = new CaptureDispatcher(*this);
 }
 
 void DeepDriveCapture::UnregisterProxy(ADeepDriveCaptureProxy &proxy)
 {
 	if(&proxy == m_Proxy)
+	{
+		destroyReadback();
+		m_CaptureBufferPool.setAllocator(CaptureBufferAllocatorPtr());
 		m_Proxy = 0;
+
+		FScopeLock lock(&m_DeliverySettingsMutex);
+		m_DeliverySettings.sinks.Reset();
+	}
 }
 
 int32 DeepDriveCapture::RegisterCaptureComponent(UCaptureCameraComponent *captureComponent)
 {
 	const int32 id = m_nextCaptureId++;
 
-	m_CaptureComponentMap.Add(id, SCaptureComponentData(captureComponent));
+	SCaptureComponentData &componentData = m_CaptureComponentMap.Add(id, SCaptureComponentData(captureComponent, FPlatformTime::Seconds() + captureComponent->CapturePhase));
 
 	UE_LOG(LogDeepDriveCapture, Log, TEXT("Register CaptureCameraComponent with id %d"), id);
 
-	m_CycleTimings.Add(captureComponent->CameraType, SCycleTiming(FPlatformTime::Seconds()));
+	reserveCaptureBuffers(componentData);
+
+	if(!m_CycleTimings.Contains(captureComponent->CameraType))
+		m_CycleTimings.Add(captureComponent->CameraType, SCycleTiming(FPlatformTime::Seconds()));
+
+	rebuildCameraTypeIndex();
 	return id;
 }
 
@@ -69,140 +174,372 @@ void DeepDriveCapture::UnregisterCaptureComponent(int32 cameraId)
 {
 	if (m_CaptureComponentMap.Contains(cameraId))
 	{
-		UE_LOG(LogDeepDriveCapture, Log, TEXT("Unregisterws CaptureCameraComponent with id %d"), cameraId);
+		UE_LOG(LogDeepDriveCapture, Log, TEXT("Unregister CaptureCameraComponent with id %d"), cameraId);
+		unreserveCaptureBuffers(m_CaptureComponentMap[cameraId]);
 		m_CaptureComponentMap.Remove(cameraId);
+
+		rebuildCameraTypeIndex();
+	}
+
+}
+
+void DeepDriveCapture::reserveCaptureBuffers(SCaptureComponentData &componentData)
+{
+	UCaptureCameraComponent *captureComponent = componentData.capture_component;
+	if	(	m_Proxy
+		&&	m_Proxy->PrewarmCaptureBuffers
+		&&	captureComponent
+		)
+	{
+		// without packing or downscaling atlas captures share one buffer for all cameras, nothing to reserve per camera
+		const bool usesSharedBuffer = m_Proxy->UseCaptureAtlas && !captureComponent->PackColorAndDepth && captureComponent->DownscaleFactor <= 1;
+		const uint32 bufferSize = usesSharedBuffer ? 0 : captureComponent->getCaptureBufferSize();
+		if(bufferSize > 0)
+		{
+			// one buffer per capture in flight plus the one held by the sinks while the next one is filled
+			const int32 framesInFlight = m_Proxy->MaxInFlightCaptures > 0 ? m_Proxy->MaxInFlightCaptures : m_Proxy->ReadbackBufferCount;
+			const int32 bufferCount = framesInFlight + 1;
+
+			const double startTS = FPlatformTime::Seconds();
+			m_CaptureBufferPool.reserve(bufferSize, bufferCount);
+			componentData.reserved_buffer_size = bufferSize;
+			componentData.reserved_buffer_count = bufferCount;
+
+			UE_LOG(LogDeepDriveCapture, Log, TEXT("Reserved %d capture buffers of %d bytes for %s in %f ms"), bufferCount, bufferSize, *(captureComponent->GetName()), (FPlatformTime::Seconds() - startTS) * 1000.0);
+		}
 	}
+}
 
+void DeepDriveCapture::unreserveCaptureBuffers(SCaptureComponentData &componentData)
+{
+	if(componentData.reserved_buffer_count > 0)
+	{
+		m_CaptureBufferPool.unreserve(componentData.reserved_buffer_size, componentData.reserved_buffer_count);
+		componentData.reserved_buffer_count = 0;
+	}
+}
+
+void DeepDriveCapture::rebuildCameraTypeIndex()
+{
+	m_CameraTypeIndex.Empty();
+
+	for (auto &captureCmp : m_CaptureComponentMap)
+	{
+		UCaptureCameraComponent *captureComponent = captureCmp.Value.capture_component;
+		m_CameraTypeIndex.FindOrAdd(captureComponent->CameraType).Add(captureComponent);
+	}
 }
 
 void DeepDriveCapture::HandleCaptureResult()
 {
-	processFinishedJobs();
+	updateDeliverySettings();
+
+	if(m_ReadbackRing)
+	{
+		ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER
+		(
+			UpdateCaptureReadback, CaptureReadbackRing*, readbackRing, m_ReadbackRing,
+			{
+				readbackRing->update();
+			}
+		);
+	}
+
+	if(m_Dispatcher == 0)
+		processFinishedJobs();
+
+	trimCaptureBuffers();
+}
+
+void DeepDriveCapture::trimCaptureBuffers()
+{
+	const double now = FPlatformTime::Seconds();
+	if	(	m_Proxy
+		&&	now >= m_nextCaptureBufferTrimTS
+		)
+	{
+		m_CaptureBufferPool.setMaxAllocatedBytes(static_cast<uint64> (FMath::Max(m_Proxy->MaxCaptureBufferPoolMB, 0)) * 1024 * 1024);
+		m_CaptureBufferPool.trim(m_Proxy->CaptureBufferIdleTime);
+		m_nextCaptureBufferTrimTS = now + CaptureBufferTrimInterval;
+	}
 }
 
-void DeepDriveCapture::Capture()
+void DeepDriveCapture::Capture(bool captureUnscheduled)
 {
-	processCapturing();
+	processCapturing(captureUnscheduled);
 }
 
 void DeepDriveCapture::reset()
 {
+	SCaptureJob *job = 0;
+	while(m_FinishedJobs.dequeue(job))
+		releaseJob(job);
+
 	m_Proxy = 0;
 	m_nextSequenceNumber = 1;
+	m_SkippedFrameCount.Reset();
+	m_DeferredCaptureCount = 0;
+	m_InFlightJobCount.Reset();
+	m_lastDeliveredSequenceNumber.Reset();
+	m_RejectedCaptureCount = 0;
+
+	// cameras stay registered, they unregister themselves. Their buffers are reserved again for the next proxy's settings.
+	for (auto &captureCmp : m_CaptureComponentMap)
+		unreserveCaptureBuffers(captureCmp.Value);
+}
+
+void DeepDriveCapture::createReadback(uint32 numSlots, bool useAtlas)
+{
+	destroyReadback();
 
-	m_nextCaptureId = 1;
-	m_CaptureComponentMap.Empty();
-	m_FinishedJobs.Empty();
+	numSlots = FMath::Clamp<uint32>(numSlots, CaptureReadbackRing::MinSlots, CaptureReadbackRing::MaxSlots);
 
-	//m_CaptureBufferPool;
+	if(GUsingNullRHI)
+	{
+		m_ReadbackBackend = new CaptureReadbackBackend_CPU(numSlots);
+		UE_LOG(LogDeepDriveCapture, Log, TEXT("Running without RHI, using CPU readback with %d slots"), numSlots);
+	}
+	else if(useAtlas)
+	{
+		m_ReadbackBackend = new CaptureReadbackBackend_Atlas(numSlots);
+		UE_LOG(LogDeepDriveCapture, Log, TEXT("Using RHI atlas readback with %d slots"), numSlots);
+	}
+	else
+	{
+		m_ReadbackBackend = new CaptureReadbackBackend_RHI(numSlots);
+		UE_LOG(LogDeepDriveCapture, Log, TEXT("Using RHI readback with %d slots"), numSlots);
+	}
 
+	m_ReadbackRing = new CaptureReadbackRing(*m_ReadbackBackend, numSlots);
 }
 
-
-void DeepDriveCapture::processFinishedJobs()
+void DeepDriveCapture::destroyReadback()
 {
-	SCaptureJob *job = 0;
-	if (	m_FinishedJobs.Dequeue(job)
-		&&	job != 0
-	   )
+	if(m_ReadbackRing)
 	{
-		if(m_Proxy)
-		{
-			TArray<UCaptureSinkComponentBase*> &sinks =  m_Proxy->getSinks();
-
-			for(UCaptureSinkComponentBase* &sink : sinks)
+		// complete and destroy on render thread after all pending capture jobs have been issued
+		ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER
+		(
+			DestroyCaptureReadback, CaptureReadbackRing*, readbackRing, m_ReadbackRing, ICaptureReadbackBackend*, readbackBackend, m_ReadbackBackend,
 			{
-				sink->begin(job->timestamp, job->sequence_number, m_Proxy->getDeepDriveData());
+				readbackRing->flush();
+				delete readbackRing;
+				delete readbackBackend;
 			}
+		);
+		FlushRenderingCommands();
 
-			for(SCaptureRequest &captureReq : job->capture_requests)
-			{
-				CaptureBuffer *captureBuffer = captureReq.capture_buffer;
+		m_ReadbackRing = 0;
+		m_ReadbackBackend = 0;
+	}
 
-				if(captureBuffer)
-				{
-					for(UCaptureSinkComponentBase* &sink : sinks)
-					{
-						sink->setCaptureBuffer(captureReq.camera_id, captureReq.camera_type, *captureBuffer);
-					}
-				}
-			}
+	// the dispatcher might still be delivering jobs completed by the final flush, deleting it waits for that delivery.
+	// It is only deleted once the ring is gone, as jobs in the ring trigger its event.
+	delete m_Dispatcher;
+	m_Dispatcher = 0;
 
-			for(UCaptureSinkComponentBase* &sink : sinks)
-			{
-				sink->flush();
-			}
+	// jobs not delivered yet are released, the sinks are about to go away
+	SCaptureJob *job = 0;
+	while(m_FinishedJobs.dequeue(job))
+		releaseJob(job);
+}
 
-			for (SCaptureRequest &captureReq : job->capture_requests)
-			{
-				CaptureBuffer *captureBuffer = captureReq.capture_buffer;
+void DeepDriveCapture::releaseJob(SCaptureJob *job)
+{
+	if(job)
+	{
+		for (SCaptureRequest &captureReq : job->capture_requests)
+		{
+			CaptureBuffer *captureBuffer = captureReq.capture_buffer;
 
-				if (captureBuffer)
-					captureBuffer->release();
-			}
+			if (captureBuffer)
+				captureBuffer->release();
 		}
 
+		m_CaptureJobPool.release(job);
+
+		m_InFlightJobCount.Decrement();
+	}
+}
+
+
+void DeepDriveCapture::updateDeliverySettings()
+{
+	if(m_Proxy)
+	{
+		FScopeLock lock(&m_DeliverySettingsMutex);
+		m_DeliverySettings.drain_policy = m_Proxy->DrainPolicy;
+		m_DeliverySettings.max_delivered_captures = FMath::Max(m_Proxy->MaxDeliveredCapturesPerTick, 1);
+		m_DeliverySettings.sinks.Reset();
+		m_DeliverySettings.sinks.Append(m_Proxy->getSinks());
+
+		for(UCaptureSinkComponentBase *sink : m_DeliverySettings.sinks)
+			sink->updateSettings();
 	}
+}
 
-	delete job;
+void DeepDriveCapture::activateDeliverySettings()
+{
+	FScopeLock lock(&m_DeliverySettingsMutex);
+	m_ActiveDeliverySettings.drain_policy = m_DeliverySettings.drain_policy;
+	m_ActiveDeliverySettings.max_delivered_captures = m_DeliverySettings.max_delivered_captures;
+	m_ActiveDeliverySettings.sinks.Reset();
+	m_ActiveDeliverySettings.sinks.Append(m_DeliverySettings.sinks);
 }
 
-void DeepDriveCapture::processCapturing()
+void DeepDriveCapture::processFinishedJobs()
 {
-	SCaptureJob *captureJob = new SCaptureJob;
+	activateDeliverySettings();
 
-	const TArray< FCaptureCyle > &captureCycles = m_Proxy->CaptureCycles;
+	const EDeepDriveCaptureDrainPolicy drainPolicy = m_ActiveDeliverySettings.drain_policy;
 
-	if (captureCycles.Num())
+	SCaptureJob *job = 0;
+	if(drainPolicy == EDeepDriveCaptureDrainPolicy::DeliverLatest)
 	{
-		const FCaptureCyle &cycle = captureCycles[m_curCycleIndex];
-		m_curCycleIndex = (m_curCycleIndex + 1) % captureCycles.Num();
-		for (auto &type : cycle.Cameras)
+		SCaptureJob *latestJob = 0;
+		while	(	m_FinishedJobs.dequeue(job)
+				&&	job != 0
+				)
 		{
-			for (auto &captureCmp : m_CaptureComponentMap)
+			if(latestJob)
 			{
-				if (captureCmp.Value.capture_component->CameraType == type)
-				{
-					SCaptureRequest req;
-					if (captureCmp.Value.capture_component->capture(req))
-					{
-						captureJob->capture_requests.Add(req);
-
-						const UEnum* CamTypeEnum = FindObject<UEnum>(ANY_PACKAGE, TEXT("EDeepDriveCameraType"));
-
-						SCycleTiming &timing = m_CycleTimings[type];
-						const double now = FPlatformTime::Seconds();
-						float delta = static_cast<float>(now - timing.last_capture_timestamp);
-						timing.last_capture_timestamp = now;
-						timing.elapsed_capture_time += delta * 1000.0f;
-						timing.capture_count += 1.0f;
-
-						UE_LOG(LogDeepDriveCapture, Log, TEXT("[%f] Capturing type %s with average frequency %f"), now,  *(CamTypeEnum ? CamTypeEnum->GetEnumName(static_cast<uint8> (type)) : TEXT("<Invalid Enum>")), timing.elapsed_capture_time / timing.capture_count );
-					}
-					break;
-				}
+				releaseJob(latestJob);
+				m_SkippedFrameCount.Increment();
 			}
+			latestJob = job;
 		}
+
+		if(latestJob)
+			deliverJob(*latestJob);
 	}
 	else
 	{
-		for (auto &captureCmp : m_CaptureComponentMap)
+		// limiting deliveries only protects the game thread's frame time
+		const int32 maxJobs = drainPolicy == EDeepDriveCaptureDrainPolicy::DeliverUpToN && m_Dispatcher == 0 ? m_ActiveDeliverySettings.max_delivered_captures : MAX_int32;
+		int32 numDelivered = 0;
+		while	(	numDelivered < maxJobs
+				&&	m_FinishedJobs.dequeue(job)
+				&&	job != 0
+				)
 		{
-			SCaptureRequest req;
-			if (captureCmp.Value.capture_component->capture(req))
+			deliverJob(*job);
+			++numDelivered;
+		}
+	}
+}
+
+void DeepDriveCapture::deliverJob(SCaptureJob &job)
+{
+	// sinks are taken from the settings copied by processFinishedJobs, the proxy's properties aren't touched here
+	CaptureSinks &sinks = m_ActiveDeliverySettings.sinks;
+
+	for(UCaptureSinkComponentBase* &sink : sinks)
+	{
+		sink->begin(job.timestamp, job.sequence_number, job.deep_drive_data);
+	}
+
+	// every sink takes its own lease on the buffers, the job's reference is dropped below
+	for(SCaptureRequest &captureReq : job.capture_requests)
+	{
+		CaptureBuffer *captureBuffer = captureReq.capture_buffer;
+
+		if(captureBuffer)
+		{
+			for(UCaptureSinkComponentBase* &sink : sinks)
 			{
-				captureJob->capture_requests.Add(req);
+				sink->setCaptureBuffer(captureReq.camera_id, captureReq.camera_type, *captureBuffer);
 			}
 		}
 	}
 
+	for(UCaptureSinkComponentBase* &sink : sinks)
+	{
+		sink->flush();
+	}
+
+	m_lastDeliveredSequenceNumber.Set(job.sequence_number);
+	releaseJob(&job);
+	m_JobDelivered->Trigger();
+}
+
+bool DeepDriveCapture::IsScheduledCaptureDue() const
+{
+	const double now = FPlatformTime::Seconds();
+	for (auto &captureCmp : m_CaptureComponentMap)
+	{
+		if	(	captureCmp.Value.capture_component->CaptureRate > 0.0f
+			&&	now >= captureCmp.Value.next_capture_time
+			)
+			return true;
+	}
+	return false;
+}
+
+bool DeepDriveCapture::admitCapture()
+{
+	const int32 maxInFlight = m_Proxy->MaxInFlightCaptures;
+	const int32 maxBytesInUse = m_Proxy->MaxCaptureBufferBytesInUse;
+
+	int32 numInFlight = m_InFlightJobCount.GetValue();
+	if(maxInFlight > 0)
+	{
+		// captures queued in the slowest sink are still in flight
+		int32 maxPending = 0;
+		for(UCaptureSinkComponentBase *sink : m_Proxy->getSinks())
+			maxPending = FMath::Max(maxPending, sink->getPendingJobCount());
+		numInFlight += maxPending;
+	}
+
+	const uint64 bytesInUse = m_CaptureBufferPool.getUsedBytes();
+
+	const bool admitted =	(maxInFlight <= 0 || numInFlight < maxInFlight)
+						&&	(maxBytesInUse <= 0 || bytesInUse < static_cast<uint64> (maxBytesInUse));
+
+	if(!admitted)
+	{
+		++m_RejectedCaptureCount;
+		UE_LOG(LogDeepDriveCapture, Verbose, TEXT("Capture rejected, %d captures in flight, %llu bytes in use"), numInFlight, bytesInUse);
+	}
+
+	return admitted;
+}
+
+void DeepDriveCapture::processCapturing(bool captureUnscheduled)
+{
+	if	(	m_ReadbackRing == 0
+		||	!admitCapture()
+		)
+		return;
+
+	SCaptureJob *captureJob = m_CaptureJobPool.acquire();
+
+	const double now = FPlatformTime::Seconds();
+	uint32 readbackBytes = 0;
+
+	if(captureUnscheduled)
+		addUnscheduledCaptures(*captureJob, now, readbackBytes);
+
+	addScheduledCaptures(*captureJob, now, readbackBytes);
+
+	(void) issueCaptureJob(captureJob);
+}
+
+uint32 DeepDriveCapture::issueCaptureJob(SCaptureJob *captureJob)
+{
+	uint32 sequenceNumber = 0;
+
 	if	(	captureJob->capture_requests.Num() > 0
 		)
 	{
 		captureJob->timestamp = FPlatformTime::Seconds();
 		captureJob->sequence_number = m_nextSequenceNumber++;
+		sequenceNumber = captureJob->sequence_number;
+		m_InFlightJobCount.Increment();
 		captureJob->result_queue = &m_FinishedJobs;
+		captureJob->result_event = m_Dispatcher ? m_Dispatcher->getJobsFinishedEvent() : 0;
+		captureJob->deep_drive_data = m_Proxy->getDeepDriveData();
 		captureJob->capture_buffer_pool = &m_CaptureBufferPool;
+		captureJob->readback_ring = m_ReadbackRing;
 
 		// TypeName, ParamType1, ParamName1, ParamValue1, Code
 		ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER
@@ -231,40 +568,217 @@ void DeepDriveCapture::processCapturing()
 	}
 	else
 	{
-		delete captureJob;
+		m_CaptureJobPool.release(captureJob);
 	}
+
+	return sequenceNumber;
 }
 
+uint32 DeepDriveCapture::CaptureImmediately()
+{
+	uint32 sequenceNumber = 0;
 
-void DeepDriveCapture::executeCaptureJob(SCaptureJob &job)
+	if	(	m_Proxy
+		&&	m_ReadbackRing
+		)
+	{
+		m_Proxy->updateDeepDriveData();
+		updateDeliverySettings();
+
+		SCaptureJob *captureJob = m_CaptureJobPool.acquire();
+		for (auto &captureCmp : m_CaptureComponentMap)
+		{
+			SCaptureRequest req;
+			if (captureCmp.Value.capture_component->capture(req))
+				captureJob->capture_requests.Add(req);
+		}
+
+		sequenceNumber = issueCaptureJob(captureJob);
+
+		ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER
+		(
+			FlushCaptureReadback, CaptureReadbackRing*, readbackRing, m_ReadbackRing,
+			{
+				readbackRing->flush();
+			}
+		);
+		FlushRenderingCommands();
+
+		if(m_Dispatcher)
+			waitForDelivery(sequenceNumber);
+		else
+		{
+			activateDeliverySettings();
+
+			SCaptureJob *job = 0;
+			while	(	m_FinishedJobs.dequeue(job)
+					&&	job != 0
+					)
+			{
+				deliverJob(*job);
+			}
+		}
+
+		// clients reading shared memory expect the capture to be there once they are told about it
+		USharedMemCaptureSinkComponent *sharedMemSink = getSharedMemorySink();
+		if	(	sequenceNumber > 0
+			&&	sharedMemSink
+			&&	!sharedMemSink->waitForPublishing(sequenceNumber, DeliveryTimeout)
+			)
+			UE_LOG(LogDeepDriveCapture, Warning, TEXT("Capture %d not published within %d seconds"), sequenceNumber, static_cast<int32> (DeliveryTimeout));
+	}
+
+	return sequenceNumber;
+}
+
+void DeepDriveCapture::waitForDelivery(uint32 sequenceNumber)
 {
-	for(SCaptureRequest &captureReq : job.capture_requests)
+	const double timeoutTS = FPlatformTime::Seconds() + DeliveryTimeout;
+	while	(	sequenceNumber > 0
+			&&	static_cast<uint32> (m_lastDeliveredSequenceNumber.GetValue()) < sequenceNumber
+			)
 	{
-		FRHITexture2D *texture = captureReq.capture_source->TextureRHI->GetTexture2D();
+		// a delivery in between checking and waiting leaves the event signaled
+		const double remaining = timeoutTS - FPlatformTime::Seconds();
+		if	(	remaining <= 0.0
+			||	!m_JobDelivered->Wait(static_cast<uint32> (remaining * 1000.0) + 1)
+			)
+		{
+			if(static_cast<uint32> (m_lastDeliveredSequenceNumber.GetValue()) < sequenceNumber)
+				UE_LOG(LogDeepDriveCapture, Warning, TEXT("Capture %d not delivered within %d seconds"), sequenceNumber, static_cast<int32> (DeliveryTimeout));
+			break;
+		}
+	}
+}
 
-		EPixelFormat pixelFormat = texture->GetFormat();
-		uint32 width = texture->GetSizeX();
-		uint32 height = texture->GetSizeY();
+void DeepDriveCapture::addUnscheduledCaptures(SCaptureJob &captureJob, double now, uint32 &readbackBytes)
+{
+	const TArray< FCaptureCyle > &captureCycles = m_Proxy->CaptureCycles;
 
-		uint32 stride;
-		void *src = RHILockTexture2D(texture, 0, RLM_ReadOnly, stride, false);
+	if (captureCycles.Num())
+	{
+		const FCaptureCyle &cycle = captureCycles[m_curCycleIndex];
+		m_curCycleIndex = (m_curCycleIndex + 1) % captureCycles.Num();
 
-		CaptureBuffer *captureBuffer = job.capture_buffer_pool->acquire(pixelFormat, width, height, stride);
-		if(captureBuffer)
+		for (auto &type : cycle.Cameras)
 		{
-			FMemory::BigBlockMemcpy(captureBuffer->getBuffer<void>(), src, captureBuffer->getBufferSize());
+			const CaptureComponents *captureComponents = m_CameraTypeIndex.Find(type);
+			if(captureComponents == 0)
+				continue;
+
+			// a cycle entry captures the first camera of its type without an own capture rate, even if that capture fails
+			bool captured = false;
+			for (UCaptureCameraComponent *captureComponent : *captureComponents)
+			{
+				if(captureComponent->CaptureRate > 0.0f)
+					continue;
+
+				SCaptureRequest req;
+				if(captureComponent->capture(req))
+				{
+					captureJob.capture_requests.Add(req);
+					readbackBytes += captureComponent->getReadbackSize();
+					captured = true;
+				}
+				break;
+			}
+
+			SCycleTiming *timing = captured ? m_CycleTimings.Find(type) : 0;
+			if(timing)
+			{
+				timing->elapsed_capture_time += static_cast<float>(now - timing->last_capture_timestamp) * 1000.0f;
+				timing->capture_count += 1.0f;
+				timing->last_capture_timestamp = now;
+			}
 		}
-		RHIUnlockTexture2D(texture, 0, false);
 
-		// UE_LOG(LogDeepDriveCapture, Log, TEXT("Capturing %d x %d  %p"), width, height, texture);
+		if (now - m_lastCycleLoggingTimestamp > 10.0)
+		{
+			logCycleTimings();
+			m_lastCycleLoggingTimestamp = now;
+		}
+	}
+	else
+	{
+		for (auto &captureCmp : m_CaptureComponentMap)
+		{
+			UCaptureCameraComponent *captureComponent = captureCmp.Value.capture_component;
+			SCaptureRequest req;
+			if	(	captureComponent->CaptureRate <= 0.0f
+				&&	captureComponent->capture(req)
+				)
+			{
+				captureJob.capture_requests.Add(req);
+				readbackBytes += captureComponent->getReadbackSize();
+			}
+		}
+	}
+}
 
-		captureReq.capture_buffer = captureBuffer;
+void DeepDriveCapture::addScheduledCaptures(SCaptureJob &captureJob, double now, uint32 &readbackBytes)
+{
+	const uint32 readbackBudget = m_Proxy->MaxReadbackBytesPerFrame > 0 ? static_cast<uint32> (m_Proxy->MaxReadbackBytesPerFrame) : MAX_uint32;
+
+	m_DueCameras.Reset();
+	for (auto &captureCmp : m_CaptureComponentMap)
+	{
+		if	(	captureCmp.Value.capture_component->CaptureRate > 0.0f
+			&&	now >= captureCmp.Value.next_capture_time
+			)
+			m_DueCameras.Add(&captureCmp.Value);
+	}
+
+	// earliest deadline first, i.e. cameras running late are served first
+	m_DueCameras.Sort([](const SCaptureComponentData &lhs, const SCaptureComponentData &rhs) { return lhs.next_capture_time < rhs.next_capture_time; });
+
+	for (SCaptureComponentData *captureCmpData : m_DueCameras)
+	{
+		UCaptureCameraComponent *captureComponent = captureCmpData->capture_component;
+		const uint32 readbackSize = captureComponent->getReadbackSize();
+
+		// the first capture of a frame is always admitted, so a camera exceeding the budget on its own isn't starved
+		if	(	readbackBytes > 0
+			&&	readbackBytes + readbackSize > readbackBudget
+			)
+		{
+			++m_DeferredCaptureCount;
+			continue;
+		}
+
+		SCaptureRequest req;
+		if (captureComponent->capture(req))
+		{
+			captureJob.capture_requests.Add(req);
+			readbackBytes += readbackSize;
+		}
+
+		// advance to next deadline after now keeping the camera's phase
+		const double period = 1.0 / static_cast<double> (captureComponent->CaptureRate);
+		captureCmpData->next_capture_time += period * (FMath::FloorToDouble((now - captureCmpData->next_capture_time) / period) + 1.0);
 	}
+}
 
-	job.result_queue->Enqueue(&job);
+void DeepDriveCapture::executeCaptureJob(SCaptureJob &job)
+{
+	// copies are only issued here, job gets enqueued to result queue once its readback has landed
+	job.readback_ring->issue(job);
 }
 
 
+void DeepDriveCapture::logCycleTimings()
+{
+	if(UE_LOG_ACTIVE(LogDeepDriveCapture, Verbose))
+	{
+		const UEnum* CamTypeEnum = FindObject<UEnum>(ANY_PACKAGE, TEXT("EDeepDriveCameraType"));
+
+		for (auto &timing : m_CycleTimings)
+		{
+			if (timing.Value.capture_count > 0.0f)
+				UE_LOG(LogDeepDriveCapture, Verbose, TEXT("Capturing type %s with average interval %f msecs"), *(CamTypeEnum ? CamTypeEnum->GetEnumName(static_cast<uint8> (timing.Key)) : TEXT("<Invalid Enum>")), timing.Value.elapsed_capture_time / timing.Value.capture_count);
+		}
+	}
+}
+
 USharedMemCaptureSinkComponent* DeepDriveCapture::getSharedMemorySink()
 {
 	USharedMemCaptureSinkComponent *sharedMemSink = 0;
@@ -282,3 +796,31 @@ USharedMemCaptureSinkComponent* DeepDriveCapture::getSharedMemorySink()
 
 	return sharedMemSink;
 }
+
+void DeepDriveCapture::updateSharedMemory()
+{
+	USharedMemCaptureSinkComponent *sharedMemSink = getSharedMemorySink();
+
+	FScopeLock lock(&theContextsMutex);
+	m_SharedMemoryName = sharedMemSink ? sharedMemSink->getSharedMemoryName() : FString();
+	m_SharedMemorySize = sharedMemSink ? static_cast<uint32> (FMath::Max(sharedMemSink->MaxSharedMemSize, 0)) : 0;
+}
+
+static void dumpCaptureBufferPoolStatistics()
+{
+	for(DeepDriveCapture *captureContext : DeepDriveCapture::GetContexts())
+	{
+		SCaptureBufferPoolStatistics statistics;
+		captureContext->getCaptureBufferPool().getStatistics(statistics);
+
+		UE_LOG(LogDeepDriveCapture, Log, TEXT("Capture buffer pool: allocated %llu used %llu peak %llu limit %llu trimmed %llu failures %d"), statistics.allocated_bytes, statistics.used_bytes, statistics.peak_allocated_bytes, statistics.max_allocated_bytes, statistics.trimmed_bytes, statistics.allocation_failures);
+		for(const SCaptureBufferSlotStatistics &slot : statistics.slots)
+			UE_LOG(LogDeepDriveCapture, Log, TEXT("  SlotSize %d allocated %d in use %d peak %d"), slot.slot_size, slot.num_allocated, slot.num_in_use, slot.peak_in_use);
+	}
+}
+
+static FAutoConsoleCommand DumpCaptureBufferPoolStatisticsCommand
+	(	TEXT("DeepDrive.CaptureBufferPoolStats")
+	,	TEXT("Log capture buffer pool statistics of all capture contexts")
+	,	FConsoleCommandDelegate::CreateStatic(&dumpCaptureBufferPoolStatistics)
+	);
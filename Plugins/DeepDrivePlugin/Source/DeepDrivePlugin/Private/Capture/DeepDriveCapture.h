@@ -4,29 +4,49 @@
 #include "Engine.h"
 
 #include "Private/Capture/CaptureBufferPool.h"
+#include "Private/Capture/CaptureObjectPool.h"
+#include "Private/Capture/CaptureJobQueue.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogDeepDriveCapture, Log, All);
 
 class UCaptureCameraComponent;
+class UCaptureSinkComponentBase;
 class ADeepDriveCaptureProxy;
 struct SCaptureJob;
 class USharedMemCaptureSinkComponent;
-
+class ICaptureReadbackBackend;
+class CaptureReadbackRing;
+class CaptureDispatcher;
+
+/**
+	Capture context of a single capture proxy. Each context has its own cameras, sequence numbers,
+	capture buffer pool, readback and finished job queue. The first proxy registered uses the default context.
+*/
 class DeepDriveCapture
 {
+	friend class CaptureDispatcher;
+
 	struct SCaptureComponentData
 	{
-		SCaptureComponentData(UCaptureCameraComponent *captureCmp)
+		SCaptureComponentData(UCaptureCameraComponent *captureCmp, double nextCaptureTime)
 			:	capture_component(captureCmp)
+			,	next_capture_time(nextCaptureTime)
 		{
 
 		}
 
 		UCaptureCameraComponent			*capture_component = 0;
+		double							next_capture_time = 0.0;		// deadline for cameras with own capture rate
+		uint32							reserved_buffer_size = 0;
+		int32							reserved_buffer_count = 0;
 	};
 
 	typedef TMap<uint32, SCaptureComponentData>  CaptureComponentMap;
 
+	typedef TArray<UCaptureCameraComponent*>	CaptureComponents;
+	typedef TArray<UCaptureSinkComponentBase*>	CaptureSinks;
+	typedef TMap<EDeepDriveCameraType, CaptureComponents>	CameraTypeIndex;
+
 	struct SCycleTiming
 	{
 		SCycleTiming(double initialTS)
@@ -39,12 +59,53 @@ class DeepDriveCapture
 		float				capture_count = 0.0f;
 	};
 
+	/**
+		Proxy properties read while delivering captures, which may happen on the dispatcher's thread
+	*/
+	struct SDeliverySettings
+	{
+		EDeepDriveCaptureDrainPolicy	drain_policy = EDeepDriveCaptureDrainPolicy::DeliverAll;
+		int32							max_delivered_captures = 1;
+		CaptureSinks					sinks;
+	};
+
 public:
 
+	/**
+		Default context, i.e. the context of the first registered capture proxy
+	*/
 	static DeepDriveCapture& GetInstance();
 
 	static void Destroy();
 
+	/**
+		Create capture context for proxy, the default context is used if it isn't bound to a proxy yet
+	*/
+	static DeepDriveCapture* CreateContext(ADeepDriveCaptureProxy &proxy);
+
+	static void DestroyContext(DeepDriveCapture *context, ADeepDriveCaptureProxy &proxy);
+
+	/**
+		All contexts currently bound to a proxy, in the order they were created
+	*/
+	static const TArray<DeepDriveCapture*>& GetContexts();
+
+	/**
+		Context at contextIndex of GetContexts(), 0 if there is none
+	*/
+	static DeepDriveCapture* GetContext(uint32 contextIndex);
+
+	/**
+		Name and size of the shared memory captures of the context at contextIndex are published in, may be called on any thread.
+		Returns false if there is no such context or it has no shared memory sink.
+	*/
+	static bool GetSharedMemory(uint32 contextIndex, FString &name, uint32 &maxSize);
+
+	/**
+		Switch all contexts, including the ones created later on, into or out of lockstep mode
+	*/
+	static void SetLockstepMode(bool enabled);
+
 	void RegisterProxy(ADeepDriveCaptureProxy &proxy);
 
 	void UnregisterProxy(ADeepDriveCaptureProxy &proxy);
@@ -55,19 +116,92 @@ public:
 
 	void HandleCaptureResult();
 
-	void Capture();
+	/**
+		Capture all cameras with an own capture rate being due, plus all remaining cameras (respecting capture cycles) if captureUnscheduled is set
+	*/
+	void Capture(bool captureUnscheduled = true);
+
+	bool IsScheduledCaptureDue() const;
+
+	/**
+		Capture all cameras and wait until captured data has been handed to the sinks and published by the shared memory sink.
+		Returns sequence number of capture, 0 if nothing was captured.
+	*/
+	uint32 CaptureImmediately();
+
+	bool isLockstepMode() const;
 
 	USharedMemCaptureSinkComponent* getSharedMemorySink();
 
+	/**
+		Take over name and size of the proxy's shared memory sink for GetSharedMemory, called on the game thread once the sinks have begun play
+	*/
+	void updateSharedMemory();
+
+	uint32 getSkippedFrameCount() const;
+
+	uint32 getDeferredCaptureCount() const;
+
+	uint32 getRejectedCaptureCount() const;
+
+	CaptureBufferPool& getCaptureBufferPool();
+
 private:
 
+	enum
+	{
+		CaptureBufferTrimInterval = 1,		// seconds
+		DeliveryTimeout = 5					// seconds
+	};
+
+
 	DeepDriveCapture();
 
+	~DeepDriveCapture();
+
 	void reset();
 
+	void createReadback(uint32 numSlots, bool useAtlas);
+
+	void destroyReadback();
+
+	void releaseJob(SCaptureJob *job);
+
+	/**
+		Copy delivery settings of proxy and sinks, called on the game thread
+	*/
+	void updateDeliverySettings();
+
+	/**
+		Take over the latest delivery settings, called by the thread delivering jobs
+	*/
+	void activateDeliverySettings();
+
 	void processFinishedJobs();
 
-	void processCapturing();
+	void deliverJob(SCaptureJob &job);
+
+	void waitForDelivery(uint32 sequenceNumber);
+
+	bool admitCapture();
+
+	void processCapturing(bool captureUnscheduled);
+
+	uint32 issueCaptureJob(SCaptureJob *captureJob);
+
+	void addUnscheduledCaptures(SCaptureJob &captureJob, double now, uint32 &readbackBytes);
+
+	void addScheduledCaptures(SCaptureJob &captureJob, double now, uint32 &readbackBytes);
+
+	void rebuildCameraTypeIndex();
+
+	void logCycleTimings();
+
+	void trimCaptureBuffers();
+
+	void reserveCaptureBuffers(SCaptureComponentData &componentData);
+
+	void unreserveCaptureBuffers(SCaptureComponentData &componentData);
 
 	static void executeCaptureJob(SCaptureJob &job);
 
@@ -77,18 +211,82 @@ private:
 
 	int32							m_nextCaptureId = 1;
 	CaptureComponentMap				m_CaptureComponentMap;
+	CameraTypeIndex					m_CameraTypeIndex;
+	TArray<SCaptureComponentData*>	m_DueCameras;
+	uint32							m_DeferredCaptureCount = 0;
+
+	bool							m_isLockstepMode = false;
+
+	FString							m_SharedMemoryName;				// guarded by theContextsMutex
+	uint32							m_SharedMemorySize = 0;
 
-	TQueue<SCaptureJob*>			m_FinishedJobs;
+	CaptureObjectPool<SCaptureJob>	m_CaptureJobPool;
+	CaptureJobQueue					m_FinishedJobs;
+	FThreadSafeCounter				m_InFlightJobCount;				// issued but not yet delivered
+	uint32							m_RejectedCaptureCount = 0;
+	FThreadSafeCounter				m_SkippedFrameCount;
+	FThreadSafeCounter				m_lastDeliveredSequenceNumber;
+	FEvent							*m_JobDelivered = 0;			// signaled whenever a job has been handed to the sinks
+
+	FCriticalSection				m_DeliverySettingsMutex;
+	SDeliverySettings				m_DeliverySettings;				// written on the game thread
+	SDeliverySettings				m_ActiveDeliverySettings;		// copy used by the thread delivering jobs
+
+	CaptureDispatcher				*m_Dispatcher = 0;				// delivers finished jobs instead of the game thread if set
 
 	CaptureBufferPool				m_CaptureBufferPool;
+	double							m_nextCaptureBufferTrimTS = 0.0;
+
+	ICaptureReadbackBackend			*m_ReadbackBackend = 0;
+	CaptureReadbackRing				*m_ReadbackRing = 0;
 
 	int32							m_curCycleIndex = 0;
 	TMap<EDeepDriveCameraType, SCycleTiming>		m_CycleTimings;
 	double							m_lastCaptureTS = 0.0;
+	double							m_lastCycleLoggingTimestamp = 0.0;
 
 	static float					m_TotalCaptureTime;
 	static float					m_CaptureCount;
 	static double					m_lastLoggingTimestamp;
 
 	static DeepDriveCapture			*theInstance;
+	static TArray<DeepDriveCapture*>	theContexts;				// changed on the game thread only, under theContextsMutex
+	static FCriticalSection			theContextsMutex;
+	static bool						theLockstepMode;
 };
+
+
+inline uint32 DeepDriveCapture::getSkippedFrameCount() const
+{
+	return static_cast<uint32> (m_SkippedFrameCount.GetValue());
+}
+
+inline uint32 DeepDriveCapture::getDeferredCaptureCount() const
+{
+	return m_DeferredCaptureCount;
+}
+
+inline bool DeepDriveCapture::isLockstepMode() const
+{
+	return m_isLockstepMode;
+}
+
+inline uint32 DeepDriveCapture::getRejectedCaptureCount() const
+{
+	return m_RejectedCaptureCount;
+}
+
+inline const TArray<DeepDriveCapture*>& DeepDriveCapture::GetContexts()
+{
+	return theContexts;
+}
+
+inline DeepDriveCapture* DeepDriveCapture::GetContext(uint32 contextIndex)
+{
+	return contextIndex < static_cast<uint32> (theContexts.Num()) ? theContexts[contextIndex] : 0;
+}
+
+inline CaptureBufferPool& DeepDriveCapture::getCaptureBufferPool()
+{
+	return m_CaptureBufferPool;
+}
@@ -22,31 +22,10 @@ void ADeepDriveCaptureProxy::PreInitializeComponents()
 {
 	Super::PreInitializeComponents();
 
-	bool alreadyRegistered = false;
-	TArray<AActor*> proxies;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), TSubclassOf<ADeepDriveCaptureProxy>(), proxies );
-	for(auto &actor : proxies)
-	{
-		ADeepDriveCaptureProxy *proxy = Cast<ADeepDriveCaptureProxy> (actor);
-		if	(	proxy
-			&&	proxy != this
-			)
-		{
-			if(proxy->m_isActive)
-			{
-				alreadyRegistered = true;
-				UE_LOG(LogDeepDriveCapture, Log, TEXT("Another Capture Proxy [%s] is already registered"), *(proxy->GetFullName()));
-				break;
-			}
-		}
-	}
-
-	if(!alreadyRegistered)
-	{
-		DeepDriveCapture::GetInstance().RegisterProxy(*this);
-		m_isActive = true;
-		UE_LOG(LogDeepDriveCapture, Log, TEXT("Capture Proxy [%s] registered"), *(GetFullName()));
-	}
+	// every proxy captures into its own context, so several agents can be captured independently
+	m_CaptureContext = DeepDriveCapture::CreateContext(*this);
+	m_isActive = true;
+	UE_LOG(LogDeepDriveCapture, Log, TEXT("Capture Proxy [%s] registered"), *(GetFullName()));
 }
 
 
@@ -67,23 +46,32 @@ void ADeepDriveCaptureProxy::BeginPlay()
 			{
 				m_CaptureSinks.Add(captureSinkComp);
 				UE_LOG(LogDeepDriveCapture, Log, TEXT("Found sink %s"), *(captureSinkComp->getName()));
+
+				// read back directly into the storage of a sink able to consume captures without copying
+				const CaptureBufferAllocatorPtr allocator = captureSinkComp->getCaptureBufferAllocator();
+				if(allocator.IsValid())
+					m_CaptureContext->getCaptureBufferPool().setAllocator(allocator);
 			}
 		}
+
+		// clients connecting to the server look up the shared memory of this proxy's context
+		m_CaptureContext->updateSharedMemory();
 	}
 	
 }
 
 void ADeepDriveCaptureProxy::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::EndPlay(EndPlayReason);
-
+	// captures still in flight are delivered to the sinks or released before the sinks' components end play
 	if(m_isActive)
 	{
-		DeepDriveCapture::GetInstance().UnregisterProxy(*this);
+		DeepDriveCapture::DestroyContext(m_CaptureContext, *this);
+		m_CaptureContext = 0;
 		UE_LOG(LogDeepDriveCapture, Log, TEXT("Proxy unregistered"));
 		m_isActive = false;
 	}
 
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -93,22 +81,34 @@ void ADeepDriveCaptureProxy::Tick( float DeltaTime )
 
 	if(m_isActive)
 	{
-		DeepDriveCapture &deepDriveCapture = DeepDriveCapture::GetInstance();
+		DeepDriveCapture &deepDriveCapture = *m_CaptureContext;
 
 		deepDriveCapture.HandleCaptureResult();
 
-		if(CaptureInterval >= 0.0f)
+		// in lockstep mode capturing is triggered by the server after each step
+		bool intervalElapsed = false;
+		if	(	CaptureInterval >= 0.0f
+			&&	deepDriveCapture.isLockstepMode() == false
+			)
 		{
 			m_TimeToNextCapture -= DeltaTime;
 
 			if(m_TimeToNextCapture <= 0.0f)
 			{
-				m_DeepDriveData = BeginCapture();
-				DeepDriveCapture::GetInstance().Capture();
-
+				intervalElapsed = true;
 				m_TimeToNextCapture = CaptureInterval;
 			}
 		}
+
+		if	(	intervalElapsed
+			||	(	deepDriveCapture.isLockstepMode() == false
+				&&	deepDriveCapture.IsScheduledCaptureDue()
+				)
+			)
+		{
+			updateDeepDriveData();
+			deepDriveCapture.Capture(intervalElapsed);
+		}
 	}
 }
 
@@ -117,5 +117,53 @@ void ADeepDriveCaptureProxy::Capture()
 {
 	UE_LOG(LogDeepDriveCapture, Log, TEXT("ADeepDriveCaptureProxy::Capture isActive %c"), m_isActive ? 'T' : 'F');
 	if(m_isActive)
-		DeepDriveCapture::GetInstance().Capture();
+		m_CaptureContext->Capture();
+}
+
+void ADeepDriveCaptureProxy::updateDeepDriveData()
+{
+	m_DeepDriveData = BeginCapture();
+}
+
+int32 ADeepDriveCaptureProxy::GetSkippedCaptureCount() const
+{
+	return m_isActive ? static_cast<int32> (m_CaptureContext->getSkippedFrameCount()) : 0;
+}
+
+int32 ADeepDriveCaptureProxy::GetDeferredCaptureCount() const
+{
+	return m_isActive ? static_cast<int32> (m_CaptureContext->getDeferredCaptureCount()) : 0;
+}
+
+int32 ADeepDriveCaptureProxy::GetRejectedCaptureCount() const
+{
+	return m_isActive ? static_cast<int32> (m_CaptureContext->getRejectedCaptureCount()) : 0;
+}
+
+FCaptureBufferPoolStatistics ADeepDriveCaptureProxy::GetCaptureBufferPoolStatistics() const
+{
+	FCaptureBufferPoolStatistics statistics;
+	if(m_isActive)
+	{
+		SCaptureBufferPoolStatistics poolStatistics;
+		m_CaptureContext->getCaptureBufferPool().getStatistics(poolStatistics);
+
+		// trimmed bytes accumulate over the whole session, so they are still clamped
+		const uint64 maxValue = MAX_int32;
+		statistics.AllocatedKB = static_cast<int32> (FMath::Min(poolStatistics.allocated_bytes / 1024, maxValue));
+		statistics.UsedKB = static_cast<int32> (FMath::Min(poolStatistics.used_bytes / 1024, maxValue));
+		statistics.PeakAllocatedKB = static_cast<int32> (FMath::Min(poolStatistics.peak_allocated_bytes / 1024, maxValue));
+		statistics.TrimmedKB = static_cast<int32> (FMath::Min(poolStatistics.trimmed_bytes / 1024, maxValue));
+		statistics.AllocationFailures = static_cast<int32> (poolStatistics.allocation_failures);
+
+		for(const SCaptureBufferSlotStatistics &slot : poolStatistics.slots)
+		{
+			FCaptureBufferSlotStatistics &slotStatistics = statistics.Slots[statistics.Slots.AddDefaulted()];
+			slotStatistics.SlotSize = static_cast<int32> (slot.slot_size);
+			slotStatistics.NumAllocated = static_cast<int32> (slot.num_allocated);
+			slotStatistics.NumInUse = static_cast<int32> (slot.num_in_use);
+			slotStatistics.PeakInUse = static_cast<int32> (slot.peak_in_use);
+		}
+	}
+	return statistics;
 }
@@ -0,0 +1,25 @@
+
+#pragma once
+
+#include "Engine.h"
+
+/**
+	External storage capture buffers can be carved out of, e.g. memory shared with capture clients.
+	Allocators are shared by the pool and every buffer allocated from them, so they stay alive until the last of these buffers is freed.
+*/
+class ICaptureBufferAllocator
+{
+public:
+
+	virtual ~ICaptureBufferAllocator()
+		{	}
+
+	virtual void* allocate(uint32 size) = 0;
+
+	virtual void free(void *buffer, uint32 size) = 0;
+
+	virtual bool contains(const void *buffer) const = 0;
+
+};
+
+typedef TSharedPtr<ICaptureBufferAllocator, ESPMode::ThreadSafe>	CaptureBufferAllocatorPtr;
@@ -0,0 +1,60 @@
+
+#pragma once
+
+#include "Engine.h"
+
+struct SCaptureJob;
+
+struct SCaptureReadbackData
+{
+	EPixelFormat			pixel_format = PF_Unknown;
+	uint32					width = 0;
+	uint32					height = 0;
+	uint32					stride = 0;
+};
+
+/**
+	Location of a single capture request within shared staging storage
+*/
+struct SCaptureReadbackRegion
+{
+	uint32					x = 0;
+	uint32					y = 0;
+	uint32					width = 0;
+	uint32					height = 0;
+};
+
+/**
+	Interface for copying capture sources into staging storage and mapping them later on.
+	All methods are called on the render thread.
+*/
+class ICaptureReadbackBackend
+{
+public:
+
+	virtual ~ICaptureReadbackBackend()
+		{	}
+
+	/**
+		Copy all capture sources of job into staging storage of given slot
+	*/
+	virtual void enqueueCopy(uint32 slotIndex, const SCaptureJob &job) = 0;
+
+	virtual const void* map(uint32 slotIndex, uint32 requestIndex, SCaptureReadbackData &readbackData) = 0;
+
+	virtual void unmap(uint32 slotIndex, uint32 requestIndex) = 0;
+
+	/**
+		Backends reading back all requests of a slot through one shared surface map it as a whole,
+		all others return 0 and are mapped per request.
+	*/
+	virtual const void* mapShared(uint32 slotIndex, SCaptureReadbackData &readbackData)
+		{	return 0;	}
+
+	virtual bool getRegion(uint32 slotIndex, uint32 requestIndex, SCaptureReadbackRegion &region) const
+		{	return false;	}
+
+	virtual void unmapShared(uint32 slotIndex)
+		{	}
+
+};
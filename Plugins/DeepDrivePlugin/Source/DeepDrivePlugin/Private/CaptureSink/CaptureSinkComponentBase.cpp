@@ -3,13 +3,17 @@
 #include "DeepDrivePluginPrivatePCH.h"
 #include "DeepDrivePlugin.h"
 #include "Public/CaptureSink/CaptureSinkComponentBase.h"
+#include "Private/Capture/ICaptureBufferAllocator.h"
 
 
 UCaptureSinkComponentBase::UCaptureSinkComponentBase()
 {
 }
 
+void UCaptureSinkComponentBase::updateSettings()
+{
 
+}
 
 void UCaptureSinkComponentBase::begin(double timestamp, uint32 sequenceNumber, const FDeepDriveDataOut &deepDriveData)
 {
@@ -25,3 +29,28 @@ void UCaptureSinkComponentBase::flush()
 {
 
 }
+
+int32 UCaptureSinkComponentBase::getPendingJobCount() const
+{
+	return 0;
+}
+
+int32 UCaptureSinkComponentBase::getDroppedJobCount() const
+{
+	return 0;
+}
+
+int32 UCaptureSinkComponentBase::GetQueueDepth() const
+{
+	return getPendingJobCount();
+}
+
+int32 UCaptureSinkComponentBase::GetDroppedJobCount() const
+{
+	return getDroppedJobCount();
+}
+
+TSharedPtr<ICaptureBufferAllocator, ESPMode::ThreadSafe> UCaptureSinkComponentBase::getCaptureBufferAllocator() const
+{
+	return CaptureBufferAllocatorPtr();
+}
@@ -4,52 +4,73 @@
 #include "Public/Capture/CaptureDefines.h"
 #include "Private/CaptureSink/CaptureSinkWorkerBase.h"
 
+DEFINE_LOG_CATEGORY(LogCaptureSinkWorker);
 
 CaptureSinkWorkerBase::CaptureSinkWorkerBase(const FString &name)
+	:	m_Name(name)
 {
 	m_Semaphore = FGenericPlatformProcess::GetSynchEventFromPool(false);
+	m_SpaceAvailable = FGenericPlatformProcess::GetSynchEventFromPool(false);
+	m_JobDone = FGenericPlatformProcess::GetSynchEventFromPool(false);
 	m_WorkerThread = FRunnableThread::Create(this, *(name) , 0, TPri_AboveNormal);
 }
 
 CaptureSinkWorkerBase::~CaptureSinkWorkerBase()
 {
+	shutdown();
+
 	if (m_Semaphore)
 		FGenericPlatformProcess::ReturnSynchEventToPool(m_Semaphore);
+	if (m_SpaceAvailable)
+		FGenericPlatformProcess::ReturnSynchEventToPool(m_SpaceAvailable);
+	if (m_JobDone)
+		FGenericPlatformProcess::ReturnSynchEventToPool(m_JobDone);
+}
 
-	delete m_WorkerThread;
+void CaptureSinkWorkerBase::shutdown()
+{
+	if(m_WorkerThread)
+	{
+		// wakes up the worker as well as a producer blocked on a full queue
+		Stop();
+		delete m_WorkerThread;
+		m_WorkerThread = 0;
+	}
+
+	// drop jobs never executed so their capture buffer leases are released
+	SCaptureSinkJobData *jobData = 0;
+	while((jobData = popJob()) != 0)
+	{
+		releaseJobData(*jobData);
+		m_PendingJobCount.Decrement();
+	}
 }
 
 bool CaptureSinkWorkerBase::Init()
 {
-	m_isStopped = false;
 	return true;
 }
 
 uint32 CaptureSinkWorkerBase::Run()
 {
-	do
+	while(!m_isStopped)
 	{
-		(void) m_Semaphore->Wait();
-		if(!m_isStopped)
+		// only wait while the queue is empty, a trigger arriving in between leaves the event signaled
+		SCaptureSinkJobData *jobData = popJob();
+		if(jobData)
 		{
-			SCaptureSinkJobData *jobData = 0;
-
-			while	(	m_JobDataQueue.Dequeue(jobData)
-					&&	jobData
-					)
-			{
-				const bool continueExecuting = execute(*jobData);
+			m_SpaceAvailable->Trigger();
 
-				delete jobData;
+			(void) execute(*jobData);
 
-				if(continueExecuting)
-					FPlatformProcess::Sleep(0.001);
-				else
-					break;
-			}
+			const uint32 sequenceNumber = jobData->sequence_number;
+			releaseJobData(*jobData);
+			m_PendingJobCount.Decrement();
+			setJobDone(sequenceNumber);
 		}
-
-	} while (!m_isStopped);
+		else
+			(void) m_Semaphore->Wait();
+	}
 
 	return 0;
 }
@@ -58,16 +79,137 @@ void CaptureSinkWorkerBase::Stop()
 {
 	m_isStopped = true;
 	m_Semaphore->Trigger();
+	m_SpaceAvailable->Trigger();
 }
 
+void CaptureSinkWorkerBase::setQueueLimit(int32 maxQueuedJobs, EDeepDriveCaptureSinkQueuePolicy queuePolicy)
+{
+	FScopeLock lock(&m_QueueMutex);
+	m_MaxQueuedJobs = FMath::Max(maxQueuedJobs, 0);
+	m_QueuePolicy = queuePolicy;
+}
 
 void CaptureSinkWorkerBase::process(SCaptureSinkJobData &jobData)
 {
-	m_JobDataQueue.Enqueue(&jobData);
-	m_Semaphore->Trigger();
+	SCaptureSinkJobData *droppedJobData = 0;
+
+	m_QueueMutex.Lock();
+
+	while	(	m_MaxQueuedJobs > 0
+			&&	m_QueueCount >= m_MaxQueuedJobs
+			&&	m_QueuePolicy == EDeepDriveCaptureSinkQueuePolicy::Block
+			&&	!m_isStopped
+			)
+	{
+		m_QueueMutex.Unlock();
+		(void) m_SpaceAvailable->Wait();
+		m_QueueMutex.Lock();
+	}
+
+	if	(	m_MaxQueuedJobs > 0
+		&&	m_QueueCount >= m_MaxQueuedJobs
+		&&	m_QueuePolicy != EDeepDriveCaptureSinkQueuePolicy::DropOldest
+		)
+	{
+		droppedJobData = &jobData;
+	}
+	else
+	{
+		if	(	m_MaxQueuedJobs > 0
+			&&	m_QueueCount >= m_MaxQueuedJobs
+			)
+			droppedJobData = popJob();
+		else
+			m_PendingJobCount.Increment();
+
+		pushJob(jobData);
+	}
+
+	m_QueueMutex.Unlock();
+
+	if(droppedJobData != &jobData)
+		m_Semaphore->Trigger();
+
+	if(droppedJobData)
+	{
+		const int32 droppedJobCount = m_DroppedJobCount.Increment();
+		const uint32 sequenceNumber = droppedJobData->sequence_number;
+		UE_LOG(LogCaptureSinkWorker, Warning, TEXT("%s queue full, dropped capture %d, %d captures dropped so far"), *m_Name, sequenceNumber, droppedJobCount);
+		releaseJobData(*droppedJobData);
+		setJobDone(sequenceNumber);
+	}
+}
+
+bool CaptureSinkWorkerBase::waitForJob(uint32 sequenceNumber, double timeoutSeconds)
+{
+	const double timeoutTS = FPlatformTime::Seconds() + timeoutSeconds;
+	while(static_cast<uint32> (m_lastDoneSequenceNumber) < sequenceNumber)
+	{
+		// a job finished in between checking and waiting leaves the event signaled
+		const double remaining = timeoutTS - FPlatformTime::Seconds();
+		if	(	remaining <= 0.0
+			||	!m_JobDone->Wait(static_cast<uint32> (remaining * 1000.0) + 1)
+			)
+			return static_cast<uint32> (m_lastDoneSequenceNumber) >= sequenceNumber;
+	}
+	return true;
+}
+
+void CaptureSinkWorkerBase::setJobDone(uint32 sequenceNumber)
+{
+	// jobs may be dropped by the producer while the worker executes older ones, so only ever move forward
+	int32 prev = m_lastDoneSequenceNumber;
+	while(static_cast<uint32> (prev) < sequenceNumber)
+	{
+		const int32 cur = FPlatformAtomics::InterlockedCompareExchange(&m_lastDoneSequenceNumber, static_cast<int32> (sequenceNumber), prev);
+		if(cur == prev)
+			break;
+		prev = cur;
+	}
+
+	m_JobDone->Trigger();
 }
 
 bool CaptureSinkWorkerBase::execute(SCaptureSinkJobData &jobData)
 {
 	return false;
 }
+
+void CaptureSinkWorkerBase::releaseJobData(SCaptureSinkJobData &jobData)
+{
+	delete &jobData;
+}
+
+void CaptureSinkWorkerBase::pushJob(SCaptureSinkJobData &jobData)
+{
+	FScopeLock lock(&m_QueueMutex);
+
+	if(m_QueueCount == m_JobQueue.Num())
+	{
+		// grow ring buffer keeping jobs in order
+		TArray<SCaptureSinkJobData*> jobQueue;
+		jobQueue.SetNumZeroed(FMath::Max(m_JobQueue.Num() * 2, FMath::Max(m_MaxQueuedJobs, 4)));
+		for(int32 i = 0; i < m_QueueCount; ++i)
+			jobQueue[i] = m_JobQueue[(m_QueueHead + i) % m_JobQueue.Num()];
+		m_JobQueue = MoveTemp(jobQueue);
+		m_QueueHead = 0;
+	}
+
+	m_JobQueue[(m_QueueHead + m_QueueCount) % m_JobQueue.Num()] = &jobData;
+	++m_QueueCount;
+}
+
+SCaptureSinkJobData* CaptureSinkWorkerBase::popJob()
+{
+	FScopeLock lock(&m_QueueMutex);
+
+	SCaptureSinkJobData *jobData = 0;
+	if(m_QueueCount > 0)
+	{
+		jobData = m_JobQueue[m_QueueHead];
+		m_JobQueue[m_QueueHead] = 0;
+		m_QueueHead = (m_QueueHead + 1) % m_JobQueue.Num();
+		--m_QueueCount;
+	}
+	return jobData;
+}
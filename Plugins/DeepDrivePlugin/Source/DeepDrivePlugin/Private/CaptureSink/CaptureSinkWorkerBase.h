@@ -3,35 +3,44 @@
 
 #include "Engine.h"
 #include "Runtime/Core/Public/HAL/Runnable.h"
+#include "Public/Capture/CaptureDefines.h"
+#include "Private/Capture/CaptureBufferLease.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogCaptureSinkWorker, Log, All);
+
+/**
+	Capture handed to a sink, the lease keeps the buffer alive until the job data has been processed
+*/
 struct SCaptureSinkBufferData
 {
 	SCaptureSinkBufferData(EDeepDriveCameraType camType, int32 camId, CaptureBuffer &captureBuffer)
 		:	camera_type(camType)
 		,	camera_id(camId)
-		,	capture_buffer(&captureBuffer)
+		,	capture_buffer(captureBuffer)
 	{
 	}
 
 	EDeepDriveCameraType		camera_type;
 	int32						camera_id;
-	CaptureBuffer				*capture_buffer;
+	CaptureBufferLease			capture_buffer;
 };
 
+/**
+	Job data is recycled by the workers, reset() releases the capture buffer leases but keeps allocations for the next frame
+*/
 struct SCaptureSinkJobData
 {
-	SCaptureSinkJobData(double ts, uint32 seqNr)
-		:	timestamp(ts)
-		,	sequence_number(seqNr)
+	virtual ~SCaptureSinkJobData()
 	{
 	}
 
-	virtual ~SCaptureSinkJobData()
+	virtual void reset()
 	{
+		captures.Reset();
 	}
 
-	double								timestamp;
-	uint32								sequence_number;
+	double								timestamp = 0.0;
+	uint32								sequence_number = 0;
 	TArray<SCaptureSinkBufferData>		captures;
 };
 
@@ -46,20 +55,79 @@ public:
 	virtual uint32 Run();
 	virtual void Stop();
 
+	/**
+		Limit number of queued jobs, 0 means unlimited. queuePolicy decides what happens to jobs handed to a full queue.
+	*/
+	void setQueueLimit(int32 maxQueuedJobs, EDeepDriveCaptureSinkQueuePolicy queuePolicy);
+
 	void process(SCaptureSinkJobData &jobData);
 
+	/**
+		Number of jobs handed to this worker which haven't been executed yet
+	*/
+	int32 getPendingJobCount() const;
+
+	/**
+		Number of jobs dropped because the queue was full
+	*/
+	int32 getDroppedJobCount() const;
+
+	/**
+		Wait until the job with sequenceNumber, or a later one, has been executed or dropped. Returns false on time out.
+	*/
+	bool waitForJob(uint32 sequenceNumber, double timeoutSeconds);
+
 
 protected:
 
 	virtual bool execute(SCaptureSinkJobData &jobData);
 
+	/**
+		Called for every job data handed to process() once it is done with, deletes it by default
+	*/
+	virtual void releaseJobData(SCaptureSinkJobData &jobData);
+
+	/**
+		Stop worker thread and release all jobs not executed yet. Workers recycling job data have to call this in their destructor.
+	*/
+	void shutdown();
+
 private:
 
-	FRunnableThread					*m_WorkerThread;
-	FEvent							*m_Semaphore;
-	bool							m_isStopped;
+	void pushJob(SCaptureSinkJobData &jobData);
 
-	TQueue<SCaptureSinkJobData*>	m_JobDataQueue;
+	SCaptureSinkJobData* popJob();
 
+	void setJobDone(uint32 sequenceNumber);
+
+	FString							m_Name;
+
+	FRunnableThread					*m_WorkerThread = 0;
+	FEvent							*m_Semaphore = 0;
+	FEvent							*m_SpaceAvailable = 0;			// signaled whenever a job has been taken out of the queue
+	volatile bool					m_isStopped = false;
+
+	FCriticalSection				m_QueueMutex;
+	TArray<SCaptureSinkJobData*>	m_JobQueue;						// ring buffer of m_QueueCount jobs starting at m_QueueHead
+	int32							m_QueueHead = 0;
+	int32							m_QueueCount = 0;
+	int32							m_MaxQueuedJobs = 0;
+	EDeepDriveCaptureSinkQueuePolicy	m_QueuePolicy = EDeepDriveCaptureSinkQueuePolicy::DropOldest;
+
+	FThreadSafeCounter				m_PendingJobCount;
+	FThreadSafeCounter				m_DroppedJobCount;
+
+	volatile int32					m_lastDoneSequenceNumber = 0;	// highest sequence number executed or dropped
+	FEvent							*m_JobDone = 0;
 
 };
+
+inline int32 CaptureSinkWorkerBase::getPendingJobCount() const
+{
+	return m_PendingJobCount.GetValue();
+}
+
+inline int32 CaptureSinkWorkerBase::getDroppedJobCount() const
+{
+	return m_DroppedJobCount.GetValue();
+}
@@ -0,0 +1,266 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+
+#include "Private/CaptureSink/DiskCaptureSink/AsyncFileWriter.h"
+
+#include "PlatformFilemanager.h"
+#include "QueuedThreadPool.h"
+
+#if PLATFORM_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+DEFINE_LOG_CATEGORY(LogAsyncFileWriter);
+
+class AsyncFileWriter::FWriteTask	:	public IQueuedWork
+{
+public:
+
+	FWriteTask(AsyncFileWriter &writer, const FString &fileName, uint8 *buffer, uint32 size, uint32 capacity)
+		:	m_Writer(writer)
+		,	m_FileName(fileName)
+		,	m_Buffer(buffer)
+		,	m_Size(size)
+		,	m_Capacity(capacity)
+	{
+	}
+
+	virtual void DoThreadedWork()
+	{
+		if(!AsyncFileWriter::writeFile(m_FileName, m_Buffer, m_Size, m_Capacity))
+			m_Writer.m_FailedWriteCount.Increment();
+		m_Writer.releaseBuffer(m_Buffer);
+		delete this;
+	}
+
+	virtual void Abandon()
+	{
+		m_Writer.m_FailedWriteCount.Increment();
+		m_Writer.releaseBuffer(m_Buffer);
+		delete this;
+	}
+
+private:
+
+	AsyncFileWriter		&m_Writer;
+	FString				m_FileName;
+	uint8				*m_Buffer;
+	uint32				m_Size;
+	uint32				m_Capacity;
+};
+
+
+AsyncFileWriter::AsyncFileWriter(uint64 maxBytesInFlight, int32 numThreads)
+	:	m_MaxBytesInFlight(maxBytesInFlight)
+{
+	m_BufferReleased = FGenericPlatformProcess::GetSynchEventFromPool(false);
+
+	m_ThreadPool = FQueuedThreadPool::Allocate();
+	if(!m_ThreadPool->Create(FMath::Max(numThreads, 1), 64 * 1024, TPri_BelowNormal))
+	{
+		UE_LOG(LogAsyncFileWriter, Error, TEXT("Couldn't create write threads, writing synchronously"));
+		delete m_ThreadPool;
+		m_ThreadPool = 0;
+	}
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+	waitForWrites();
+
+	if(m_ThreadPool)
+	{
+		m_ThreadPool->Destroy();
+		delete m_ThreadPool;
+	}
+
+	for(SStagingBuffer &buffer : m_FreeBuffers)
+		FMemory::Free(buffer.data);
+
+	FGenericPlatformProcess::ReturnSynchEventToPool(m_BufferReleased);
+}
+
+uint8* AsyncFileWriter::acquireBuffer(uint32 size)
+{
+	const uint32 capacity = Align(size, static_cast<uint32> (DirectIOAlignment));
+
+	m_Mutex.Lock();
+
+	// a buffer larger than the whole budget is only handed out once nothing else is in flight
+	while	(	m_BytesInFlight > 0
+			&&	m_BytesInFlight + capacity > m_MaxBytesInFlight
+			)
+	{
+		m_Mutex.Unlock();
+		(void) m_BufferReleased->Wait();
+		m_Mutex.Lock();
+	}
+
+	uint8 *data = 0;
+	uint32 dataCapacity = 0;
+	for(int32 i = 0; i < m_FreeBuffers.Num(); ++i)
+	{
+		if(m_FreeBuffers[i].capacity >= capacity)
+		{
+			data = m_FreeBuffers[i].data;
+			dataCapacity = m_FreeBuffers[i].capacity;
+			m_FreeBuffers.RemoveAtSwap(i);
+			break;
+		}
+	}
+
+	if(data == 0)
+	{
+		// free buffers are too small, drop the smallest one so memory stays bounded by the budget
+		if(m_FreeBuffers.Num() > 0)
+		{
+			int32 smallest = 0;
+			for(int32 i = 1; i < m_FreeBuffers.Num(); ++i)
+				if(m_FreeBuffers[i].capacity < m_FreeBuffers[smallest].capacity)
+					smallest = i;
+			FMemory::Free(m_FreeBuffers[smallest].data);
+			m_FreeBuffers.RemoveAtSwap(smallest);
+		}
+
+		data = reinterpret_cast<uint8*> (FMemory::Malloc(capacity, DirectIOAlignment));
+		dataCapacity = capacity;
+	}
+
+	m_BytesInFlight += dataCapacity;
+	m_UsedBuffers.Add(data, dataCapacity);
+
+	m_Mutex.Unlock();
+
+	return data;
+}
+
+void AsyncFileWriter::write(const FString &fileName, uint8 *buffer, uint32 size)
+{
+	uint32 capacity = 0;
+	{
+		FScopeLock lock(&m_Mutex);
+		capacity = m_UsedBuffers.FindChecked(buffer);
+		++m_NumPendingWrites;
+	}
+
+	if(m_ThreadPool)
+		m_ThreadPool->AddQueuedWork(new FWriteTask(*this, fileName, buffer, size, capacity));
+	else
+	{
+		if(!writeFile(fileName, buffer, size, capacity))
+			m_FailedWriteCount.Increment();
+		releaseBuffer(buffer);
+	}
+}
+
+void AsyncFileWriter::waitForWrites()
+{
+	m_Mutex.Lock();
+	while(m_NumPendingWrites > 0)
+	{
+		m_Mutex.Unlock();
+		(void) m_BufferReleased->Wait();
+		m_Mutex.Lock();
+	}
+	m_Mutex.Unlock();
+}
+
+uint64 AsyncFileWriter::getBytesInFlight() const
+{
+	FScopeLock lock(&m_Mutex);
+	return m_BytesInFlight;
+}
+
+void AsyncFileWriter::releaseBuffer(uint8 *buffer)
+{
+	{
+		FScopeLock lock(&m_Mutex);
+
+		SStagingBuffer stagingBuffer;
+		stagingBuffer.data = buffer;
+		stagingBuffer.capacity = m_UsedBuffers.FindAndRemoveChecked(buffer);
+		m_FreeBuffers.Add(stagingBuffer);
+
+		m_BytesInFlight -= stagingBuffer.capacity;
+		--m_NumPendingWrites;
+	}
+
+	// only one thread waits at a time, either the sink worker for space or the owner for all writes
+	m_BufferReleased->Trigger();
+}
+
+#if PLATFORM_LINUX
+
+/**
+	Write data from offset from up to offset to, returns the offset reached
+*/
+static uint32 writeRange(int fd, const uint8 *data, uint32 from, uint32 to)
+{
+	while(from < to)
+	{
+		const ssize_t curWritten = pwrite(fd, data + from, to - from, from);
+		if(curWritten <= 0)
+			break;
+		from += static_cast<uint32> (curWritten);
+	}
+	return from;
+}
+
+#endif
+
+bool AsyncFileWriter::writeFile(const FString &fileName, const uint8 *data, uint32 size, uint32 capacity)
+{
+	bool res = false;
+
+#if PLATFORM_LINUX
+
+	const FTCHARToUTF8 path(*fileName);
+
+	// direct I/O needs a length aligned like the buffer, the padding is cut off afterwards
+	int fd = open(path.Get(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+	const bool isDirect = fd >= 0;
+	if(!isDirect)
+		fd = open(path.Get(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if(fd >= 0)
+	{
+		uint32 writeSize = isDirect ? FMath::Min(Align(size, static_cast<uint32> (DirectIOAlignment)), capacity) : size;
+		uint32 written = writeRange(fd, data, 0, writeSize);
+
+		// a partial write leaves the next offset unaligned and some file systems only reject direct I/O when writing,
+		// so the remainder is written buffered
+		if(isDirect && written < writeSize)
+		{
+			const int flags = fcntl(fd, F_GETFL);
+			if	(	flags != -1
+				&&	fcntl(fd, F_SETFL, flags & ~O_DIRECT) == 0
+				)
+			{
+				writeSize = FMath::Max(written, size);
+				written = writeRange(fd, data, written, writeSize);
+			}
+		}
+
+		res = written == writeSize;
+		if(res && writeSize != size)
+			res = ftruncate(fd, size) == 0;
+		close(fd);
+	}
+
+#else
+
+	IFileHandle *file = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*fileName);
+	if(file)
+	{
+		res = file->Write(data, size);
+		delete file;
+	}
+
+#endif
+
+	if(!res)
+		UE_LOG(LogAsyncFileWriter, Error, TEXT("Couldn't write %s"), *fileName);
+
+	return res;
+}
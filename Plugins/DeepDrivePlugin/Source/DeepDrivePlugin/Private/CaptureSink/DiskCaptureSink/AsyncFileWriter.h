@@ -0,0 +1,82 @@
+
+#pragma once
+
+#include "Engine.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogAsyncFileWriter, Log, All);
+
+class FQueuedThreadPool;
+
+/**
+	Writes whole files on a pool of threads so the disk sink worker doesn't wait for the disk.
+	Data is staged in buffers aligned for direct I/O, on Linux files are written with O_DIRECT bypassing the page cache,
+	falling back to buffered writes where the file system doesn't support it. The number of bytes staged but not written yet
+	is limited, acquiring a buffer blocks until enough earlier writes have completed.
+*/
+class AsyncFileWriter
+{
+	struct SStagingBuffer
+	{
+		uint8				*data;
+		uint32				capacity;
+	};
+
+	class FWriteTask;
+
+public:
+
+	enum
+	{
+		DirectIOAlignment = 4096
+	};
+
+	AsyncFileWriter(uint64 maxBytesInFlight, int32 numThreads);
+
+	/**
+		Waits for all pending writes
+	*/
+	~AsyncFileWriter();
+
+	/**
+		Staging buffer of at least size bytes which has to be handed to write() afterwards
+	*/
+	uint8* acquireBuffer(uint32 size);
+
+	/**
+		Write the first size bytes of buffer to fileName, the buffer is recycled once written
+	*/
+	void write(const FString &fileName, uint8 *buffer, uint32 size);
+
+	void waitForWrites();
+
+	uint64 getBytesInFlight() const;
+
+	int32 getFailedWriteCount() const;
+
+	/**
+		Write a file synchronously the way the pool threads do
+	*/
+	static bool writeFile(const FString &fileName, const uint8 *data, uint32 size, uint32 capacity);
+
+private:
+
+	void releaseBuffer(uint8 *buffer);
+
+	FQueuedThreadPool				*m_ThreadPool = 0;
+
+	mutable FCriticalSection		m_Mutex;
+	FEvent							*m_BufferReleased = 0;
+	uint64							m_MaxBytesInFlight;
+	uint64							m_BytesInFlight = 0;
+	int32							m_NumPendingWrites = 0;
+	TArray<SStagingBuffer>			m_FreeBuffers;
+	TMap<uint8*, uint32>			m_UsedBuffers;					// buffer to capacity
+
+	FThreadSafeCounter				m_FailedWriteCount;
+};
+
+
+inline int32 AsyncFileWriter::getFailedWriteCount() const
+{
+	return m_FailedWriteCount.GetValue();
+}
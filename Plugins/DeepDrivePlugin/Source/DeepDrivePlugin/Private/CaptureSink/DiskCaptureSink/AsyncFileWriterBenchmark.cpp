@@ -0,0 +1,126 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+
+#include "Private/CaptureSink/DiskCaptureSink/AsyncFileWriter.h"
+#include "Private/ConsoleBenchmark.h"
+
+#include "PlatformFilemanager.h"
+
+#if PLATFORM_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+	Writes files the way BmpSaveHandler::save does, a header followed by one fwrite per row.
+	Data is synced to disk like the asynchronous writes, otherwise only copying into the page cache would be measured.
+*/
+static bool writeFileByRows(const FString &fileName, const uint8 *data, uint32 size, uint32 rowSize)
+{
+	FILE *out = fopen(TCHAR_TO_ANSI(*fileName), "wb");
+	if(out == 0)
+		return false;
+
+	for(uint32 offset = 0; offset < size; offset += rowSize)
+		fwrite(data + offset, 1, FMath::Min(rowSize, size - offset), out);
+
+	bool res = fflush(out) == 0;
+#if PLATFORM_LINUX
+	res = fsync(fileno(out)) == 0 && res;
+#endif
+	fclose(out);
+	return res;
+}
+
+/**
+	Sync a file written by the AsyncFileWriter, direct I/O bypasses the page cache but buffered remainders and the file size don't
+*/
+static bool syncFile(const FString &fileName)
+{
+	bool res = true;
+#if PLATFORM_LINUX
+	const int fd = open(TCHAR_TO_UTF8(*fileName), O_WRONLY);
+	res = fd >= 0 && fsync(fd) == 0;
+	if(fd >= 0)
+		close(fd);
+#endif
+	return res;
+}
+
+/**
+	Compares writing a sequence of files synchronously with buffered I/O against the AsyncFileWriter, both including the sync to disk. Run from the console with
+	DeepDrive.BenchmarkDiskWriter [Path] [FileSizeKB] [NumFiles] [NumThreads] [MaxBytesInFlightMB]
+	Defaults resemble a 1920x1080 bitmap per file. Written files are deleted afterwards.
+*/
+static void benchmarkDiskWriter(const TArray<FString> &args)
+{
+	ConsoleBenchmark benchmark(TEXT("DeepDrive.BenchmarkDiskWriter"), args);
+	const FString path = benchmark.getStringArg(0, FPaths::Combine(*FPaths::GameSavedDir(), TEXT("DiskWriterBenchmark")));
+	const uint32 fileSize = benchmark.getIntArg(1, 6075) * 1024;
+	const int32 numFiles = benchmark.getIntArg(2, 200);
+	const int32 numThreads = benchmark.getIntArg(3, 4);
+	const uint64 maxBytesInFlight = static_cast<uint64> (benchmark.getIntArg(4, 256)) * 1024 * 1024;
+	const double totalMB = static_cast<double> (fileSize) * numFiles / (1024.0 * 1024.0);
+
+	IPlatformFile &platformFile = FPlatformFileManager::Get().GetPlatformFile();
+	platformFile.CreateDirectoryTree(*path);
+
+	FRandomStream random(0x0DEE9D82);
+	TArray<uint8> data;
+	data.SetNumUninitialized(fileSize);
+	for(uint32 i = 0; i < fileSize; ++i)
+		data[i] = static_cast<uint8> (random.RandHelper(256));
+
+	benchmark.start();
+	int32 numFailed = 0;
+	for(int32 i = 0; i < numFiles; ++i)
+	{
+		if(!writeFileByRows(FPaths::Combine(*path, TEXT("sync_")) + FString::FromInt(i) + ".bin", data.GetData(), fileSize, 1920 * 3))
+			++numFailed;
+	}
+	const double syncDuration = benchmark.getElapsed();
+
+	double asyncDuration = 0.0;
+	double asyncSubmitDuration = 0.0;
+	{
+		AsyncFileWriter writer(maxBytesInFlight, numThreads);
+
+		benchmark.start();
+		for(int32 i = 0; i < numFiles; ++i)
+		{
+			uint8 *buffer = writer.acquireBuffer(fileSize);
+			FMemory::Memcpy(buffer, data.GetData(), fileSize);
+			writer.write(FPaths::Combine(*path, TEXT("async_")) + FString::FromInt(i) + ".bin", buffer, fileSize);
+		}
+		asyncSubmitDuration = benchmark.getElapsed();
+		writer.waitForWrites();
+		for(int32 i = 0; i < numFiles; ++i)
+		{
+			if(!syncFile(FPaths::Combine(*path, TEXT("async_")) + FString::FromInt(i) + ".bin"))
+				++numFailed;
+		}
+		asyncDuration = benchmark.getElapsed();
+		numFailed += writer.getFailedWriteCount();
+	}
+
+	for(int32 i = 0; i < numFiles; ++i)
+	{
+		platformFile.DeleteFile(*(FPaths::Combine(*path, TEXT("sync_")) + FString::FromInt(i) + ".bin"));
+		platformFile.DeleteFile(*(FPaths::Combine(*path, TEXT("async_")) + FString::FromInt(i) + ".bin"));
+	}
+
+	UE_LOG	(	LogDeepDriveBenchmark, Log, TEXT("%d files of %u bytes to %s: synchronous %.1f MB/s, asynchronous %.1f MB/s with %d threads, submitting took %.1f ms of %.1f ms, %d failed writes")
+			,	numFiles, fileSize, *path
+			,	ConsoleBenchmark::getRate(totalMB, syncDuration)
+			,	ConsoleBenchmark::getRate(totalMB, asyncDuration), numThreads
+			,	asyncSubmitDuration * 1000.0, asyncDuration * 1000.0
+			,	numFailed
+			);
+	benchmark.logResult(numFailed == 0);
+}
+
+static FAutoConsoleCommand BenchmarkDiskWriterCommand
+	(	TEXT("DeepDrive.BenchmarkDiskWriter")
+	,	TEXT("Measure synchronous buffered file writes against the asynchronous direct I/O writer of the disk sink. Arguments: [Path] [FileSizeKB] [NumFiles] [NumThreads] [MaxBytesInFlightMB]")
+	,	FConsoleCommandWithArgsDelegate::CreateStatic(&benchmarkDiskWriter)
+	);
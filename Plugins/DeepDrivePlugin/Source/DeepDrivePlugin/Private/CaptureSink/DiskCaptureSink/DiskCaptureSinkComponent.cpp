@@ -11,6 +11,22 @@
 
 DEFINE_LOG_CATEGORY(LogDiskCaptureSinkComponent);
 
+static bool isEqualPaths(const TMap<EDeepDriveCameraType, FString> &lhs, const TMap<EDeepDriveCameraType, FString> &rhs)
+{
+	if(lhs.Num() != rhs.Num())
+		return false;
+
+	for(auto &entry : lhs)
+	{
+		const FString *path = rhs.Find(entry.Key);
+		if	(	path == 0
+			||	!path->Equals(entry.Value, ESearchCase::CaseSensitive)
+			)
+			return false;
+	}
+	return true;
+}
+
 
 UDiskCaptureSinkComponent::UDiskCaptureSinkComponent()
 {
@@ -18,15 +34,83 @@ UDiskCaptureSinkComponent::UDiskCaptureSinkComponent()
 	m_BasePath = UGameplayStatics::GetPlatformName() == "Linux" ? &BasePathOnLinux : &BasePathOnWindows;
 }
 
+void UDiskCaptureSinkComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	const int32 numWriteThreads = AsyncWrites ? FMath::Clamp(WriteThreads, 1, 32) : 0;
+	const uint64 maxWriteBytesInFlight = static_cast<uint64> (FMath::Clamp(MaxWriteBytesInFlightMB, 1, 4096)) * 1024 * 1024;
+	m_Worker = new DiskCaptureSinkWorker(numWriteThreads, maxWriteBytesInFlight);
+}
+
+void UDiskCaptureSinkComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	// pending jobs release their capture buffer leases before the capture context goes away
+	delete m_Worker;
+	m_Worker = 0;
+}
+
+void UDiskCaptureSinkComponent::updateSettings()
+{
+	if(m_Worker)
+		m_Worker->setQueueLimit(MaxQueuedJobs, QueuePolicy);
+
+	FScopeLock lock(&m_SettingsMutex);
+
+	// settings rarely change, only copy them when they have
+	if(!m_Settings.base_path.Equals(*m_BasePath, ESearchCase::CaseSensitive))
+		m_Settings.base_path = *m_BasePath;
+	if(!isEqualPaths(m_Settings.camera_type_paths, CameraTypePaths))
+		m_Settings.camera_type_paths = CameraTypePaths;
+	if(!m_Settings.base_file_name.Equals(BaseFileName, ESearchCase::CaseSensitive))
+		m_Settings.base_file_name = BaseFileName;
+
+	if(Output == EDeepDriveDiskCaptureOutput::EpisodeRecording)
+	{
+		if	(	m_Settings.episode_path.IsEmpty()
+			||	m_EpisodeNumber != m_RequestedEpisodeNumber
+			)
+		{
+			m_EpisodeNumber = m_RequestedEpisodeNumber;
+			m_Settings.episode_path = FPaths::Combine(*m_BasePath, BaseFileName) + FDateTime::Now().ToString() + "_" + FString::FromInt(m_EpisodeNumber) + ".ddepisode";
+		}
+	}
+	else
+		m_Settings.episode_path.Empty();
+
+	m_Settings.episode_chunk_size = static_cast<uint32> (FMath::Clamp(EpisodeChunkSizeMB, 1, 1024)) * 1024 * 1024;
+}
 
 void UDiskCaptureSinkComponent::begin(double timestamp, uint32 sequenceNumber, const FDeepDriveDataOut &deepDriveData)
 {
+	// no worker before BeginPlay or after EndPlay
 	if(m_Worker == 0)
 	{
-		m_Worker = new DiskCaptureSinkWorker;
+		m_curJobData = 0;
+		return;
 	}
 
-	m_curJobData = new DiskCaptureSinkWorker::SDiskCaptureSinkJobData(timestamp, sequenceNumber, *m_BasePath, CameraTypePaths, BaseFileName);
+	// recycled job data mostly has the right paths already, only copy them when they have changed
+	DiskCaptureSinkWorker::SDiskCaptureSinkJobData *jobData = m_Worker->acquireJobData();
+	jobData->timestamp = timestamp;
+	jobData->sequence_number = sequenceNumber;
+	{
+		FScopeLock lock(&m_SettingsMutex);
+		if(!jobData->base_path.Equals(m_Settings.base_path, ESearchCase::CaseSensitive))
+			jobData->base_path = m_Settings.base_path;
+		if(!isEqualPaths(jobData->camera_type_paths, m_Settings.camera_type_paths))
+			jobData->camera_type_paths = m_Settings.camera_type_paths;
+		if(!jobData->base_file_name.Equals(m_Settings.base_file_name, ESearchCase::CaseSensitive))
+			jobData->base_file_name = m_Settings.base_file_name;
+		if(!jobData->episode_path.Equals(m_Settings.episode_path, ESearchCase::CaseSensitive))
+			jobData->episode_path = m_Settings.episode_path;
+		jobData->episode_chunk_size = m_Settings.episode_chunk_size;
+	}
+	jobData->deep_drive_data = deepDriveData;
+
+	m_curJobData = jobData;
 	UE_LOG(LogDeepDriveCapture, Log, TEXT("UDiskCaptureSinkComponent::begin seqNr %d %p"), sequenceNumber, m_curJobData);
 }
 
@@ -48,5 +132,21 @@ void UDiskCaptureSinkComponent::flush()
 	{
 		UE_LOG(LogDeepDriveCapture, Log, TEXT("UDiskCaptureSinkComponent::flush"));
 		m_Worker->process(*m_curJobData);
+		m_curJobData = 0;
 	}
 }
+
+void UDiskCaptureSinkComponent::FinishEpisode()
+{
+	++m_RequestedEpisodeNumber;
+}
+
+int32 UDiskCaptureSinkComponent::getPendingJobCount() const
+{
+	return m_Worker ? m_Worker->getPendingJobCount() : 0;
+}
+
+int32 UDiskCaptureSinkComponent::getDroppedJobCount() const
+{
+	return m_Worker ? m_Worker->getDroppedJobCount() : 0;
+}
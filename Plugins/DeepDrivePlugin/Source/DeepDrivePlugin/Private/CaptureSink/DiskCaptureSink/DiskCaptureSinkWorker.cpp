@@ -2,6 +2,7 @@
 #include "DeepDrivePluginPrivatePCH.h"
 
 #include "Private/CaptureSink/DiskCaptureSink/DiskCaptureSinkWorker.h"
+#include "Private/CaptureSink/DiskCaptureSink/AsyncFileWriter.h"
 #include "Private/Capture/CaptureBuffer.h"
 
 
@@ -13,27 +14,63 @@
 DEFINE_LOG_CATEGORY(LogDiskCaptureSinkWorker);
 
 
-DiskCaptureSinkWorker::DiskCaptureSinkWorker()
+DiskCaptureSinkWorker::DiskCaptureSinkWorker(int32 numWriteThreads, uint64 maxWriteBytesInFlight)
 	:	CaptureSinkWorkerBase("DiskCaptureSinkWorker")
 {
+	if(numWriteThreads > 0)
+		m_FileWriter = new AsyncFileWriter(maxWriteBytesInFlight, numWriteThreads);
+
 	UE_LOG(LogDeepDriveCapture, Log, TEXT("DiskCaptureSinkWorker created"));
 }
 
 DiskCaptureSinkWorker::~DiskCaptureSinkWorker()
 {
+	// pending job data has to be back in the pool before it is destroyed
+	shutdown();
+
+	m_EpisodeRecorder.finish();
+
+	// waits for the bitmaps still being written
+	delete m_FileWriter;
+	m_FileWriter = 0;
+}
+
+DiskCaptureSinkWorker::SDiskCaptureSinkJobData* DiskCaptureSinkWorker::acquireJobData()
+{
+	return m_JobDataPool.acquire();
+}
+
+void DiskCaptureSinkWorker::releaseJobData(SCaptureSinkJobData &jobData)
+{
+	m_JobDataPool.release(static_cast<SDiskCaptureSinkJobData*> (&jobData));
 }
 
 bool DiskCaptureSinkWorker::execute(SCaptureSinkJobData &jobData)
 {
 	SDiskCaptureSinkJobData &diskSinkJobData = static_cast<SDiskCaptureSinkJobData&> (jobData);
 
+	if(!diskSinkJobData.episode_path.Equals(m_EpisodeRecorder.getFilePath(), ESearchCase::CaseSensitive))
+	{
+		if(diskSinkJobData.episode_path.IsEmpty())
+			m_EpisodeRecorder.finish();
+		else
+			m_EpisodeRecorder.begin(diskSinkJobData.episode_path, diskSinkJobData.episode_chunk_size);
+	}
+
+	if(!diskSinkJobData.episode_path.IsEmpty())
+	{
+		if(diskSinkJobData.captures.Num() > 0)
+			m_EpisodeRecorder.addFrame(diskSinkJobData.deep_drive_data, diskSinkJobData.timestamp, diskSinkJobData.sequence_number, diskSinkJobData.captures);
+		return true;
+	}
+
 	const UEnum* CamTypeEnum = FindObject<UEnum>(ANY_PACKAGE, TEXT("EDeepDriveCameraType"));
 
 	for(SCaptureSinkBufferData &captureBufferData : diskSinkJobData.captures)
 	{
 		const EDeepDriveCameraType camType = captureBufferData.camera_type;
 		const int32 camId = captureBufferData.camera_id;
-		CaptureBuffer *captureBuffer = captureBufferData.capture_buffer;
+		CaptureBuffer *captureBuffer = captureBufferData.capture_buffer.get();
 
 		FString filePath;
 		FString camTypePath = diskSinkJobData.camera_type_paths.Contains(camType) ? diskSinkJobData.camera_type_paths[camType] : "";
@@ -61,19 +98,32 @@ void DiskCaptureSinkWorker::saveAsBmp(CaptureBuffer &captureBuffer, const FStrin
 
 	const uint32 width = captureBuffer.getWidth();
 	const uint32 height = captureBuffer.getHeight();
+	// views onto a capture atlas keep the atlas' row pitch
+	const uint32 stride = captureBuffer.getStride();
 	if(dataType == CaptureBuffer::Float16)
 	{
 		const FFloat16 *f16Src = captureBuffer.getBuffer<FFloat16>();
-		img.storeAsRGB(f16Src, width, height);
+		img.storeAsRGB(f16Src, width, height, stride);
 	}
 	else if(dataType == CaptureBuffer::UnsignedByte)
 	{
-		img.storeAsRGB(captureBuffer.getBuffer<uint8>(), width, height);
+		img.storeAsRGB(captureBuffer.getBuffer<uint8>(), width, height, stride);
 	}
 
 	if(img.getSizeInBytes() > 0)
 	{
-		deepdrive::BmpSaveHandler bmpSave;
-		bmpSave.save(fileName, img);
+		if(m_FileWriter)
+		{
+			// encoding into a staging buffer lets the write threads do the file I/O while the next capture is converted
+			const uint32 size = deepdrive::BmpSaveHandler::getEncodedSize(img);
+			uint8 *buffer = m_FileWriter->acquireBuffer(size);
+			deepdrive::BmpSaveHandler::encode(img, buffer);
+			m_FileWriter->write(fileName, buffer, size);
+		}
+		else
+		{
+			deepdrive::BmpSaveHandler bmpSave;
+			bmpSave.save(fileName, img);
+		}
 	}
 }
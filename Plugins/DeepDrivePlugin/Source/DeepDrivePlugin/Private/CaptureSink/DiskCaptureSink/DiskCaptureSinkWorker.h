@@ -2,6 +2,11 @@
 #pragma once
 
 #include "Private/CaptureSink/CaptureSinkWorkerBase.h"
+#include "Private/Capture/CaptureObjectPool.h"
+#include "Public/DeepDriveData.h"
+#include "Private/CaptureSink/DiskCaptureSink/EpisodeRecorder.h"
+
+class AsyncFileWriter;
 
 DECLARE_LOG_CATEGORY_EXTERN(LogDiskCaptureSinkWorker, Log, All);
 
@@ -11,32 +16,45 @@ class DiskCaptureSinkWorker	:	public CaptureSinkWorkerBase
 
 public:
 
+	/**
+		Paths are kept when the job data is recycled and only reassigned when they change
+	*/
 	struct SDiskCaptureSinkJobData : public SCaptureSinkJobData
 	{
-		SDiskCaptureSinkJobData(double timestamp, uint32 seqNr, const FString &basePath, const TMap<EDeepDriveCameraType, FString> &camTypePaths, const FString &baseFileName)
-			: SCaptureSinkJobData(timestamp, seqNr)
-			, base_path(basePath)
-			, camera_type_paths(camTypePaths)
-			, base_file_name(baseFileName)
-		{
-		}
-
 		FString									base_path;
 		TMap<EDeepDriveCameraType, FString>		camera_type_paths;
 		FString									base_file_name;
+
+		FString									episode_path;			// empty unless recording an episode, a new path starts a new episode file
+		uint32									episode_chunk_size = 0;
+		FDeepDriveDataOut						deep_drive_data;
 	};
 
-	DiskCaptureSinkWorker();
+	/**
+		Bitmaps are written on numWriteThreads threads with at most maxWriteBytesInFlight bytes waiting to be written,
+		with no write threads they are written synchronously by the worker
+	*/
+	DiskCaptureSinkWorker(int32 numWriteThreads = 0, uint64 maxWriteBytesInFlight = 0);
 	virtual ~DiskCaptureSinkWorker();
 
+	SDiskCaptureSinkJobData* acquireJobData();
+
 protected:
 
 	virtual bool execute(SCaptureSinkJobData &jobData);
 
+	virtual void releaseJobData(SCaptureSinkJobData &jobData);
+
 private:
 
 	void saveAsBmp(CaptureBuffer &captureBuffer, const FString &fileName);
 
+	CaptureObjectPool<SDiskCaptureSinkJobData>		m_JobDataPool;
+
+	EpisodeRecorder									m_EpisodeRecorder;
+
+	AsyncFileWriter									*m_FileWriter = 0;
+
 };
 
 
@@ -0,0 +1,163 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+
+#include "Private/CaptureSink/DiskCaptureSink/EpisodeRecorder.h"
+#include "Private/CaptureSink/CaptureSinkWorkerBase.h"
+#include "Private/CaptureSink/SharedMemSink/SharedMemCaptureMessageBuilder.h"
+#include "Private/Capture/CaptureBuffer.h"
+#include "Public/Messages/DeepDriveCaptureMessage.h"
+
+#include "PlatformFilemanager.h"
+
+#if PLATFORM_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+DEFINE_LOG_CATEGORY(LogEpisodeRecorder);
+
+EpisodeRecorder::~EpisodeRecorder()
+{
+	finish();
+}
+
+bool EpisodeRecorder::begin(const FString &filePath, uint32 chunkSize)
+{
+	finish();
+
+	IPlatformFile &platformFile = FPlatformFileManager::Get().GetPlatformFile();
+	platformFile.CreateDirectoryTree(*FPaths::GetPath(filePath));
+
+	m_File = platformFile.OpenWrite(*filePath);
+	if(m_File)
+	{
+		m_FilePath = filePath;
+
+		FMemory::Memzero(m_Header);
+		m_Header.magic = DeepDriveEpisodeMagic;
+		m_Header.version = DeepDriveEpisodeVersion;
+		m_Header.chunk_size = FMath::Max(chunkSize, 1u);
+		m_Header.data_end = sizeof(DeepDriveEpisodeHeader);
+		m_FileSize = 0;
+		m_FrameOffsets.Reset();
+
+		reserve(m_Header.data_end);
+		writeHeader();
+
+		UE_LOG(LogEpisodeRecorder, Log, TEXT("Recording episode to %s"), *m_FilePath);
+	}
+	else
+	{
+		UE_LOG(LogEpisodeRecorder, Error, TEXT("Couldn't open %s for recording"), *filePath);
+	}
+
+	return m_File != 0;
+}
+
+void EpisodeRecorder::addFrame(const FDeepDriveDataOut &deepDriveData, double timestamp, uint32 sequenceNumber, TArray<SCaptureSinkBufferData> &captures)
+{
+	if(m_File == 0)
+		return;
+
+	// upper bound of the message size, the widest formats take 12 bytes of color and 4 bytes of depth per pixel
+	uint32 maxFrameSize = sizeof(DeepDriveCaptureMessage);
+	for(SCaptureSinkBufferData &captureBufferData : captures)
+	{
+		const CaptureBuffer *captureBuffer = captureBufferData.capture_buffer.get();
+		if(captureBuffer)
+			maxFrameSize += sizeof(DeepDriveCaptureCamera) + captureBuffer->getWidth() * captureBuffer->getHeight() * 16 + 16;
+	}
+	if(m_FrameBuffer.Num() < static_cast<int32> (maxFrameSize))
+		m_FrameBuffer.SetNumUninitialized(maxFrameSize);
+
+	SharedMemCaptureMessageBuilder messageBuilder(m_FrameBuffer.GetData(), maxFrameSize);
+	messageBuilder.begin(deepDriveData, timestamp, sequenceNumber);
+	for(SCaptureSinkBufferData &captureBufferData : captures)
+	{
+		CaptureBuffer *captureBuffer = captureBufferData.capture_buffer.get();
+		if(captureBuffer)
+			messageBuilder.addCamera(captureBufferData.camera_type, captureBufferData.camera_id, *captureBuffer);
+	}
+	messageBuilder.flush();
+
+	// frames start 8 byte aligned, padding is zeroed so files are reproducible
+	const uint32 messageSize = messageBuilder.getMessageSize();
+	const uint32 frameSize = Align(messageSize, 8);
+	FMemory::Memzero(m_FrameBuffer.GetData() + messageSize, frameSize - messageSize);
+
+	const uint64 frameOffset = m_Header.data_end;
+	const uint64 fileSize = m_FileSize;
+	reserve(frameOffset + frameSize);
+
+	if(writeAt(frameOffset, m_FrameBuffer.GetData(), frameSize))
+	{
+		m_FrameOffsets.Add(frameOffset);
+		m_Header.data_end = frameOffset + frameSize;
+
+		// keep the header reasonably up to date for episodes which never get finished
+		if(m_FileSize != fileSize)
+			writeHeader();
+	}
+	else
+	{
+		UE_LOG(LogEpisodeRecorder, Error, TEXT("Couldn't write frame %d to %s"), sequenceNumber, *m_FilePath);
+	}
+}
+
+void EpisodeRecorder::finish()
+{
+	if(m_File)
+	{
+		m_Header.index_offset = m_Header.data_end;
+		m_Header.num_frames = m_FrameOffsets.Num();
+		if(!writeAt(m_Header.index_offset, m_FrameOffsets.GetData(), m_FrameOffsets.Num() * sizeof(uint64)))
+			m_Header.index_offset = 0;
+		writeHeader();
+
+		UE_LOG(LogEpisodeRecorder, Log, TEXT("Finished episode %s with %d frames, %llu bytes"), *m_FilePath, m_Header.num_frames, m_Header.data_end);
+
+		delete m_File;
+		m_File = 0;
+		m_FilePath.Empty();
+		m_FrameOffsets.Reset();
+	}
+}
+
+void EpisodeRecorder::reserve(uint64 size)
+{
+	if(size > m_FileSize)
+	{
+		// extending the file by whole chunks saves the file system from growing it with every frame
+		const uint64 newFileSize = (size + m_Header.chunk_size - 1) / m_Header.chunk_size * m_Header.chunk_size;
+		bool isReserved = false;
+
+#if PLATFORM_LINUX
+		// writing the chunk's last byte would only make the file sparse, allocate its blocks instead
+		const int fd = open(FTCHARToUTF8(*m_FilePath).Get(), O_WRONLY);
+		if(fd >= 0)
+		{
+			isReserved = posix_fallocate(fd, 0, static_cast<off_t> (newFileSize)) == 0;
+			close(fd);
+		}
+#endif
+
+		// files on NTFS aren't sparse unless flagged so, writing the last byte allocates and zero fills the chunk
+		const uint8 zero = 0;
+		if(!isReserved)
+			isReserved = writeAt(newFileSize - 1, &zero, 1);
+
+		if(isReserved)
+			m_FileSize = newFileSize;
+	}
+}
+
+bool EpisodeRecorder::writeAt(uint64 offset, const void *data, uint64 size)
+{
+	return	m_File->Seek(static_cast<int64> (offset))
+		&&	(size == 0 || m_File->Write(reinterpret_cast<const uint8*> (data), static_cast<int64> (size)));
+}
+
+void EpisodeRecorder::writeHeader()
+{
+	(void) writeAt(0, &m_Header, sizeof(m_Header));
+}
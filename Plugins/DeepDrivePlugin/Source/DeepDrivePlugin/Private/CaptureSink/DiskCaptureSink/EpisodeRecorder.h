@@ -0,0 +1,71 @@
+
+#pragma once
+
+#include "Engine.h"
+#include "Public/Messages/DeepDriveEpisodeRecording.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogEpisodeRecorder, Log, All);
+
+struct FDeepDriveDataOut;
+struct SCaptureSinkBufferData;
+class IFileHandle;
+
+/**
+	Appends frames of telemetry and captures to a single episode recording file, see DeepDriveEpisodeRecording.h for the layout.
+	Frames are built like shared memory capture messages and written sequentially, the file is grown chunk by chunk
+	so the file system doesn't have to extend it with every frame. Not thread safe, used by the disk sink worker only.
+*/
+class EpisodeRecorder
+{
+public:
+
+	~EpisodeRecorder();
+
+	/**
+		Finish the current episode and start recording into filePath
+	*/
+	bool begin(const FString &filePath, uint32 chunkSize);
+
+	void addFrame(const FDeepDriveDataOut &deepDriveData, double timestamp, uint32 sequenceNumber, TArray<SCaptureSinkBufferData> &captures);
+
+	/**
+		Write index and header, the file is complete afterwards
+	*/
+	void finish();
+
+	bool isRecording() const;
+
+	const FString& getFilePath() const;
+
+private:
+
+	/**
+		Grow file chunk by chunk until it holds at least size bytes.
+		On Linux the chunk is allocated with posix_fallocate, elsewhere by writing its last byte.
+	*/
+	void reserve(uint64 size);
+
+	bool writeAt(uint64 offset, const void *data, uint64 size);
+
+	void writeHeader();
+
+	IFileHandle						*m_File = 0;
+	FString							m_FilePath;
+
+	DeepDriveEpisodeHeader			m_Header;
+	uint64							m_FileSize = 0;
+
+	TArray<uint64>					m_FrameOffsets;
+	TArray<uint8>					m_FrameBuffer;					// frames are built here before being written, kept across episodes
+};
+
+
+inline bool EpisodeRecorder::isRecording() const
+{
+	return m_File != 0;
+}
+
+inline const FString& EpisodeRecorder::getFilePath() const
+{
+	return m_FilePath;
+}
@@ -0,0 +1,77 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/CaptureSink/SharedMemSink/SharedMemCaptureBufferAllocator.h"
+
+#include "Public/SharedMemory/SharedMemory.h"
+
+DEFINE_LOG_CATEGORY(LogSharedMemCaptureBufferAllocator);
+
+SharedMemCaptureBufferAllocator::SharedMemCaptureBufferAllocator(const TSharedPtr<SharedMemory, ESPMode::ThreadSafe> &sharedMemory, uint8 *arena, uint32 arenaSize)
+	:	m_SharedMemory(sharedMemory)
+	,	m_Arena(arena)
+	,	m_ArenaSize(arenaSize)
+{
+	m_FreeRanges.Add(SFreeRange(0, arenaSize));
+}
+
+void* SharedMemCaptureBufferAllocator::allocate(uint32 size)
+{
+	void *buffer = 0;
+	size = Align(size, static_cast<uint32> (Alignment));
+
+	FScopeLock lock(&m_Mutex);
+
+	// first fit, buffers are recycled by the pool so this only runs when the pool grows
+	for(int32 i = 0; i < m_FreeRanges.Num(); ++i)
+	{
+		SFreeRange &range = m_FreeRanges[i];
+		if(range.size >= size)
+		{
+			buffer = m_Arena + range.offset;
+			range.offset += size;
+			range.size -= size;
+			if(range.size == 0)
+				m_FreeRanges.RemoveAt(i);
+			break;
+		}
+	}
+
+	if(buffer == 0)
+		UE_LOG(LogSharedMemCaptureBufferAllocator, Warning, TEXT("No room for %d bytes in shared memory arena of %d bytes"), size, m_ArenaSize);
+
+	return buffer;
+}
+
+void SharedMemCaptureBufferAllocator::free(void *buffer, uint32 size)
+{
+	if(contains(buffer))
+	{
+		const uint32 offset = static_cast<uint32> (reinterpret_cast<uint8*> (buffer) - m_Arena);
+		size = Align(size, static_cast<uint32> (Alignment));
+
+		FScopeLock lock(&m_Mutex);
+
+		int32 index = 0;
+		while(index < m_FreeRanges.Num() && m_FreeRanges[index].offset < offset)
+			++index;
+
+		m_FreeRanges.Insert(SFreeRange(offset, size), index);
+
+		// merge with following and preceding range
+		if	(	index + 1 < m_FreeRanges.Num()
+			&&	m_FreeRanges[index].offset + m_FreeRanges[index].size == m_FreeRanges[index + 1].offset
+			)
+		{
+			m_FreeRanges[index].size += m_FreeRanges[index + 1].size;
+			m_FreeRanges.RemoveAt(index + 1);
+		}
+
+		if	(	index > 0
+			&&	m_FreeRanges[index - 1].offset + m_FreeRanges[index - 1].size == m_FreeRanges[index].offset
+			)
+		{
+			m_FreeRanges[index - 1].size += m_FreeRanges[index].size;
+			m_FreeRanges.RemoveAt(index);
+		}
+	}
+}
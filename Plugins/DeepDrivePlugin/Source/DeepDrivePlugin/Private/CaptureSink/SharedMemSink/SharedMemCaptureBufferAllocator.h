@@ -0,0 +1,59 @@
+
+#pragma once
+
+#include "Private/Capture/ICaptureBufferAllocator.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogSharedMemCaptureBufferAllocator, Log, All);
+
+class SharedMemory;
+
+/**
+	Carves capture buffers out of an arena at the end of the shared memory segment, so captures are read back
+	directly into their published location. Keeps the segment alive as long as buffers are allocated from it.
+*/
+class SharedMemCaptureBufferAllocator	:	public ICaptureBufferAllocator
+{
+	struct SFreeRange
+	{
+		SFreeRange(uint32 o, uint32 s)
+			:	offset(o)
+			,	size(s)
+		{
+		}
+
+		uint32			offset;
+		uint32			size;
+	};
+
+public:
+
+	enum
+	{
+		Alignment = 64
+	};
+
+	SharedMemCaptureBufferAllocator(const TSharedPtr<SharedMemory, ESPMode::ThreadSafe> &sharedMemory, uint8 *arena, uint32 arenaSize);
+
+	virtual void* allocate(uint32 size);
+
+	virtual void free(void *buffer, uint32 size);
+
+	virtual bool contains(const void *buffer) const;
+
+private:
+
+	TSharedPtr<SharedMemory, ESPMode::ThreadSafe>	m_SharedMemory;
+
+	uint8								*m_Arena = 0;
+	uint32								m_ArenaSize = 0;
+
+	FCriticalSection					m_Mutex;
+	TArray<SFreeRange>					m_FreeRanges;			// sorted by offset
+};
+
+
+inline bool SharedMemCaptureBufferAllocator::contains(const void *buffer) const
+{
+	const uint8 *ptr = reinterpret_cast<const uint8*> (buffer);
+	return ptr >= m_Arena && ptr < m_Arena + m_ArenaSize;
+}
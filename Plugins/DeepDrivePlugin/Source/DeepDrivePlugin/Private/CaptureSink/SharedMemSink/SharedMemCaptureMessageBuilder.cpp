@@ -4,18 +4,283 @@
 
 #include "Public/Messages/DeepDriveCaptureMessage.h"
 #include "Public/SharedMemory/SharedMemory.h"
+#include "Private/Capture/ICaptureBufferAllocator.h"
+#include "Private/Capture/CaptureConversion.h"
+#include "Private/Capture/CapturePacking.h"
+
+#include "Async/ParallelFor.h"
 
 
 DEFINE_LOG_CATEGORY(LogSharedMemCaptureMessageBuilder);
 
-SharedMemCaptureMessageBuilder::SharedMemCaptureMessageBuilder(SharedMemory &sharedMem)
-	:	m_SharedMem(sharedMem)
+static DeepDriveCaptureColorFormat getColorFormat(EDeepDriveCaptureColorFormat format, bool isPacked)
+{
+	switch(format)
+	{
+		case EDeepDriveCaptureColorFormat::RGB8:		return DeepDriveCaptureColorFormat::RGB8;
+		case EDeepDriveCaptureColorFormat::RGBHalf:		return DeepDriveCaptureColorFormat::RGBHalf;
+		case EDeepDriveCaptureColorFormat::RGBFloat:	return DeepDriveCaptureColorFormat::RGBFloat;
+		case EDeepDriveCaptureColorFormat::Gray8:		return DeepDriveCaptureColorFormat::Gray8;
+		case EDeepDriveCaptureColorFormat::None:		return DeepDriveCaptureColorFormat::None;
+		default:										return isPacked ? DeepDriveCaptureColorFormat::RGB8 : DeepDriveCaptureColorFormat::RGBHalf;
+	}
+}
+
+static DeepDriveCaptureDepthFormat getDepthFormat(EDeepDriveCaptureDepthFormat format, bool isPacked)
+{
+	switch(format)
+	{
+		case EDeepDriveCaptureDepthFormat::Half:				return DeepDriveCaptureDepthFormat::Half;
+		case EDeepDriveCaptureDepthFormat::Float:				return DeepDriveCaptureDepthFormat::Float;
+		case EDeepDriveCaptureDepthFormat::UInt16Centimeters:	return DeepDriveCaptureDepthFormat::UInt16Centimeters;
+		case EDeepDriveCaptureDepthFormat::UInt16Millimeters:	return DeepDriveCaptureDepthFormat::UInt16Millimeters;
+		case EDeepDriveCaptureDepthFormat::None:				return DeepDriveCaptureDepthFormat::None;
+		default:												return isPacked ? DeepDriveCaptureDepthFormat::UInt16Centimeters : DeepDriveCaptureDepthFormat::Half;
+	}
+}
+
+static uint32 getBytesPerPixel(DeepDriveCaptureColorFormat format)
+{
+	switch(format)
+	{
+		case DeepDriveCaptureColorFormat::RGB8:			return 3;
+		case DeepDriveCaptureColorFormat::RGBHalf:		return 3 * 2;
+		case DeepDriveCaptureColorFormat::RGBFloat:		return 3 * 4;
+		case DeepDriveCaptureColorFormat::Gray8:		return 1;
+		case DeepDriveCaptureColorFormat::RawRGBAHalf:	return 4 * 2;
+		default:										return 0;
+	}
+}
+
+static uint32 getBytesPerDepthValue(DeepDriveCaptureDepthFormat format)
+{
+	switch(format)
+	{
+		case DeepDriveCaptureDepthFormat::Half:					return 2;
+		case DeepDriveCaptureDepthFormat::Float:				return 4;
+		case DeepDriveCaptureDepthFormat::UInt16Centimeters:	return 2;
+		case DeepDriveCaptureDepthFormat::UInt16Millimeters:	return 2;
+		case DeepDriveCaptureDepthFormat::RawHalf:				return 2;
+		default:												return 0;
+	}
+}
+
+/**
+	Rec. 709 luminance of sRGB encoded 8 bit RGB, weights sum up to 256
+*/
+static uint8 getLuminance(uint8 r, uint8 g, uint8 b)
+{
+	return static_cast<uint8> ( (54 * r + 183 * g + 19 * b + 128) >> 8 );
+}
+
+static uint16 getMillimeters(float depth)
+{
+	const float depthMM = depth * 10.0f;
+	// negated comparison also maps NaN to 0
+	return !(depthMM > 0.0f) ? 0 : (depthMM >= 65535.0f ? 65535 : static_cast<uint16> (depthMM + 0.5f));
+}
+
+/**
+	Color of a row of FloatRGBA pixels, 8 bit formats are sRGB encoded like packed captures, float formats stay linear
+*/
+static void convertColorRow(const FFloat16 *src, uint32 width, DeepDriveCaptureColorFormat format, uint8 *dst)
+{
+	switch(format)
+	{
+		case DeepDriveCaptureColorFormat::RGB8:
+			for(uint32 x = 0; x < width; x++, src += 4)
+			{
+				*dst++ = CapturePacking::packColor(src[0]);
+				*dst++ = CapturePacking::packColor(src[1]);
+				*dst++ = CapturePacking::packColor(src[2]);
+			}
+			break;
+
+		case DeepDriveCaptureColorFormat::RGBHalf:
+			{
+				FFloat16 *f16Dst = reinterpret_cast<FFloat16*> (dst);
+				for(uint32 x = 0; x < width; x++, src += 4)
+				{
+					*f16Dst++ = src[0];
+					*f16Dst++ = src[1];
+					*f16Dst++ = src[2];
+				}
+			}
+			break;
+
+		case DeepDriveCaptureColorFormat::RGBFloat:
+			{
+				float *f32Dst = reinterpret_cast<float*> (dst);
+				for(uint32 x = 0; x < width; x++, src += 4)
+				{
+					*f32Dst++ = src[0].GetFloat();
+					*f32Dst++ = src[1].GetFloat();
+					*f32Dst++ = src[2].GetFloat();
+				}
+			}
+			break;
+
+		case DeepDriveCaptureColorFormat::Gray8:
+			for(uint32 x = 0; x < width; x++, src += 4)
+				*dst++ = getLuminance(CapturePacking::packColor(src[0]), CapturePacking::packColor(src[1]), CapturePacking::packColor(src[2]));
+			break;
+
+		default:
+			break;
+	}
+}
+
+/**
+	Color of a row of packed BGRA pixels, float formats are decoded back to linear like unpacked captures
+*/
+static void convertColorRow(const uint8 *src, uint32 width, DeepDriveCaptureColorFormat format, uint8 *dst)
+{
+	switch(format)
+	{
+		case DeepDriveCaptureColorFormat::RGB8:
+			for(uint32 x = 0; x < width; x++, src += 4)
+			{
+				*dst++ = src[2];
+				*dst++ = src[1];
+				*dst++ = src[0];
+			}
+			break;
+
+		case DeepDriveCaptureColorFormat::RGBHalf:
+			{
+				FFloat16 *f16Dst = reinterpret_cast<FFloat16*> (dst);
+				for(uint32 x = 0; x < width; x++, src += 4)
+				{
+					(f16Dst++)->Set(CapturePacking::unpackColor(src[2]));
+					(f16Dst++)->Set(CapturePacking::unpackColor(src[1]));
+					(f16Dst++)->Set(CapturePacking::unpackColor(src[0]));
+				}
+			}
+			break;
+
+		case DeepDriveCaptureColorFormat::RGBFloat:
+			{
+				float *f32Dst = reinterpret_cast<float*> (dst);
+				for(uint32 x = 0; x < width; x++, src += 4)
+				{
+					*f32Dst++ = CapturePacking::unpackColor(src[2]);
+					*f32Dst++ = CapturePacking::unpackColor(src[1]);
+					*f32Dst++ = CapturePacking::unpackColor(src[0]);
+				}
+			}
+			break;
+
+		case DeepDriveCaptureColorFormat::Gray8:
+			for(uint32 x = 0; x < width; x++, src += 4)
+				*dst++ = getLuminance(src[2], src[1], src[0]);
+			break;
+
+		default:
+			break;
+	}
+}
+
+/**
+	Depth of a row of FloatRGBA pixels, stored in cm in alpha
+*/
+static void convertDepthRow(const FFloat16 *src, uint32 width, DeepDriveCaptureDepthFormat format, uint8 *dst)
+{
+	switch(format)
+	{
+		case DeepDriveCaptureDepthFormat::Half:
+			{
+				FFloat16 *f16Dst = reinterpret_cast<FFloat16*> (dst);
+				for(uint32 x = 0; x < width; x++, src += 4)
+					(f16Dst++)->Set(src[3].GetFloat() / 65535.0f);
+			}
+			break;
+
+		case DeepDriveCaptureDepthFormat::Float:
+			{
+				float *f32Dst = reinterpret_cast<float*> (dst);
+				for(uint32 x = 0; x < width; x++, src += 4)
+					*f32Dst++ = src[3].GetFloat() / 65535.0f;
+			}
+			break;
+
+		case DeepDriveCaptureDepthFormat::UInt16Centimeters:
+			{
+				uint16 *u16Dst = reinterpret_cast<uint16*> (dst);
+				for(uint32 x = 0; x < width; x++, src += 4)
+					*u16Dst++ = CapturePacking::packDepth(src[3]);
+			}
+			break;
+
+		case DeepDriveCaptureDepthFormat::UInt16Millimeters:
+			{
+				uint16 *u16Dst = reinterpret_cast<uint16*> (dst);
+				for(uint32 x = 0; x < width; x++, src += 4)
+					*u16Dst++ = getMillimeters(src[3].GetFloat());
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+/**
+	Depth of a row of packed captures, 16 bit unsigned values in cm
+*/
+static void convertDepthRow(const uint16 *src, uint32 width, DeepDriveCaptureDepthFormat format, uint8 *dst)
+{
+	switch(format)
+	{
+		case DeepDriveCaptureDepthFormat::Half:
+			{
+				FFloat16 *f16Dst = reinterpret_cast<FFloat16*> (dst);
+				for(uint32 x = 0; x < width; x++)
+					(f16Dst++)->Set(src[x] / 65535.0f);
+			}
+			break;
+
+		case DeepDriveCaptureDepthFormat::Float:
+			{
+				float *f32Dst = reinterpret_cast<float*> (dst);
+				for(uint32 x = 0; x < width; x++)
+					*f32Dst++ = src[x] / 65535.0f;
+			}
+			break;
+
+		case DeepDriveCaptureDepthFormat::UInt16Centimeters:
+			FMemory::Memcpy(dst, src, width * sizeof(uint16));
+			break;
+
+		case DeepDriveCaptureDepthFormat::UInt16Millimeters:
+			{
+				uint16 *u16Dst = reinterpret_cast<uint16*> (dst);
+				for(uint32 x = 0; x < width; x++)
+					*u16Dst++ = static_cast<uint16> (FMath::Min(src[x] * 10u, 65535u));
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+SharedMemCaptureMessageBuilder::SharedMemCaptureMessageBuilder(SharedMemory &sharedMem, uint32 maxMessageSize, const ICaptureBufferAllocator *captureBufferAllocator)
+	:	m_SharedMem(&sharedMem)
+	,	m_MaxMessageSize(maxMessageSize)
+	,	m_CaptureBufferAllocator(captureBufferAllocator)
+{
+}
+
+SharedMemCaptureMessageBuilder::SharedMemCaptureMessageBuilder(void *buffer, uint32 maxMessageSize)
+	:	m_Buffer(buffer)
+	,	m_MaxMessageSize(maxMessageSize)
+	,	m_CaptureBufferAllocator(0)
 {
 }
 
 void SharedMemCaptureMessageBuilder::begin(const FDeepDriveDataOut &deepDriveData, double timestamp, uint32 sequenceNumber)
 {
-	m_Message = reinterpret_cast<DeepDriveCaptureMessage*> (m_SharedMem.lockForWriting(0));
+	m_Message = reinterpret_cast<DeepDriveCaptureMessage*> (m_SharedMem ? m_SharedMem->lockForWriting(0) : m_Buffer);
 
 	if(m_Message)
 	{
@@ -57,7 +322,7 @@ void SharedMemCaptureMessageBuilder::begin(const FDeepDriveDataOut &deepDriveDat
 
 
 		m_MessageSize = sizeof(DeepDriveCaptureMessage);
-		m_remainingSize = m_SharedMem.getMaxPayloadSize() - sizeof(DeepDriveCaptureMessage);
+		m_remainingSize = m_MaxMessageSize - sizeof(DeepDriveCaptureMessage);
 		m_nextCamera = m_Message->cameras;
 		m_prevCamera = 0;
 		m_prevCameraSize = 0;
@@ -72,16 +337,30 @@ void SharedMemCaptureMessageBuilder::begin(const FDeepDriveDataOut &deepDriveDat
 
 void SharedMemCaptureMessageBuilder::addCamera(EDeepDriveCameraType camType, int32 camId, CaptureBuffer &captureBuffer)
 {
-	uint32 estimatedSize = sizeof(DeepDriveCaptureCamera);
 	const uint32 width = captureBuffer.getWidth();
 	const uint32 height = captureBuffer.getHeight();
 	const CaptureBuffer::DataType dataType = captureBuffer.getDataType();
 
-	estimatedSize += width * height * 3 * 2;		// 2 bytes per pixel rgb color buffer
-	estimatedSize += width * height * 2;			// 2 bytes per depth value
-
-	if	(	static_cast<int32> (estimatedSize) < m_remainingSize
-		&&	dataType == CaptureBuffer::Float16
+	// packed captures carry 8 bit color and 16 bit unsigned depth, unpacked ones half float color and depth.
+	// Captures read back into shared memory are referenced in their raw layout unless another format has been selected.
+	const bool isPacked = dataType == CaptureBuffer::UnsignedByte && captureBuffer.getDepthStride() > 0;
+	const bool isZeroCopy	=	dataType == CaptureBuffer::Float16
+						&&	captureBuffer.getColorFormat() == EDeepDriveCaptureColorFormat::Default
+						&&	captureBuffer.getDepthFormat() == EDeepDriveCaptureDepthFormat::Default
+						&&	isReferenced(captureBuffer);
+
+	const DeepDriveCaptureColorFormat colorFormat = isZeroCopy ? DeepDriveCaptureColorFormat::RawRGBAHalf : getColorFormat(captureBuffer.getColorFormat(), isPacked);
+	const DeepDriveCaptureDepthFormat depthFormat = isZeroCopy ? DeepDriveCaptureDepthFormat::RawHalf : getDepthFormat(captureBuffer.getDepthFormat(), isPacked);
+	const uint32 bytesPerPixel = getBytesPerPixel(colorFormat);
+	const uint32 bytesPerDepthValue = getBytesPerDepthValue(depthFormat);
+
+	// depth plane and next camera are kept aligned for 16 and 32 bit values
+	const uint32 depthOffset = isZeroCopy ? 3 * 2 : Align(width * height * bytesPerPixel, 4);
+	const uint32 dataSize = isZeroCopy ? 0 : depthOffset + width * height * bytesPerDepthValue;
+	const uint32 camMemSize = Align(static_cast<uint32> (sizeof(DeepDriveCaptureCamera)) + dataSize, 8);
+
+	if	(	static_cast<int32> (camMemSize) < m_remainingSize
+		&&	(dataType == CaptureBuffer::Float16 || isPacked)
 		)
 	{
 		DeepDriveCaptureCamera *curCamera = m_nextCamera;
@@ -89,36 +368,39 @@ void SharedMemCaptureMessageBuilder::addCamera(EDeepDriveCameraType camType, int
 		curCamera->type = static_cast<uint32> (camType);
 		curCamera->id = camId;
 		curCamera->offset_to_next_camera = 0;
+		curCamera->data_offset = 0;
+		curCamera->row_stride = 0;
 		curCamera->horizontal_field_of_view = 1.7654;
 		curCamera->aspect_ratio	= 1.0;
 		curCamera->capture_width = width;
 		curCamera->capture_height = height;
-		curCamera->bytes_per_pixel = 6;
-		curCamera->bytes_per_depth_value = 2;
-		curCamera->depth_offset = width * height * curCamera->bytes_per_pixel;
-
-		const FFloat16 *f16Src = captureBuffer.getBuffer<FFloat16>();
-		FFloat16 *colDst = reinterpret_cast<FFloat16*>( &curCamera->data[0] );
-		FFloat16 *depthDst = colDst + width * height * 3;
-
-		for(unsigned y = 0; y < height; y++)
+		curCamera->region_offset_x = captureBuffer.getRegionOffset().X;
+		curCamera->region_offset_y = captureBuffer.getRegionOffset().Y;
+		curCamera->downscale_factor = captureBuffer.getDownscaleFactor();
+		curCamera->bytes_per_pixel = bytesPerPixel;
+		curCamera->bytes_per_depth_value = bytesPerDepthValue;
+		curCamera->depth_offset = depthOffset;
+		curCamera->color_format = static_cast<uint16> (colorFormat);
+		curCamera->depth_format = static_cast<uint16> (depthFormat);
+
+		if(isZeroCopy)
 		{
-			uint32 ind = 0;
-			for(unsigned x = 0; x < width; x++)
-			{
-				*colDst++ = f16Src[ind++];
-				*colDst++ = f16Src[ind++];
-				*colDst++ = f16Src[ind++];
-
-				depthDst->Set(f16Src[ind++].GetFloat() / 65535.0f);
-				depthDst++;
-			}
-
-			f16Src = reinterpret_cast<const FFloat16*> (reinterpret_cast<const uint8*> (f16Src) + captureBuffer.getStride() );
+			// data already is in its final location, only point to it
+			curCamera->row_stride = captureBuffer.getStride();
+			curCamera->data_offset = static_cast<uint32> (captureBuffer.getBuffer<uint8>() - reinterpret_cast<uint8*> (curCamera));
+		}
+		else
+		{
+			SCameraConversion conversion;
+			conversion.camera = curCamera;
+			conversion.capture_buffer = &captureBuffer;
+			conversion.is_packed = isPacked;
+			conversion.color_format = colorFormat;
+			conversion.depth_format = depthFormat;
+			conversion.non_temporal = m_SharedMem != 0;
+			m_Conversions.Add(conversion);
 		}
 
-		// calc size for this camera
-		const uint32 camMemSize = width * height * (curCamera->bytes_per_pixel + curCamera->bytes_per_depth_value) + sizeof(DeepDriveCaptureCamera);
 		m_MessageSize += camMemSize;
 		m_remainingSize -= camMemSize;
 
@@ -138,11 +420,106 @@ void SharedMemCaptureMessageBuilder::addCamera(EDeepDriveCameraType camType, int
 
 }
 
+bool SharedMemCaptureMessageBuilder::isReferenced(const CaptureBuffer &captureBuffer) const
+{
+	return m_CaptureBufferAllocator && m_CaptureBufferAllocator->contains(captureBuffer.getBuffer<void>());
+}
+
+void SharedMemCaptureMessageBuilder::convertRows(const SCameraConversion &conversion, uint32 firstRow, uint32 numRows) const
+{
+	if(conversion.is_packed)
+		convertPackedRows(conversion, firstRow, numRows);
+	else
+		convertFloat16Rows(conversion, firstRow, numRows);
+}
+
+void SharedMemCaptureMessageBuilder::convertPackedRows(const SCameraConversion &conversion, uint32 firstRow, uint32 numRows)
+{
+	const DeepDriveCaptureCamera &camera = *conversion.camera;
+	const CaptureBuffer &captureBuffer = *conversion.capture_buffer;
+	const uint32 width = captureBuffer.getWidth();
+
+	uint8 *colDst = conversion.camera->data + firstRow * width * camera.bytes_per_pixel;
+	uint8 *depthDst = conversion.camera->data + camera.depth_offset + firstRow * width * camera.bytes_per_depth_value;
+
+	const uint8 *colSrc = captureBuffer.getBuffer<uint8>() + firstRow * captureBuffer.getStride();
+	const uint8 *depthSrc = captureBuffer.getDepthBuffer<uint8>() + firstRow * captureBuffer.getDepthStride();
+
+	for(uint32 y = 0; y < numRows; y++)
+	{
+		convertColorRow(colSrc, width, conversion.color_format, colDst);
+		convertDepthRow(reinterpret_cast<const uint16*> (depthSrc), width, conversion.depth_format, depthDst);
+
+		colDst += width * camera.bytes_per_pixel;
+		depthDst += width * camera.bytes_per_depth_value;
+
+		colSrc += captureBuffer.getStride();
+		depthSrc += captureBuffer.getDepthStride();
+	}
+}
+
+void SharedMemCaptureMessageBuilder::convertFloat16Rows(const SCameraConversion &conversion, uint32 firstRow, uint32 numRows)
+{
+	const DeepDriveCaptureCamera &camera = *conversion.camera;
+	const CaptureBuffer &captureBuffer = *conversion.capture_buffer;
+	const uint32 width = captureBuffer.getWidth();
+
+	// the default layout has vectorized kernels
+	const bool isSplitOnly	=	conversion.color_format == DeepDriveCaptureColorFormat::RGBHalf
+						&&	conversion.depth_format == DeepDriveCaptureDepthFormat::Half;
+
+	const FFloat16 *f16Src = reinterpret_cast<const FFloat16*> (captureBuffer.getBuffer<uint8>() + firstRow * captureBuffer.getStride());
+	uint8 *colDst = conversion.camera->data + firstRow * width * camera.bytes_per_pixel;
+	uint8 *depthDst = conversion.camera->data + camera.depth_offset + firstRow * width * camera.bytes_per_depth_value;
+
+	for(uint32 y = 0; y < numRows; y++)
+	{
+		if(isSplitOnly)
+		{
+			// a message in shared memory is read by the client process only, so it is kept out of this thread's cache
+			CaptureConversion::splitColorDepth(f16Src, width, reinterpret_cast<FFloat16*> (colDst), reinterpret_cast<FFloat16*> (depthDst), 65535.0f, conversion.non_temporal);
+		}
+		else
+		{
+			convertColorRow(f16Src, width, conversion.color_format, colDst);
+			convertDepthRow(f16Src, width, conversion.depth_format, depthDst);
+		}
+
+		colDst += width * camera.bytes_per_pixel;
+		depthDst += width * camera.bytes_per_depth_value;
+
+		f16Src = reinterpret_cast<const FFloat16*> (reinterpret_cast<const uint8*> (f16Src) + captureBuffer.getStride() );
+	}
+}
 
 void SharedMemCaptureMessageBuilder::flush()
 {
 	if(m_Message)
 	{
+		// slots of all cameras are known, so bands of rows can be converted independently
+		TArray<SConversionBand, TInlineAllocator<MaxInlineBands> > bands;
+		for(int32 i = 0; i < m_Conversions.Num(); ++i)
+		{
+			const uint32 height = m_Conversions[i].capture_buffer->getHeight();
+			for(uint32 firstRow = 0; firstRow < height; firstRow += RowsPerBand)
+			{
+				SConversionBand band;
+				band.conversion_index = i;
+				band.first_row = firstRow;
+				band.num_rows = FMath::Min(height - firstRow, static_cast<uint32> (RowsPerBand));
+				bands.Add(band);
+			}
+		}
+
+		ParallelFor(bands.Num(), [this, &bands](int32 bandIndex)
+			{
+				const SConversionBand &band = bands[bandIndex];
+				convertRows(m_Conversions[band.conversion_index], band.first_row, band.num_rows);
+			}
+			, bands.Num() <= 1
+		);
+		m_Conversions.Reset();
+
 		m_Message->message_size = m_MessageSize;
 		m_Message->setMessageId();
 
@@ -155,7 +532,8 @@ void SharedMemCaptureMessageBuilder::flush()
 		}
 #endif
 
-		m_SharedMem.unlock(m_MessageSize);
+		if(m_SharedMem)
+			m_SharedMem->unlock(m_MessageSize);
 //		UE_LOG(LogSharedMemCaptureMessageBuilder, Log, TEXT("SharedMemCaptureMessageBuilder::flush Flushed message %d msgSize %d"), m_Message->message_id, m_MessageSize);
 	}
 }
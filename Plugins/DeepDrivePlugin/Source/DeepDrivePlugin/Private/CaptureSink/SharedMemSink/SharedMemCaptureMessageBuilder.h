@@ -6,16 +6,55 @@
 DECLARE_LOG_CATEGORY_EXTERN(LogSharedMemCaptureMessageBuilder, Log, All);
 
 class SharedMemory;
+class ICaptureBufferAllocator;
 struct FDeepDriveDataOut;
 struct DeepDriveCaptureMessage;
 struct DeepDriveCaptureCamera;
+enum class DeepDriveCaptureColorFormat : uint16;
+enum class DeepDriveCaptureDepthFormat : uint16;
 
+/**
+	addCamera only reserves a camera's slot in the message and fills in its header. Pixel data is converted by flush,
+	split into bands of rows which are converted in parallel before the message is published.
+	Color and depth are converted into the formats selected for the capture, see DeepDriveCaptureColorFormat and DeepDriveCaptureDepthFormat.
+*/
 class SharedMemCaptureMessageBuilder
 {
+	struct SCameraConversion
+	{
+		DeepDriveCaptureCamera		*camera;
+		const CaptureBuffer			*capture_buffer;
+		bool						is_packed;
+		DeepDriveCaptureColorFormat	color_format;
+		DeepDriveCaptureDepthFormat	depth_format;
+		bool						non_temporal;			// destination isn't read again by this process
+	};
+
+	struct SConversionBand
+	{
+		int32						conversion_index;
+		uint32						first_row;
+		uint32						num_rows;
+	};
+
+	enum
+	{
+		RowsPerBand = 64,
+		MaxInlineCameras = 8,
+		MaxInlineBands = 128
+	};
 
 public:
 
-	SharedMemCaptureMessageBuilder(SharedMemory &sharedMem);
+	/**
+		maxMessageSize limits the message to the beginning of the shared memory, captures located in the arena of captureBufferAllocator behind it are referenced instead of copied
+	*/
+	SharedMemCaptureMessageBuilder(SharedMemory &sharedMem, uint32 maxMessageSize, const ICaptureBufferAllocator *captureBufferAllocator = 0);
+
+	/**
+		Build the message into buffer instead, e.g. to store it in a file. It is converted with regular stores, as the caller reads it right away.
+	*/
+	SharedMemCaptureMessageBuilder(void *buffer, uint32 maxMessageSize);
 
 	void begin(const FDeepDriveDataOut &deepDriveData, double timestamp, uint32 sequenceNumber);
 
@@ -23,9 +62,25 @@ public:
 
 	void flush();
 
+	bool isReferenced(const CaptureBuffer &captureBuffer) const;
+
+	/**
+		Size of the message built, valid after flush
+	*/
+	uint32 getMessageSize() const;
+
 private:
 
-	SharedMemory					&m_SharedMem;
+	void convertRows(const SCameraConversion &conversion, uint32 firstRow, uint32 numRows) const;
+
+	static void convertPackedRows(const SCameraConversion &conversion, uint32 firstRow, uint32 numRows);
+
+	static void convertFloat16Rows(const SCameraConversion &conversion, uint32 firstRow, uint32 numRows);
+
+	SharedMemory					*m_SharedMem = 0;
+	void							*m_Buffer = 0;
+	uint32							m_MaxMessageSize;
+	const ICaptureBufferAllocator	*m_CaptureBufferAllocator;
 
 	DeepDriveCaptureMessage			*m_Message = 0;
 
@@ -35,4 +90,12 @@ private:
 	DeepDriveCaptureCamera			*m_nextCamera = 0;
 	DeepDriveCaptureCamera			*m_prevCamera = 0;
 	uint32							m_prevCameraSize = 0;
+
+	TArray<SCameraConversion, TInlineAllocator<MaxInlineCameras> >	m_Conversions;
 };
+
+
+inline uint32 SharedMemCaptureMessageBuilder::getMessageSize() const
+{
+	return m_MessageSize;
+}
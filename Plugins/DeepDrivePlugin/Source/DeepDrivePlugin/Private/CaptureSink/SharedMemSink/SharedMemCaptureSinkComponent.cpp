@@ -8,6 +8,8 @@
 
 DEFINE_LOG_CATEGORY(LogSharedMemCaptureSinkComponent);
 
+// names of shared memory sinks which have begun play, only touched on the game thread
+static TSet<FString> theSharedMemoryNames;
 
 
 USharedMemCaptureSinkComponent::USharedMemCaptureSinkComponent()
@@ -22,7 +24,16 @@ void USharedMemCaptureSinkComponent::BeginPlay()
 
 	UE_LOG(LogSharedMemCaptureSinkComponent, Log, TEXT("USharedMemCaptureSinkComponent::InitializeComponent"));
 	m_SharedMemoryName = UGameplayStatics::GetPlatformName() == "Linux" ? SharedMemNameLinux : SharedMemNameWindows;
-	m_Worker = new SharedMemCaptureSinkWorker(m_SharedMemoryName, MaxSharedMemSize);
+
+	// sinks of several capture proxies configured alike get unique names, the first one keeps the configured name
+	const FString configuredName = m_SharedMemoryName;
+	for(int32 i = 2; theSharedMemoryNames.Contains(m_SharedMemoryName); ++i)
+		m_SharedMemoryName = configuredName + TEXT("_") + FString::FromInt(i);
+	if(m_SharedMemoryName != configuredName)
+		UE_LOG(LogSharedMemCaptureSinkComponent, Log, TEXT("Shared memory %s already in use, publishing to %s"), *configuredName, *m_SharedMemoryName);
+	theSharedMemoryNames.Add(m_SharedMemoryName);
+
+	m_Worker = new SharedMemCaptureSinkWorker(m_SharedMemoryName, MaxSharedMemSize, static_cast<uint32> (FMath::Max(ZeroCopyArenaSize, 0)));
 }
 
 void USharedMemCaptureSinkComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
@@ -31,11 +42,27 @@ void USharedMemCaptureSinkComponent::EndPlay(const EEndPlayReason::Type EndPlayR
 
 	UE_LOG(LogSharedMemCaptureSinkComponent, Log, TEXT("USharedMemCaptureSinkComponent::DestroyComponent"));
 	delete m_Worker;
+	m_Worker = 0;
+
+	theSharedMemoryNames.Remove(m_SharedMemoryName);
+}
+
+void USharedMemCaptureSinkComponent::updateSettings()
+{
+	if(m_Worker)
+		m_Worker->setQueueLimit(MaxQueuedJobs, QueuePolicy);
 }
 
 void USharedMemCaptureSinkComponent::begin(double timestamp, uint32 sequenceNumber, const FDeepDriveDataOut &deepDriveData)
 {
-	m_curJobData = new SharedMemCaptureSinkWorker::SSharedMemCaptureSinkJobData(timestamp, sequenceNumber, deepDriveData);
+	SharedMemCaptureSinkWorker::SSharedMemCaptureSinkJobData *jobData = m_Worker ? m_Worker->acquireJobData() : 0;
+	if(jobData)
+	{
+		jobData->timestamp = timestamp;
+		jobData->sequence_number = sequenceNumber;
+		jobData->deep_drive_data = deepDriveData;
+	}
+	m_curJobData = jobData;
 }
 
 void USharedMemCaptureSinkComponent::setCaptureBuffer(int32 cameraId, EDeepDriveCameraType cameraType, CaptureBuffer &captureBuffer)
@@ -53,5 +80,26 @@ void USharedMemCaptureSinkComponent::flush()
 		)
 	{
 		m_Worker->process(*m_curJobData);
+		m_curJobData = 0;
 	}
 }
+
+bool USharedMemCaptureSinkComponent::waitForPublishing(uint32 sequenceNumber, float timeoutSeconds)
+{
+	return m_Worker ? m_Worker->waitForJob(sequenceNumber, timeoutSeconds) : true;
+}
+
+int32 USharedMemCaptureSinkComponent::getPendingJobCount() const
+{
+	return m_Worker ? m_Worker->getPendingJobCount() : 0;
+}
+
+int32 USharedMemCaptureSinkComponent::getDroppedJobCount() const
+{
+	return m_Worker ? m_Worker->getDroppedJobCount() : 0;
+}
+
+TSharedPtr<ICaptureBufferAllocator, ESPMode::ThreadSafe> USharedMemCaptureSinkComponent::getCaptureBufferAllocator() const
+{
+	return m_Worker ? m_Worker->getCaptureBufferAllocator() : CaptureBufferAllocatorPtr();
+}
@@ -3,23 +3,42 @@
 
 #include "Private/CaptureSink/SharedMemSink/SharedMemCaptureSinkWorker.h"
 #include "Private/CaptureSink/SharedMemSink/SharedMemCaptureMessageBuilder.h"
+#include "Private/CaptureSink/SharedMemSink/SharedMemCaptureBufferAllocator.h"
+#include "Private/Capture/CaptureBuffer.h"
 
 #include "Public/SharedMemory/SharedMemory.h"
 
 DEFINE_LOG_CATEGORY(LogSharedMemCaptureSinkWorker);
 
-SharedMemCaptureSinkWorker::SharedMemCaptureSinkWorker(const FString &sharedMemName, uint32 maxSharedMemSize)
+SharedMemCaptureSinkWorker::SharedMemCaptureSinkWorker(const FString &sharedMemName, uint32 maxSharedMemSize, uint32 zeroCopyArenaSize)
 	: CaptureSinkWorkerBase("SharedMemCaptureSinkWorker")
 {
 	UE_LOG(LogSharedMemCaptureSinkComponent, Log, TEXT("SharedMemCaptureSinkWorker::SharedMemCaptureSinkWorker"));
-	m_SharedMemory = new SharedMemory();
-	if (m_SharedMemory)
+	m_SharedMemory = MakeShareable(new SharedMemory());
+	if (m_SharedMemory.IsValid())
 	{
 		m_SharedMemory->create(sharedMemName, maxSharedMemSize);
 
+		const uint32 maxPayloadSize = static_cast<uint32> (FMath::Max(m_SharedMemory->getMaxPayloadSize(), 0));
+		m_MaxMessageSize = maxPayloadSize;
+
 		DeepDriveMessageHeader *message = reinterpret_cast<DeepDriveMessageHeader*> (m_SharedMemory->lockForWriting(-1));
 		if(message)
 		{
+			// the mapping stays at the same address, so the arena can be handed out without holding the lock
+			if	(	zeroCopyArenaSize > 0
+				&&	zeroCopyArenaSize < maxPayloadSize / 2
+				)
+			{
+				uint8 *payload = reinterpret_cast<uint8*> (message);
+				uint8 *arena = Align(payload + maxPayloadSize - zeroCopyArenaSize, static_cast<uint32> (SharedMemCaptureBufferAllocator::Alignment));
+				m_MaxMessageSize = static_cast<uint32> (arena - payload);
+				m_CaptureBufferAllocator = MakeShareable(new SharedMemCaptureBufferAllocator(m_SharedMemory, arena, maxPayloadSize - m_MaxMessageSize));
+				UE_LOG(LogSharedMemCaptureSinkComponent, Log, TEXT("Zero copy arena of %d bytes at offset %d"), maxPayloadSize - m_MaxMessageSize, m_MaxMessageSize);
+			}
+			else if(zeroCopyArenaSize > 0)
+				UE_LOG(LogSharedMemCaptureSinkComponent, Error, TEXT("Zero copy arena of %d bytes doesn't fit into shared memory of %d bytes"), zeroCopyArenaSize, maxPayloadSize);
+
 			message = new (message) DeepDriveMessageHeader(DeepDriveMessageType::Undefined, 0);
 			message->setMessageId();
 			m_SharedMemory->unlock(sizeof(DeepDriveMessageHeader));
@@ -30,19 +49,28 @@ SharedMemCaptureSinkWorker::SharedMemCaptureSinkWorker(const FString &sharedMemN
 SharedMemCaptureSinkWorker::~SharedMemCaptureSinkWorker()
 {
 	UE_LOG(LogSharedMemCaptureSinkComponent, Log, TEXT("SharedMemCaptureSinkWorker::~SharedMemCaptureSinkWorker"));
-	delete m_SharedMemory;
+	shutdown();
+	m_PublishedBuffers.Empty();
+	// buffers still allocated in the arena keep the shared memory alive
+	m_CaptureBufferAllocator.Reset();
+	m_SharedMemory.Reset();
 }
 
 
+void SharedMemCaptureSinkWorker::releaseJobData(SCaptureSinkJobData &jobData)
+{
+	m_JobDataPool.release(static_cast<SSharedMemCaptureSinkJobData*> (&jobData));
+}
+
 bool SharedMemCaptureSinkWorker::execute(SCaptureSinkJobData &jobData)
 {
 	bool res = false;
 
 	SSharedMemCaptureSinkJobData &sharedMemJobData = static_cast<SSharedMemCaptureSinkJobData&> (jobData);
 
-	if(m_SharedMemory)
+	if(m_SharedMemory.IsValid())
 	{
-		SharedMemCaptureMessageBuilder messageBuilder(*m_SharedMemory);
+		SharedMemCaptureMessageBuilder messageBuilder(*m_SharedMemory, m_MaxMessageSize, m_CaptureBufferAllocator.Get());
 
 		const double before = FPlatformTime::Seconds();
 
@@ -52,7 +80,7 @@ bool SharedMemCaptureSinkWorker::execute(SCaptureSinkJobData &jobData)
 		{
 			const EDeepDriveCameraType camType = captureBufferData.camera_type;
 			const int32 camId = captureBufferData.camera_id;
-			CaptureBuffer *captureBuffer = captureBufferData.capture_buffer;
+			CaptureBuffer *captureBuffer = captureBufferData.capture_buffer.get();
 
 			if(captureBuffer)
 			{
@@ -62,6 +90,16 @@ bool SharedMemCaptureSinkWorker::execute(SCaptureSinkJobData &jobData)
 
 		messageBuilder.flush();
 
+		// keep leases on zero copy buffers of the new message, the previous ones are no longer published
+		m_PublishedBuffers.Reset();
+		for(SCaptureSinkBufferData &captureBufferData : sharedMemJobData.captures)
+		{
+			if	(	captureBufferData.capture_buffer.isValid()
+				&&	messageBuilder.isReferenced(*captureBufferData.capture_buffer.get())
+				)
+				m_PublishedBuffers.Add(captureBufferData.capture_buffer);
+		}
+
 		const double after = FPlatformTime::Seconds();
 		double duration = (after - before) * 1000.0;
 		m_TotalSavingTime += static_cast<float> (duration);
@@ -3,6 +3,8 @@
 
 #include "Private/CaptureSink/CaptureSinkWorkerBase.h"
 #include "Public/DeepDriveData.h"
+#include "Private/Capture/ICaptureBufferAllocator.h"
+#include "Private/Capture/CaptureObjectPool.h"
 
 
 DECLARE_LOG_CATEGORY_EXTERN(LogSharedMemCaptureSinkWorker, Log, All);
@@ -16,28 +18,47 @@ public:
 
 	struct SSharedMemCaptureSinkJobData : public SCaptureSinkJobData
 	{
-		SSharedMemCaptureSinkJobData(double timestamp, uint32 seqNr, const FDeepDriveDataOut &deepDriveData)
-			: SCaptureSinkJobData(timestamp, seqNr)
-			, deep_drive_data(deepDriveData)
-		{
-		}
-
 		FDeepDriveDataOut		deep_drive_data;
 	};
 
-	SharedMemCaptureSinkWorker(const FString &sharedMemName, uint32 maxSharedMemSize);
+	/**
+		A zeroCopyArenaSize > 0 reserves that many bytes at the end of the shared memory for capture buffers being published in place
+	*/
+	SharedMemCaptureSinkWorker(const FString &sharedMemName, uint32 maxSharedMemSize, uint32 zeroCopyArenaSize = 0);
 	virtual ~SharedMemCaptureSinkWorker();
 
+	const CaptureBufferAllocatorPtr& getCaptureBufferAllocator() const;
+
+	SSharedMemCaptureSinkJobData* acquireJobData();
+
 protected:
 
 	virtual bool execute(SCaptureSinkJobData &jobData);
 
+	virtual void releaseJobData(SCaptureSinkJobData &jobData);
+
 private:
 
-	SharedMemory			*m_SharedMemory = 0;
+	TSharedPtr<SharedMemory, ESPMode::ThreadSafe>	m_SharedMemory;
+	uint32					m_MaxMessageSize = 0;
+
+	CaptureBufferAllocatorPtr		m_CaptureBufferAllocator;
+	TArray<CaptureBufferLease>		m_PublishedBuffers;			// zero copy buffers referenced by the published message
+
+	CaptureObjectPool<SSharedMemCaptureSinkJobData>	m_JobDataPool;
 
 	float					m_TotalSavingTime = 0.0f;
 	float					m_SaveCount = 0.0f;
 	double					m_lastLoggingTimestamp = 0.0f;
 
 };
+
+inline const CaptureBufferAllocatorPtr& SharedMemCaptureSinkWorker::getCaptureBufferAllocator() const
+{
+	return m_CaptureBufferAllocator;
+}
+
+inline SharedMemCaptureSinkWorker::SSharedMemCaptureSinkJobData* SharedMemCaptureSinkWorker::acquireJobData()
+{
+	return m_JobDataPool.acquire();
+}
@@ -0,0 +1,23 @@
+
+#include "DeepDrivePluginPrivatePCH.h"
+#include "Private/ConsoleBenchmark.h"
+
+DEFINE_LOG_CATEGORY(LogDeepDriveBenchmark);
+
+ConsoleBenchmark::ConsoleBenchmark(const TCHAR *name, const TArray<FString> &args)
+	:	m_Name(name)
+	,	m_Args(args)
+{
+	FString commandLine(name);
+	for(const FString &arg : args)
+		commandLine += TEXT(" ") + arg;
+	UE_LOG(LogDeepDriveBenchmark, Log, TEXT("%s"), *commandLine);
+
+	start();
+}
+
+bool ConsoleBenchmark::logResult(bool passed) const
+{
+	UE_LOG(LogDeepDriveBenchmark, Log, TEXT("%s %s"), m_Name, passed ? TEXT("passed") : TEXT("FAILED"));
+	return passed;
+}
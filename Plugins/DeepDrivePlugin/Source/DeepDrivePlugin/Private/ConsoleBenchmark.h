@@ -0,0 +1,76 @@
+
+#pragma once
+
+#include "Engine.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogDeepDriveBenchmark, Log, All);
+
+/**
+	Common part of the DeepDrive.Benchmark* and DeepDrive.Check* console commands.
+	Parses their arguments, times the runs and logs under LogDeepDriveBenchmark, starting with the command line run.
+*/
+class ConsoleBenchmark
+{
+public:
+
+	ConsoleBenchmark(const TCHAR *name, const TArray<FString> &args);
+
+	/**
+		Argument at index as integer of at least 1, defaultValue if it wasn't given
+	*/
+	int32 getIntArg(int32 index, int32 defaultValue) const;
+
+	FString getStringArg(int32 index, const FString &defaultValue) const;
+
+	/**
+		Restart timing
+	*/
+	void start();
+
+	/**
+		Seconds since the last start
+	*/
+	double getElapsed() const;
+
+	/**
+		amount per second, 0 if no time has passed
+	*/
+	static double getRate(double amount, double duration);
+
+	/**
+		Log whether the benchmark's checks passed, returns passed
+	*/
+	bool logResult(bool passed) const;
+
+private:
+
+	const TCHAR					*m_Name;
+	const TArray<FString>		&m_Args;
+	double						m_StartTime = 0.0;
+};
+
+
+inline int32 ConsoleBenchmark::getIntArg(int32 index, int32 defaultValue) const
+{
+	return m_Args.Num() > index ? FMath::Max(FCString::Atoi(*m_Args[index]), 1) : defaultValue;
+}
+
+inline FString ConsoleBenchmark::getStringArg(int32 index, const FString &defaultValue) const
+{
+	return m_Args.Num() > index ? m_Args[index] : defaultValue;
+}
+
+inline void ConsoleBenchmark::start()
+{
+	m_StartTime = FPlatformTime::Seconds();
+}
+
+inline double ConsoleBenchmark::getElapsed() const
+{
+	return FPlatformTime::Seconds() - m_StartTime;
+}
+
+inline double ConsoleBenchmark::getRate(double amount, double duration)
+{
+	return duration > 0.0 ? amount / duration : 0.0;
+}
@@ -8,5 +8,6 @@
 
 void UDeepDrivePluginBPFunctionLibrary::Capture()
 {
-	DeepDriveCapture::GetInstance().Capture();
+	for(DeepDriveCapture *captureContext : DeepDriveCapture::GetContexts())
+		captureContext->Capture();
 }
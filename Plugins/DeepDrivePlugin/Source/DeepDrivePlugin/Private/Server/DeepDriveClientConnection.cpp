@@ -8,7 +8,6 @@
 #include "Public/Server/Messages/DeepDriveServerConnectionMessages.h"
 #include "Public/Server/Messages/DeepDriveServerConfigurationMessages.h"
 
-#include "Public/CaptureSink/SharedMemSink/SharedMemCaptureSinkComponent.h"
 #include "Private/Server/DeepDriveServer.h"
 
 #include "Private/Capture/DeepDriveCapture.h"
@@ -47,6 +46,8 @@ bool DeepDriveClientConnection::Init()
 	m_MessageHandlers[deepdrive::server::MessageId::ReleaseAgentControlRequest] = forward2Server;
 	m_MessageHandlers[deepdrive::server::MessageId::SetAgentControlValuesRequest] = forward2Server;
 	m_MessageHandlers[deepdrive::server::MessageId::ResetAgentRequest] = forward2Server;
+	m_MessageHandlers[deepdrive::server::MessageId::SetLockstepModeRequest] = forward2Server;
+	m_MessageHandlers[deepdrive::server::MessageId::AdvanceSimulationRequest] = forward2Server;
 
 
 	m_MessageAssembler.m_HandleMessage.BindRaw(this, &DeepDriveClientConnection::handleClientRequest);
@@ -126,6 +127,8 @@ void DeepDriveClientConnection::registerClient(const deepdrive::server::MessageH
 	const RegisterClientRequest &regClient = static_cast<const RegisterClientRequest &> (message);
 
 	m_isMaster = regClient.request_master_role > 0 ? true : false;
+	// clients older than protocol version 2 don't send a capture proxy index
+	m_CaptureProxyIndex = message.message_size >= sizeof(RegisterClientRequest) ? regClient.capture_proxy_index : 0;
 	m_ClientId = DeepDriveServer::GetInstance().registerClient(this, m_isMaster);
 
 	UE_LOG(LogDeepDriveClientConnection, Log, TEXT("[%d] Client wants to register reqMaster %c isMaster %c"), m_ClientId, regClient.request_master_role ? 'T' : 'F', m_isMaster ? 'T' : 'F');
@@ -141,16 +144,17 @@ void DeepDriveClientConnection::registerClient(const deepdrive::server::MessageH
 
 	strncpy(response.server_protocol_version, TCHAR_TO_ANSI(*buildTimeStamp), RegisterClientResponse::ServerProtocolStringSize - 1);
 
-	USharedMemCaptureSinkComponent *sharedMemSink = DeepDriveCapture::GetInstance().getSharedMemorySink();
-	if (sharedMemSink)
+	// every capture proxy publishes into shared memory of its own, looked up without touching the game thread's objects
+	FString sharedMemName;
+	uint32 sharedMemSize = 0;
+	if (DeepDriveCapture::GetSharedMemory(m_CaptureProxyIndex, sharedMemName, sharedMemSize))
 	{
-		const FString &sharedMemName = sharedMemSink->getSharedMemoryName();
 		strncpy(response.shared_memory_name, TCHAR_TO_ANSI(*sharedMemName), RegisterClientResponse::SharedMemNameSize - 1);
 		response.shared_memory_name[RegisterClientResponse::SharedMemNameSize - 1] = 0;
-		response.shared_memory_size = sharedMemSink->MaxSharedMemSize;
+		response.shared_memory_size = sharedMemSize;
 	}
 	else
-		UE_LOG(LogDeepDriveClientConnection, Log, TEXT("PANIC: No SharedMemSink found"));
+		UE_LOG(LogDeepDriveClientConnection, Log, TEXT("PANIC: No SharedMemSink found for capture proxy %d"), m_CaptureProxyIndex);
 
 
 	response.max_supported_cameras = 8;
@@ -45,6 +45,11 @@ public:
 
 	bool isMaster() const;
 
+	/**
+		Index of the capture proxy whose shared memory the client reads, see DeepDriveCapture::GetContext
+	*/
+	uint32 getCaptureProxyIndex() const;
+
 private:
 
 	void shutdown();
@@ -72,6 +77,7 @@ private:
 	DeepDriveMessageAssembler			m_MessageAssembler;
 
 	bool								m_isMaster = false;
+	uint32								m_CaptureProxyIndex = 0;
 
 	MessageHandlers						m_MessageHandlers;
 
@@ -82,3 +88,8 @@ inline bool DeepDriveClientConnection::isMaster() const
 {
 	return m_isMaster;
 }
+
+inline uint32 DeepDriveClientConnection::getCaptureProxyIndex() const
+{
+	return m_CaptureProxyIndex;
+}
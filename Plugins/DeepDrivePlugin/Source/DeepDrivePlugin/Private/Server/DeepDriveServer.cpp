@@ -9,6 +9,8 @@
 #include "Public/Server/Messages/DeepDriveServerConfigurationMessages.h"
 #include "Public/Server/Messages/DeepDriveServerControlMessages.h"
 
+#include "Private/Capture/DeepDriveCapture.h"
+
 #include "Runtime/Networking/Public/Interfaces/IPv4/IPv4SubnetMask.h"
 #include "Runtime/Networking/Public/Interfaces/IPv4/IPv4Address.h"
 #include "Runtime/Sockets/Public/IPAddress.h"
@@ -44,6 +46,9 @@ DeepDriveServer::DeepDriveServer()
 	m_MessageHandlers[deepdrive::server::MessageId::ReleaseAgentControlRequest] = std::bind(&DeepDriveServer::handleReleaseAgentControl, this, std::placeholders::_1);
 	m_MessageHandlers[deepdrive::server::MessageId::SetAgentControlValuesRequest] = std::bind(&DeepDriveServer::setAgentControlValues, this, std::placeholders::_1);
 	m_MessageHandlers[deepdrive::server::MessageId::ResetAgentRequest] = std::bind(&DeepDriveServer::resetAgent, this, std::placeholders::_1);
+
+	m_MessageHandlers[deepdrive::server::MessageId::SetLockstepModeRequest] = std::bind(&DeepDriveServer::setLockstepMode, this, std::placeholders::_1);
+	m_MessageHandlers[deepdrive::server::MessageId::AdvanceSimulationRequest] = std::bind(&DeepDriveServer::advanceSimulation, this, std::placeholders::_1);
 }
 
 DeepDriveServer::~DeepDriveServer()
@@ -97,6 +102,8 @@ void DeepDriveServer::UnregisterProxy(ADeepDriveServerProxy &proxy)
 {
 	if (m_Proxy == &proxy)
 	{
+		leaveLockstepMode();
+
 		if (m_ConnectionListener)
 		{
 			m_ConnectionListener->terminate();
@@ -162,6 +169,8 @@ void DeepDriveServer::update(float DeltaSeconds)
 		DeepDriveClientConnection *client = new DeepDriveClientConnection(incoming->socket);
 	}
 
+	updateLockstep();
+
 	deepdrive::server::MessageHeader *message = 0;
 	if	(	m_MessageQueue.Dequeue(message)
 		&&	message
@@ -328,6 +337,156 @@ void DeepDriveServer::setAgentControlValues(const deepdrive::server::MessageHead
 	}
 }
 
+void DeepDriveServer::setLockstepMode(const deepdrive::server::MessageHeader &message)
+{
+	if (m_Clients.Num() > 0)
+	{
+		const deepdrive::server::SetLockstepModeRequest &req = static_cast<const deepdrive::server::SetLockstepModeRequest&> (message);
+		SClient *clientData = m_Clients.Find(req.client_id);
+		DeepDriveClientConnection *client = clientData ? clientData->connection : 0;
+		if (client)
+		{
+			if (client->isMaster())
+			{
+				if (req.enabled)
+				{
+					if (m_LockstepState == LockstepState::Off)
+						enterLockstepMode(req.fixed_delta_time);
+					m_LockstepClientId = req.client_id;
+				}
+				else
+					leaveLockstepMode();
+
+				UE_LOG(LogDeepDriveServer, Log, TEXT("[%d] Lockstep mode %s"), req.client_id, m_LockstepState != LockstepState::Off ? TEXT("enabled") : TEXT("disabled"));
+			}
+			else
+				UE_LOG(LogDeepDriveServer, Log, TEXT("Client %d isn't master, lockstep mode not changed"), req.client_id);
+
+			client->enqueueResponse(new deepdrive::server::SetLockstepModeResponse(m_LockstepState != LockstepState::Off));
+		}
+	}
+}
+
+void DeepDriveServer::advanceSimulation(const deepdrive::server::MessageHeader &message)
+{
+	if (m_Clients.Num() > 0)
+	{
+		const deepdrive::server::AdvanceSimulationRequest &req = static_cast<const deepdrive::server::AdvanceSimulationRequest&> (message);
+		SClient *clientData = m_Clients.Find(req.client_id);
+		DeepDriveClientConnection *client = clientData ? clientData->connection : 0;
+		if (client)
+		{
+			if	(	client->isMaster()
+				&&	m_LockstepState == LockstepState::Idle
+				)
+			{
+				m_Proxy->SetAgentControlValues(req.steering, req.throttle, req.brake, req.handbrake != 0 ? true : false);
+
+				m_LockstepClientId = req.client_id;
+				m_LockstepStepsRemaining = FMath::Max(req.num_steps, 1u);
+				m_LockstepState = LockstepState::Stepping;
+				UGameplayStatics::SetGamePaused(m_Proxy, false);
+			}
+			else
+			{
+				UE_LOG(LogDeepDriveServer, Log, TEXT("Client %d can't advance simulation, not master or not in lockstep mode"), req.client_id);
+				client->enqueueResponse(new deepdrive::server::AdvanceSimulationResponse(false));
+			}
+		}
+	}
+}
+
+bool DeepDriveServer::enterLockstepMode(float fixedDeltaTime)
+{
+	if (UGameplayStatics::SetGamePaused(m_Proxy, true))
+	{
+		m_prevUseFixedTimeStep = FApp::UseFixedTimeStep();
+		m_prevFixedDeltaTime = FApp::GetFixedDeltaTime();
+
+		// fixed steps without frame rate limit, so simulation runs as fast as the hardware allows
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(fixedDeltaTime > 0.0f ? fixedDeltaTime : 0.05f);
+
+		DeepDriveCapture::SetLockstepMode(true);
+
+		m_LockstepState = LockstepState::Idle;
+		m_LockstepStepsRemaining = 0;
+	}
+	else
+		UE_LOG(LogDeepDriveServer, Warning, TEXT("Couldn't pause game, lockstep mode not available"));
+
+	return m_LockstepState != LockstepState::Off;
+}
+
+void DeepDriveServer::leaveLockstepMode()
+{
+	if (m_LockstepState != LockstepState::Off)
+	{
+		FApp::SetUseFixedTimeStep(m_prevUseFixedTimeStep);
+		FApp::SetFixedDeltaTime(m_prevFixedDeltaTime);
+
+		DeepDriveCapture::SetLockstepMode(false);
+
+		if (m_Proxy)
+			UGameplayStatics::SetGamePaused(m_Proxy, false);
+
+		m_LockstepState = LockstepState::Off;
+		m_LockstepClientId = 0;
+		m_LockstepStepsRemaining = 0;
+	}
+}
+
+void DeepDriveServer::updateLockstep()
+{
+	if (m_LockstepState == LockstepState::Off)
+		return;
+
+	SClient *clientData = m_Clients.Find(m_LockstepClientId);
+	DeepDriveClientConnection *client = clientData ? clientData->connection : 0;
+	if	(	m_LockstepClientId != 0
+		&&	client == 0
+		)
+	{
+		UE_LOG(LogDeepDriveServer, Log, TEXT("Lockstep client %d is gone, leaving lockstep mode"), m_LockstepClientId);
+		leaveLockstepMode();
+		return;
+	}
+
+	switch (m_LockstepState)
+	{
+		case LockstepState::Stepping:
+			// pausing takes effect with the next frame, so this frame's tick still belongs to the current step
+			if	(	m_Proxy->GetWorld()->IsPaused() == false
+				&&	--m_LockstepStepsRemaining == 0
+				)
+			{
+				UGameplayStatics::SetGamePaused(m_Proxy, true);
+				m_LockstepState = LockstepState::Capturing;
+			}
+			break;
+
+		case LockstepState::Capturing:
+			{
+				// all agents are captured, the response carries the sequence number of the context the client reads
+				const DeepDriveCapture *clientContext = DeepDriveCapture::GetContext(client ? client->getCaptureProxyIndex() : 0);
+				uint32 sequenceNumber = 0;
+				for(DeepDriveCapture *captureContext : DeepDriveCapture::GetContexts())
+				{
+					const uint32 seqNr = captureContext->CaptureImmediately();
+					if(captureContext == clientContext)
+						sequenceNumber = seqNr;
+				}
+				if (client)
+					client->enqueueResponse(new deepdrive::server::AdvanceSimulationResponse(true, sequenceNumber));
+				m_LockstepState = LockstepState::Idle;
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
 void DeepDriveServer::addIncomingConnection(FSocket *socket, TSharedRef<FInternetAddr> remoteAddr)
 {
 	m_IncomingConnections.Enqueue(new SIncomingConnection(socket, remoteAddr));
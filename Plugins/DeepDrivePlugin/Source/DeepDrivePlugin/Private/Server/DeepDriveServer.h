@@ -46,6 +46,14 @@ class DeepDriveServer
 		DeepDriveClientConnection		*connection;
 	};
 
+	enum class LockstepState
+	{
+		Off,
+		Idle,				// paused, waiting for next advance request
+		Stepping,			// running until requested number of steps has been ticked
+		Capturing			// paused, capture on next update
+	};
+
 	typedef TQueue<deepdrive::server::MessageHeader*> MessageQueue;
 
 	typedef std::function< void(const deepdrive::server::MessageHeader&) > HandleMessageFuncPtr;
@@ -91,6 +99,13 @@ private:
 
 	void setAgentControlValues(const deepdrive::server::MessageHeader &message);
 
+	void setLockstepMode(const deepdrive::server::MessageHeader &message);
+	void advanceSimulation(const deepdrive::server::MessageHeader &message);
+
+	bool enterLockstepMode(float fixedDeltaTime);
+	void leaveLockstepMode();
+	void updateLockstep();
+
 	DeepDriveConnectionListener		*m_ConnectionListener = 0;
 
 	ADeepDriveServerProxy			*m_Proxy = 0;
@@ -107,5 +122,11 @@ private:
 
 	TArray<DeepDriveClientConnection*>	m_ClientConnections;
 
+	LockstepState					m_LockstepState = LockstepState::Off;
+	uint32							m_LockstepClientId = 0;
+	uint32							m_LockstepStepsRemaining = 0;
+	bool							m_prevUseFixedTimeStep = false;
+	double							m_prevFixedDeltaTime = 0.0;
+
 	static DeepDriveServer			*theInstance;
 };
@@ -13,6 +13,9 @@ ADeepDriveServerProxy::ADeepDriveServerProxy()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	// keep serving clients while game is paused, e.g. in lockstep mode
+	PrimaryActorTick.bTickEvenWhenPaused = true;
+
 }
 
 void ADeepDriveServerProxy::PreInitializeComponents()
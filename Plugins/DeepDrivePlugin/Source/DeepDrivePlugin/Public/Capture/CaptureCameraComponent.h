@@ -9,6 +9,8 @@
 DECLARE_LOG_CATEGORY_EXTERN(DeepDriveCaptureComponent, Log, All);
 
 struct SCaptureRequest;
+class ADeepDriveCaptureProxy;
+class DeepDriveCapture;
 
 /**
  * 
@@ -34,9 +36,58 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "CaptureCamera")
 	bool	CaptureSceneEveryFrame = false;
 
+	/**
+		Capture rate in Hz. With a rate of 0 the camera is captured according to CaptureInterval and CaptureCycles of the capture proxy.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CaptureCamera", meta = (ClampMin = "0.0"))
+	float	CaptureRate = 0.0f;
+
+	/**
+		Delay of the first capture in seconds after registration, allows spreading cameras with the same rate over different frames
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CaptureCamera", meta = (ClampMin = "0.0"))
+	float	CapturePhase = 0.0f;
+
+	/**
+		Pack captured color into 8 bit BGRA and depth into 16 bit unsigned values before handing captures to the sinks.
+		Packing is done on the render thread's CPU after the full FloatRGBA readback, it shrinks capture buffers and messages but not the readback.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CaptureCamera")
+	bool	PackColorAndDepth = false;
+
+	/**
+		Region of the render target to capture. A size of 0 captures the whole render target.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CaptureCamera")
+	FIntPoint	RegionOffset = FIntPoint(0, 0);
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CaptureCamera")
+	FIntPoint	RegionSize = FIntPoint(0, 0);
+
+	/**
+		Only every DownscaleFactor-th pixel of every DownscaleFactor-th row of the captured region is kept
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CaptureCamera", meta = (ClampMin = "1", ClampMax = "16"))
+	int32	DownscaleFactor = 1;
+
+	/**
+		Formats color and depth are delivered in by sinks supporting format selection like the shared memory sink, None omits the data
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CaptureCamera")
+	EDeepDriveCaptureColorFormat	ColorFormat = EDeepDriveCaptureColorFormat::Default;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CaptureCamera")
+	EDeepDriveCaptureDepthFormat	DepthFormat = EDeepDriveCaptureDepthFormat::Default;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CaptureCamera")
 	UTextureRenderTarget2D	*SceneRenderTarget;
 
+	/**
+		Capture proxy this camera is captured by, must be set before calling Initialize. If not set the camera is captured by the first registered proxy.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CaptureCamera")
+	ADeepDriveCaptureProxy	*CaptureProxy = 0;
+
 	UFUNCTION(BlueprintCallable, Category = "CaptureCamera")
 	void Initialize(UTextureRenderTarget2D *RenderTarget, float FoV);
 
@@ -51,8 +102,19 @@ public:
 
 	bool capture(SCaptureRequest &reqData);
 
+	uint32 getReadbackSize() const;
+
+	/**
+		Size of the capture buffer a capture of this camera is copied into, depending on region, downscaling and packing
+	*/
+	uint32 getCaptureBufferSize() const;
+
 private:
 
+	FIntRect getCaptureRegion() const;
+
+	DeepDriveCapture* getCaptureContext();
+
 	UPROPERTY()
 	USceneCaptureComponent2D	*m_SceneCapture;
 };
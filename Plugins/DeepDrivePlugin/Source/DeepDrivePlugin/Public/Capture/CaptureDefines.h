@@ -16,3 +16,60 @@ enum class EDeepDriveCameraType : uint8
 	DDC_CAMERA_BACK_RIGHT	= 7	UMETA(DisplayName="BackRightCamera"),
 	DDC_CAMERA_BACK			= 8	UMETA(DisplayName="BackCamera")
 };
+
+UENUM(BlueprintType)
+enum class EDeepDriveCaptureDrainPolicy : uint8
+{
+	DeliverAll				= 0	UMETA(DisplayName="DeliverAll"),
+	DeliverLatest			= 1	UMETA(DisplayName="DeliverLatest"),
+	DeliverUpToN			= 2	UMETA(DisplayName="DeliverUpToN")
+};
+
+UENUM(BlueprintType)
+enum class EDeepDriveCaptureBufferMemory : uint8
+{
+	Default					= 0	UMETA(DisplayName="Default"),
+	PageAligned				= 1	UMETA(DisplayName="PageAligned"),
+	HugePages				= 2	UMETA(DisplayName="HugePages")
+};
+
+UENUM(BlueprintType)
+enum class EDeepDriveCaptureSinkQueuePolicy : uint8
+{
+	DropOldest				= 0	UMETA(DisplayName="DropOldest"),
+	DropNewest				= 1	UMETA(DisplayName="DropNewest"),
+	Block					= 2	UMETA(DisplayName="Block")
+};
+
+UENUM(BlueprintType)
+enum class EDeepDriveDiskCaptureOutput : uint8
+{
+	Bitmaps					= 0	UMETA(DisplayName="Bitmaps"),
+	EpisodeRecording		= 1	UMETA(DisplayName="EpisodeRecording")
+};
+
+/**
+	Formats captures are converted into by sinks. Default keeps the layout given by the capture,
+	half float RGB and depth or, for packed captures, 8 bit RGB and 16 bit depth in cm.
+*/
+UENUM(BlueprintType)
+enum class EDeepDriveCaptureColorFormat : uint8
+{
+	Default					= 0	UMETA(DisplayName="Default"),
+	RGB8					= 1	UMETA(DisplayName="RGB8"),
+	RGBHalf					= 2	UMETA(DisplayName="RGBHalf"),
+	RGBFloat				= 3	UMETA(DisplayName="RGBFloat"),
+	Gray8					= 4	UMETA(DisplayName="Gray8"),
+	None					= 5	UMETA(DisplayName="None")
+};
+
+UENUM(BlueprintType)
+enum class EDeepDriveCaptureDepthFormat : uint8
+{
+	Default					= 0	UMETA(DisplayName="Default"),
+	Half					= 1	UMETA(DisplayName="Half"),
+	Float					= 2	UMETA(DisplayName="Float"),
+	UInt16Centimeters		= 3	UMETA(DisplayName="UInt16Centimeters"),
+	UInt16Millimeters		= 4	UMETA(DisplayName="UInt16Millimeters"),
+	None					= 5	UMETA(DisplayName="None")
+};
@@ -10,6 +10,7 @@
 DECLARE_LOG_CATEGORY_EXTERN(DeepDriveCaptureProxy, Log, All);
 
 class UCaptureSinkComponentBase;
+class DeepDriveCapture;
 
 
 USTRUCT()
@@ -21,6 +22,51 @@ struct FCaptureCyle
 	TArray<EDeepDriveCameraType>	Cameras;
 };
 
+USTRUCT(BlueprintType)
+struct FCaptureBufferSlotStatistics
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = Default)
+	int32	SlotSize = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = Default)
+	int32	NumAllocated = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = Default)
+	int32	NumInUse = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = Default)
+	int32	PeakInUse = 0;
+};
+
+/**
+	Capture buffer pool statistics, sizes are given in KB so pools beyond 2 GB fit into blueprint integers
+*/
+USTRUCT(BlueprintType)
+struct FCaptureBufferPoolStatistics
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = Default)
+	int32	AllocatedKB = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = Default)
+	int32	UsedKB = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = Default)
+	int32	PeakAllocatedKB = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = Default)
+	int32	TrimmedKB = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = Default)
+	int32	AllocationFailures = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = Default)
+	TArray<FCaptureBufferSlotStatistics>	Slots;
+};
+
 UCLASS()
 class DEEPDRIVEPLUGIN_API ADeepDriveCaptureProxy : public AActor
 {
@@ -57,12 +103,104 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Capturing)
 	TArray< FCaptureCyle >	CaptureCycles;
 
+	/**
+		Number of staging buffers captures are read back through. Captured data is mapped ReadbackBufferCount - 1 frames after being rendered.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Capturing, meta = (ClampMin = "2", ClampMax = "4"))
+	int32	ReadbackBufferCount = 3;
+
+	/**
+		Read back all cameras of a capture through tiles of one shared staging texture instead of one staging texture per camera.
+		All capture render targets must use the same pixel format.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Capturing)
+	bool	UseCaptureAtlas = false;
+
+	/**
+		Backing memory of capture buffers. PageAligned and HugePages map pre-faulted pages directly from the OS,
+		avoiding page faults on the first copy of a capture into a new buffer.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Capturing)
+	EDeepDriveCaptureBufferMemory	CaptureBufferMemory = EDeepDriveCaptureBufferMemory::Default;
+
+	/**
+		How finished captures are handed to the sinks per tick. DeliverLatest drops all but the newest capture,
+		DeliverUpToN delivers at most MaxDeliveredCapturesPerTick captures and keeps the rest for the next tick.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Capturing)
+	EDeepDriveCaptureDrainPolicy	DrainPolicy = EDeepDriveCaptureDrainPolicy::DeliverUpToN;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Capturing, meta = (ClampMin = "1"))
+	int32	MaxDeliveredCapturesPerTick = 1;
+
+	/**
+		Hand finished captures to the sinks on a dispatch thread as soon as their readback completes instead of on the next game tick.
+		Sinks then receive the agent state captured with the frame. MaxDeliveredCapturesPerTick is ignored as delivery doesn't cost game thread time.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Capturing)
+	bool	DispatchCapturesOnWorkerThread = true;
+
+	UFUNCTION(BlueprintCallable, Category = "DeepDrivePlugin")
+	int32 GetSkippedCaptureCount() const;
+
+	/**
+		Maximum number of bytes read back per frame for cameras with an own capture rate, 0 means unlimited.
+		Due cameras not fitting into the budget are deferred to the next frame.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Capturing, meta = (ClampMin = "0"))
+	int32	MaxReadbackBytesPerFrame = 0;
+
+	UFUNCTION(BlueprintCallable, Category = "DeepDrivePlugin")
+	int32 GetDeferredCaptureCount() const;
+
+	/**
+		Captures are skipped while MaxInFlightCaptures captures are on their way to the sinks
+		or MaxCaptureBufferBytesInUse bytes of capture buffers are in use. 0 means unlimited.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Capturing, meta = (ClampMin = "0"))
+	int32	MaxInFlightCaptures = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Capturing, meta = (ClampMin = "0"))
+	int32	MaxCaptureBufferBytesInUse = 0;
+
+	UFUNCTION(BlueprintCallable, Category = "DeepDrivePlugin")
+	int32 GetRejectedCaptureCount() const;
+
+	/**
+		Upper limit for memory allocated by the capture buffer pool in MB, 0 means unlimited.
+		Captures needing a new buffer beyond the limit are dropped.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Capturing, meta = (ClampMin = "0"))
+	int32	MaxCaptureBufferPoolMB = 0;
+
+	/**
+		Buffers of sizes not captured for CaptureBufferIdleTime seconds are freed, 0 only trims buffers exceeding the recent peak usage.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Capturing, meta = (ClampMin = "0.0"))
+	float	CaptureBufferIdleTime = 10.0f;
+
+	/**
+		Allocate and pre-fault capture buffers when a camera is registered, one per capture in flight
+		(MaxInFlightCaptures or ReadbackBufferCount) plus one, so the first captures don't allocate.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Capturing)
+	bool	PrewarmCaptureBuffers = true;
+
+	UFUNCTION(BlueprintCallable, Category = "DeepDrivePlugin")
+	FCaptureBufferPoolStatistics GetCaptureBufferPoolStatistics() const;
+
 	const FDeepDriveDataOut& getDeepDriveData() const;
 
+	DeepDriveCapture* getCaptureContext();
+
+	void updateDeepDriveData();
+
 private:
 
 	bool									m_isActive = false;
 
+	DeepDriveCapture						*m_CaptureContext = 0;
+
 	TArray<UCaptureSinkComponentBase*>		m_CaptureSinks;
 	
 	float									m_TimeToNextCapture;
@@ -81,3 +219,8 @@ inline const FDeepDriveDataOut& ADeepDriveCaptureProxy::getDeepDriveData() const
 {
 	return m_DeepDriveData;
 }
+
+inline DeepDriveCapture* ADeepDriveCaptureProxy::getCaptureContext()
+{
+	return m_CaptureContext;
+}
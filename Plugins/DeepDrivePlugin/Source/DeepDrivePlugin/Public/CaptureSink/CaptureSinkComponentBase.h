@@ -7,6 +7,7 @@
 #include "CaptureSinkComponentBase.generated.h"
 
 class CaptureBuffer;
+class ICaptureBufferAllocator;
 struct FDeepDriveDataOut;
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
@@ -18,12 +19,51 @@ public:
 
 	UCaptureSinkComponentBase();
 
+	/**
+		Called on the game thread before captures are delivered. begin(), setCaptureBuffer() and flush() may be called on the
+		capture dispatcher's thread, so everything they need from the sink's properties is copied here.
+	*/
+	virtual void updateSettings();
+
 	virtual void begin(double timestamp, uint32 sequenceNumber, const FDeepDriveDataOut &deepDriveData);
 
+	/**
+		The buffer is only guaranteed to stay valid until flush returns, sinks using it afterwards must hold a CaptureBufferLease
+	*/
 	virtual void setCaptureBuffer(int32 cameraId, EDeepDriveCameraType cameraType, CaptureBuffer &captureBuffer);
 
 	virtual void flush();	
 
+	/**
+		Number of captures flushed to this sink but not processed yet
+	*/
+	virtual int32 getPendingJobCount() const;
+
+	/**
+		Number of captures dropped because the sink's queue was full
+	*/
+	virtual int32 getDroppedJobCount() const;
+
+	/**
+		Maximum number of captures queued for this sink, 0 means unlimited. QueuePolicy decides what happens to captures flushed to a full queue.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Queue, meta = (ClampMin = "0"))
+	int32	MaxQueuedJobs = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Queue)
+	EDeepDriveCaptureSinkQueuePolicy	QueuePolicy = EDeepDriveCaptureSinkQueuePolicy::DropOldest;
+
+	UFUNCTION(BlueprintCallable, Category = "DeepDrivePlugin")
+	int32 GetQueueDepth() const;
+
+	UFUNCTION(BlueprintCallable, Category = "DeepDrivePlugin")
+	int32 GetDroppedJobCount() const;
+
+	/**
+		Allocator capture buffers should be carved out of to be consumed by this sink without copying, empty if the sink has none
+	*/
+	virtual TSharedPtr<ICaptureBufferAllocator, ESPMode::ThreadSafe> getCaptureBufferAllocator() const;
+
 	const FString& getName() const;
 
 protected:
@@ -7,7 +7,7 @@
 
 DECLARE_LOG_CATEGORY_EXTERN(LogDiskCaptureSinkComponent, Log, All);
 
-class CaptureSinkWorkerBase;
+class DiskCaptureSinkWorker;
 struct SCaptureSinkJobData;
 
 /**
@@ -17,17 +17,39 @@ UCLASS(meta=(BlueprintSpawnableComponent), Category = "DeepDrivePlugin")
 class DEEPDRIVEPLUGIN_API UDiskCaptureSinkComponent : public UCaptureSinkComponentBase
 {
 	GENERATED_BODY()
+
+	/**
+		Properties needed to fill in job data, copied on the game thread by updateSettings
+	*/
+	struct SSettings
+	{
+		FString									base_path;
+		TMap<EDeepDriveCameraType, FString>		camera_type_paths;
+		FString									base_file_name;
+		FString									episode_path;
+		uint32									episode_chunk_size = 0;
+	};
 	
 public:
 
 	UDiskCaptureSinkComponent();
 
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void updateSettings();
+
 	virtual void begin(double timestamp, uint32 sequenceNumber, const FDeepDriveDataOut &deepDriveData);
 
 	virtual void setCaptureBuffer(int32 cameraId, EDeepDriveCameraType cameraType, CaptureBuffer &captureBuffer);
 
 	virtual void flush();	
 
+	virtual int32 getPendingJobCount() const;
+
+	virtual int32 getDroppedJobCount() const;
+
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Destination)
 	FString		BasePathOnWindows;
@@ -41,11 +63,51 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Destination)
 	FString		BaseFileName;
 
+	/**
+		Bitmaps stores one bitmap per camera and frame. EpisodeRecording appends telemetry and captures of every frame
+		to a single file per episode named after BaseFileName, start time and episode number.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Destination)
+	EDeepDriveDiskCaptureOutput		Output = EDeepDriveDiskCaptureOutput::Bitmaps;
+
+	/**
+		Episode files are grown in steps of this size
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Destination, meta = (ClampMin = "1", ClampMax = "1024"))
+	int32		EpisodeChunkSizeMB = 64;
+
+	/**
+		Write bitmaps on a pool of threads, with direct I/O on Linux, instead of on the sink worker. Applied when the sink begins play.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Writing)
+	bool		AsyncWrites = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Writing, meta = (ClampMin = "1", ClampMax = "32"))
+	int32		WriteThreads = 4;
+
+	/**
+		Bitmaps waiting to be written may take up to this much memory, beyond that the sink worker waits for the disk
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Writing, meta = (ClampMin = "1", ClampMax = "4096"))
+	int32		MaxWriteBytesInFlightMB = 256;
+
+	/**
+		Finish the current episode file, frames recorded afterwards go to a new one. The file is completed by the time the next frame is recorded or the sink ends play.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "DeepDrivePlugin")
+	void FinishEpisode();
+
 private:
 
-	CaptureSinkWorkerBase			*m_Worker = 0;
+	DiskCaptureSinkWorker			*m_Worker = 0;
 	SCaptureSinkJobData				*m_curJobData = 0;
 
 	FString							*m_BasePath = 0;
 
+	FCriticalSection				m_SettingsMutex;
+	SSettings						m_Settings;
+
+	int32							m_EpisodeNumber = 0;
+	int32							m_RequestedEpisodeNumber = 0;
+
 };
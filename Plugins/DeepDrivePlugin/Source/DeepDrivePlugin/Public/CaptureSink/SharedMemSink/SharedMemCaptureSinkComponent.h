@@ -8,7 +8,7 @@
 
 DECLARE_LOG_CATEGORY_EXTERN(LogSharedMemCaptureSinkComponent, Log, All);
 
-class CaptureSinkWorkerBase;
+class SharedMemCaptureSinkWorker;
 struct SCaptureSinkJobData;
 
 
@@ -29,12 +29,20 @@ public:
 
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+	virtual void updateSettings();
+
 	virtual void begin(double timestamp, uint32 sequenceNumber, const FDeepDriveDataOut &deepDriveData);
 
 	virtual void setCaptureBuffer(int32 cameraId, EDeepDriveCameraType cameraType, CaptureBuffer &captureBuffer);
 
 	virtual void flush();
 
+	virtual int32 getPendingJobCount() const;
+
+	virtual int32 getDroppedJobCount() const;
+
+	virtual TSharedPtr<ICaptureBufferAllocator, ESPMode::ThreadSafe> getCaptureBufferAllocator() const;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SharedMem)
 	FString		SharedMemNameLinux;
 
@@ -44,11 +52,23 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SharedMem)
 	int32 MaxSharedMemSize = 150 * 1024 * 1024;
 
+	/**
+		Bytes at the end of the shared memory reserved for reading back captures in place. Half float captures in this arena are published
+		without copying, in their raw RGBA layout. 0 disables zero copy publishing.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SharedMem)
+	int32 ZeroCopyArenaSize = 0;
+
 	const FString& getSharedMemoryName();
 
+	/**
+		Wait until the capture with sequenceNumber, or a later one, has been published in shared memory or dropped. Returns false on time out.
+	*/
+	bool waitForPublishing(uint32 sequenceNumber, float timeoutSeconds);
+
 private:
 
-	CaptureSinkWorkerBase			*m_Worker = 0;
+	SharedMemCaptureSinkWorker		*m_Worker = 0;
 	SCaptureSinkJobData				*m_curJobData = 0;
 
 	FString							m_SharedMemoryName;
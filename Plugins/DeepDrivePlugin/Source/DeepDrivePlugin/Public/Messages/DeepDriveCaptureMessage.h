@@ -4,12 +4,37 @@
 #include "Engine.h"
 #include "Public/Messages/DeepDriveMessageHeader.h"
 
+/**
+	Layout of a camera's color and depth data. Undefined is written by older servers, the layout then follows from bytes_per_pixel.
+*/
+enum class DeepDriveCaptureColorFormat	:	uint16
+{
+	Undefined,
+	RGB8,						// 8 bit RGB, sRGB encoded
+	RGBHalf,					// half float RGB, linear
+	RGBFloat,					// float RGB, linear
+	Gray8,						// 8 bit luminance of sRGB encoded RGB
+	RawRGBAHalf,				// half float RGBA rows of row_stride bytes with depth in alpha
+	None
+};
+
+enum class DeepDriveCaptureDepthFormat	:	uint16
+{
+	Undefined,
+	Half,						// half float depth in cm divided by 65535
+	Float,						// float depth in cm divided by 65535
+	UInt16Centimeters,			// clamped to 65535
+	UInt16Millimeters,			// clamped to 65535
+	RawHalf,					// half float depth in cm within the alpha channel of RawRGBAHalf color, the Python client divides it by 65535 like Half
+	None
+};
+
 struct DeepDriveCaptureCamera
 {
 	uint32						type;
 	uint32						id;
 	uint32						offset_to_next_camera;			// from beginning of this data structure, set to 0 for last camera
-	uint32						padding_0;
+	uint32						data_offset;					// offset of pixel data from beginning of this data structure, 0 if data follows inline
 
 	double						horizontal_field_of_view;
 	double						aspect_ratio;
@@ -17,10 +42,16 @@ struct DeepDriveCaptureCamera
 
 	int32						capture_width;
 	int32						capture_height;
-	uint32						bytes_per_pixel;
-	uint32						bytes_per_depth_value;
-	uint32						depth_offset;					// byte offset of depth data relative to data
-	uint32						padding_1;
+	uint32						bytes_per_pixel;				// bytes per color value, 0 if color is omitted
+	uint32						bytes_per_depth_value;			// 0 if depth is omitted
+	uint32						depth_offset;					// byte offset of depth data relative to data, for raw data offset of depth within a pixel
+	uint32						row_stride;						// bytes per row of raw data, 0 for the other layouts
+
+	int32						region_offset_x;				// position of captured region within the camera's render target
+	int32						region_offset_y;
+	uint32						downscale_factor;				// capture_width and capture_height are already divided by it
+	uint16						color_format;					// DeepDriveCaptureColorFormat
+	uint16						depth_format;					// DeepDriveCaptureDepthFormat
 
 	uint8						data[1];
 
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Engine.h"
+
+/**
+	Episode recording file written by the disk capture sink:
+	DeepDriveEpisodeHeader at offset 0, followed by one DeepDriveCaptureMessage per frame starting at 8 byte aligned offsets,
+	each holding the frame's telemetry and camera data in the formats selected per camera.
+	Once finished, index_offset points to num_frames uint64 file offsets of the frames.
+	The file grows in chunks of chunk_size bytes, so it may end with unused, zeroed space.
+	Files of episodes which weren't finished have an index_offset of 0, their frames can still be found by
+	walking from frame to frame up to data_end using message_size.
+*/
+
+enum
+{
+	DeepDriveEpisodeMagic = 0x50454444,			// "DDEP"
+	DeepDriveEpisodeVersion = 1
+};
+
+struct DeepDriveEpisodeHeader
+{
+	uint32						magic;
+	uint32						version;
+
+	uint64						chunk_size;
+
+	uint64						data_end;						// end of frame data, updated whenever the file grows and when finished
+
+	uint64						index_offset;					// 0 until finished
+
+	uint32						num_frames;						// valid once finished
+
+	uint32						padding_0;
+
+};
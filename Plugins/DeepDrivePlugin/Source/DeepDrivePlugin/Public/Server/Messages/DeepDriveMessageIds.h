@@ -39,7 +39,16 @@ enum class MessageId	:	uint32
 	ResetAgentRequest,
 	ResetAgentResponse,
 	ReleaseAgentControlRequest,
-	ReleaseAgentControlResponse
+	ReleaseAgentControlResponse,
+
+
+	/*
+		Lockstep stepping
+	*/
+	SetLockstepModeRequest,
+	SetLockstepModeResponse,
+	AdvanceSimulationRequest,
+	AdvanceSimulationResponse
 };
 	
 } }		//	namespaces
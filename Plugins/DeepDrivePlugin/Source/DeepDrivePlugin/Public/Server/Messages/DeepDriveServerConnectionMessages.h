@@ -9,14 +9,16 @@ namespace deepdrive { namespace server {
 
 struct RegisterClientRequest	:	public MessageHeader
 {
-	RegisterClientRequest(bool master)
+	RegisterClientRequest(bool master, uint32 captureProxyIndex = 0)
 		:	MessageHeader(MessageId::RegisterClientRequest, sizeof(RegisterClientRequest))
-		,	client_protocol_version(1)
+		,	client_protocol_version(2)
 		,	request_master_role(master ? 1 : 0)
+		,	capture_proxy_index(captureProxyIndex)
 	{	}
 
 	uint32				client_protocol_version;
 	uint32				request_master_role;
+	uint32				capture_proxy_index;				// capture proxy, i.e. agent, in the order proxies were created, since version 2
 
 };
 
@@ -91,5 +91,70 @@ struct SetAgentControlValuesRequest :	public MessageHeader
 };
 
 
+/**
+	Switches simulation into lockstep mode. In lockstep mode the simulation is paused and only advanced by AdvanceSimulationRequest,
+	each step using a fixed delta time.
+*/
+struct SetLockstepModeRequest :	public MessageHeader
+{
+	SetLockstepModeRequest(uint32 c = 0, bool e = false, float dt = 0.05f)
+		:	MessageHeader(MessageId::SetLockstepModeRequest, sizeof(SetLockstepModeRequest))
+		,	client_id(c)
+		,	enabled(e ? 1 : 0)
+		,	fixed_delta_time(dt)
+	{	}
+
+	uint32		client_id;
+	uint32		enabled;
+	float		fixed_delta_time;
+};
+
+struct SetLockstepModeResponse :	public MessageHeader
+{
+	SetLockstepModeResponse(bool e = false)
+		:	MessageHeader(MessageId::SetLockstepModeResponse, sizeof(SetLockstepModeResponse))
+		,	enabled(e ? 1 : 0)
+	{	}
+
+	uint32		enabled;
+};
+
+/**
+	Applies control values, advances simulation by num_steps fixed steps and captures afterwards.
+	Response is sent once the capture has been published in shared memory.
+*/
+struct AdvanceSimulationRequest :	public MessageHeader
+{
+	AdvanceSimulationRequest(uint32 c = 0, float s = 0.0f, float t = 0.0f, float b = 0.0f, uint32 h = 0, uint32 n = 1)
+		:	MessageHeader(MessageId::AdvanceSimulationRequest, sizeof(AdvanceSimulationRequest))
+		,	client_id(c)
+		,	steering(s)
+		,	throttle(t)
+		,	brake(b)
+		,	handbrake(h)
+		,	num_steps(n)
+	{	}
+
+	uint32		client_id;
+	float		steering;
+	float		throttle;
+	float		brake;
+	uint32		handbrake;
+	uint32		num_steps;
+};
+
+struct AdvanceSimulationResponse :	public MessageHeader
+{
+	AdvanceSimulationResponse(bool a = false, uint32 seqNr = 0)
+		:	MessageHeader(MessageId::AdvanceSimulationResponse, sizeof(AdvanceSimulationResponse))
+		,	advanced(a ? 1 : 0)
+		,	sequence_number(seqNr)
+	{	}
+
+	uint32		advanced;
+	uint32		sequence_number;			// sequence number of capture published after advancing, 0 if nothing was captured
+};
+
+
 
 } }	// namespaces
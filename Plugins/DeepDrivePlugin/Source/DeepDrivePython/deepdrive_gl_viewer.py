@@ -62,15 +62,28 @@ VERTICES =	[	0.0, 0.0, 0.0, 1.0
 			]
 VERTICES = numpy.array(VERTICES, dtype=numpy.float32)
 
+def ToFloat(data, scale):
+	if data.dtype == numpy.uint8:
+		return data.astype(numpy.float32) / 255.0
+	if data.dtype == numpy.uint16:
+		# 16 bit depth in cm or mm, scaled to the range of normalized float depth
+		return data.astype(numpy.float32) / scale
+	return data.astype(numpy.float32)
+
 def LoadTexture(index, width, height, data):
+	if data is None:
+		return
 	glBindTexture(GL_TEXTURE_2D, textures[index])
 	#glTexImage2D(GL_TEXTURE_2D, 0, GL_HALF_FLOAT, width, height, 0, GL_RGB, GL_HALF_FLOAT, data)
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_FLOAT, data.astype(numpy.float32))
+	format = GL_LUMINANCE if data.size == width * height else GL_RGB
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, format, GL_FLOAT, ToFloat(data, 1.0))
 
-def LoadDepthTexture(index, width, height, data):
+def LoadDepthTexture(index, width, height, data, depth_scale):
 	global depth_textures
+	if data is None:
+		return
 	glBindTexture(GL_TEXTURE_2D, depth_textures[index])
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0, GL_LUMINANCE, GL_FLOAT, data.astype(numpy.float32))
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0, GL_LUMINANCE, GL_FLOAT, ToFloat(data, depth_scale))
 
 
 def CreateShader(src, type):
@@ -199,11 +212,14 @@ def Idle():
 		for cc in snapshot.cameras:
 			if ind < 4:
 				LoadTexture(ind, cc.capture_width, cc.capture_height, cc.image_data)
-				LoadDepthTexture(ind, cc.capture_width, cc.capture_height, cc.depth_data)
+				# depth format 4 is 16 bit millimeters
+				LoadDepthTexture(ind, cc.capture_width, cc.capture_height, cc.depth_data, 655350.0 if cc.depth_format == 4 else 65535.0)
 			ind = ind + 1
-			print('  Camera:', cc.type, cc.id, cc.capture_width, 'x', cc.capture_height)
-			print('    image size', len(cc.image_data), cc.image_data[0], cc.image_data[1], cc.image_data[2])
-			print('    depth size', len(cc.depth_data), cc.depth_data[0], cc.depth_data[1], cc.depth_data[2])
+			print('  Camera:', cc.type, cc.id, cc.capture_width, 'x', cc.capture_height, 'formats', cc.color_format, cc.depth_format)
+			if cc.image_data is not None:
+				print('    image size', len(cc.image_data), cc.image_data[0], cc.image_data[1], cc.image_data[2])
+			if cc.depth_data is not None:
+				print('    depth size', len(cc.depth_data), cc.depth_data[0], cc.depth_data[1], cc.depth_data[2])
 
 
 		glutPostRedisplay()
@@ -14,6 +14,7 @@ print('###################################')
 
 sources_capture =	[	SRC_DIR + '/DeepDrivePlugin/Private/SharedMemory/SharedMemory.cpp'
                     ,	'src/deepdrive_capture/DeepDriveSharedMemoryClient.cpp'
+                    ,	'src/deepdrive_capture/DeepDriveEpisodeReader.cpp'
                     ,	'src/deepdrive_capture/deepdrive_capture.cpp'
                     ,	'src/common/NumPyUtils.cpp'
                     ]
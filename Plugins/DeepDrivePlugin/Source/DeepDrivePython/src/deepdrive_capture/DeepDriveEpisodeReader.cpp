@@ -0,0 +1,215 @@
+
+#include "Python.h"
+
+#include "DeepDriveEpisodeReader.h"
+#include "DeepDriveSharedMemoryClient.h"
+
+#include "Public/Messages/DeepDriveCaptureMessage.h"
+#include "Public/Messages/DeepDriveEpisodeRecording.h"
+
+#if defined(DEEPDRIVE_PLATFORM_LINUX)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(DEEPDRIVE_PLATFORM_WINDOWS)
+#include <windows.h>
+#endif
+
+#include <iostream>
+
+/*	Memory mapping of a recording, owned by a capsule referenced by the reader and by every array aliasing the mapping
+*/
+struct SEpisodeMapping
+{
+	const uint8					*data = 0;
+	uint64						size = 0;
+
+#if defined(DEEPDRIVE_PLATFORM_WINDOWS)
+	HANDLE						file_handle = 0;
+	HANDLE						mapping_handle = 0;
+#endif
+};
+
+static const char *EpisodeMappingName = "deepdrive_capture.episode_mapping";
+
+static void unmapEpisode(SEpisodeMapping *mapping)
+{
+#if defined(DEEPDRIVE_PLATFORM_LINUX)
+
+	if(mapping->data)
+		munmap(const_cast<uint8*> (mapping->data), mapping->size);
+
+#elif defined(DEEPDRIVE_PLATFORM_WINDOWS)
+
+	if(mapping->data)
+		UnmapViewOfFile(mapping->data);
+	if(mapping->mapping_handle)
+		CloseHandle(mapping->mapping_handle);
+	if(mapping->file_handle)
+		CloseHandle(mapping->file_handle);
+
+#endif
+
+	delete mapping;
+}
+
+static void releaseEpisodeMapping(PyObject *capsule)
+{
+	unmapEpisode(reinterpret_cast<SEpisodeMapping*> (PyCapsule_GetPointer(capsule, EpisodeMappingName)));
+}
+
+DeepDriveEpisodeReader::~DeepDriveEpisodeReader()
+{
+	close();
+}
+
+bool DeepDriveEpisodeReader::open(const std::string &fileName)
+{
+	close();
+
+	SEpisodeMapping *mapping = new SEpisodeMapping;
+
+#if defined(DEEPDRIVE_PLATFORM_LINUX)
+
+	const int fd = ::open(fileName.c_str(), O_RDONLY);
+	if(fd >= 0)
+	{
+		struct stat fileStat;
+		if(fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+		{
+			void *data = mmap(0, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			if(data != MAP_FAILED)
+			{
+				mapping->data = reinterpret_cast<const uint8*> (data);
+				mapping->size = fileStat.st_size;
+			}
+		}
+		// the mapping stays valid after closing the descriptor
+		::close(fd);
+	}
+
+#elif defined(DEEPDRIVE_PLATFORM_WINDOWS)
+
+	mapping->file_handle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(mapping->file_handle != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER fileSize;
+		if(GetFileSizeEx(mapping->file_handle, &fileSize) && fileSize.QuadPart > 0)
+		{
+			mapping->mapping_handle = CreateFileMappingA(mapping->file_handle, 0, PAGE_READONLY, 0, 0, 0);
+			if(mapping->mapping_handle)
+			{
+				mapping->data = reinterpret_cast<const uint8*> (MapViewOfFile(mapping->mapping_handle, FILE_MAP_READ, 0, 0, 0));
+				mapping->size = mapping->data ? fileSize.QuadPart : 0;
+			}
+		}
+	}
+	else
+		mapping->file_handle = 0;
+
+#endif
+
+	m_Mapping = mapping->data ? PyCapsule_New(mapping, EpisodeMappingName, &releaseEpisodeMapping) : 0;
+	if(m_Mapping)
+	{
+		m_Data = mapping->data;
+		m_Size = mapping->size;
+	}
+	else
+	{
+		PyErr_Clear();
+		unmapEpisode(mapping);
+	}
+
+	const DeepDriveEpisodeHeader *header = reinterpret_cast<const DeepDriveEpisodeHeader*> (m_Data);
+	if	(	m_Data == 0
+		||	m_Size < sizeof(DeepDriveEpisodeHeader)
+		||	header->magic != DeepDriveEpisodeMagic
+		||	header->version != DeepDriveEpisodeVersion
+		)
+	{
+		std::cout << "Couldn't open episode recording " << fileName << "\n";
+		close();
+		return false;
+	}
+
+	// the index is only trusted if it and every frame it lists lie within the file, otherwise frames are searched for
+	if	(	header->index_offset != 0
+		&&	header->index_offset % sizeof(uint64) == 0
+		&&	header->index_offset <= m_Size
+		&&	header->num_frames <= (m_Size - header->index_offset) / sizeof(uint64)
+		)
+	{
+		const uint64 *index = reinterpret_cast<const uint64*> (m_Data + header->index_offset);
+		m_FrameOffsets.assign(index, index + header->num_frames);
+		for(uint64 frameOffset : m_FrameOffsets)
+		{
+			if(getFrame(frameOffset) == 0)
+			{
+				std::cout << "Episode recording " << fileName << " has an invalid index\n";
+				m_FrameOffsets.clear();
+				break;
+			}
+		}
+	}
+
+	if(m_FrameOffsets.empty())
+		scanFrames(header->data_end);
+
+	return true;
+}
+
+void DeepDriveEpisodeReader::close()
+{
+	// arrays of frames read before keep the mapping alive until they are gone
+	Py_XDECREF(m_Mapping);
+	m_Mapping = 0;
+
+	m_Data = 0;
+	m_Size = 0;
+	m_FrameOffsets.clear();
+}
+
+PyCaptureSnapshotObject* DeepDriveEpisodeReader::readFrame(uint32 index) const
+{
+	PyCaptureSnapshotObject *snapshot = 0;
+	const DeepDriveCaptureMessage *captureMsg = index < m_FrameOffsets.size() ? getFrame(m_FrameOffsets[index]) : 0;
+	if(captureMsg)
+		snapshot = DeepDriveSharedMemoryClient::buildSnapshot(*captureMsg, captureMsg->message_size, m_Mapping);
+	return snapshot;
+}
+
+const DeepDriveCaptureMessage* DeepDriveEpisodeReader::getFrame(uint64 offset) const
+{
+	if	(	offset < sizeof(DeepDriveEpisodeHeader)
+		||	offset % 8 != 0
+		||	offset > m_Size
+		||	m_Size - offset < sizeof(DeepDriveCaptureMessage)
+		)
+		return 0;
+
+	const DeepDriveCaptureMessage *captureMsg = reinterpret_cast<const DeepDriveCaptureMessage*> (m_Data + offset);
+	if	(	captureMsg->message_type != DeepDriveMessageType::Capture
+		||	captureMsg->message_size < sizeof(DeepDriveCaptureMessage)
+		||	captureMsg->message_size > m_Size - offset
+		)
+		return 0;
+
+	return captureMsg;
+}
+
+void DeepDriveEpisodeReader::scanFrames(uint64 dataEnd)
+{
+	// frames follow each other 8 byte aligned, the zeroed space of the last chunk ends the walk
+	uint64 offset = sizeof(DeepDriveEpisodeHeader);
+	const DeepDriveCaptureMessage *captureMsg = 0;
+	while((captureMsg = getFrame(offset)) != 0)
+	{
+		m_FrameOffsets.push_back(offset);
+		offset += (static_cast<uint64> (captureMsg->message_size) + 7) & ~static_cast<uint64> (7);
+	}
+
+	if(offset < dataEnd)
+		std::cout << "Episode recording truncated, found " << m_FrameOffsets.size() << " frames\n";
+}
@@ -0,0 +1,57 @@
+
+#pragma once
+
+#include "Python.h"
+
+#include "Engine.h"
+
+#include <vector>
+
+struct PyCaptureSnapshotObject;
+struct DeepDriveCaptureMessage;
+
+/**
+	Random access to the frames of an episode recording written by the disk capture sink.
+	The file is memory mapped and snapshots reference their camera data inside the mapping without copying it.
+	The mapping is reference counted, every camera array holds a reference, so it stays mapped
+	after closing or reopening the reader until the last array referencing it is gone.
+*/
+class DeepDriveEpisodeReader
+{
+public:
+
+	~DeepDriveEpisodeReader();
+
+	bool open(const std::string &fileName);
+
+	void close();
+
+	uint32 getNumFrames() const;
+
+	PyCaptureSnapshotObject* readFrame(uint32 index) const;
+
+private:
+
+	/**
+		Frame starting at offset, 0 if it isn't a capture message lying completely within the file
+	*/
+	const DeepDriveCaptureMessage* getFrame(uint64 offset) const;
+
+	/**
+		Find frames of an episode which hasn't been finished
+	*/
+	void scanFrames(uint64 dataEnd);
+
+	const uint8					*m_Data = 0;
+	uint64						m_Size = 0;
+
+	PyObject					*m_Mapping = 0;					// capsule owning the mapping
+
+	std::vector<uint64>			m_FrameOffsets;
+};
+
+
+inline uint32 DeepDriveEpisodeReader::getNumFrames() const
+{
+	return static_cast<uint32> (m_FrameOffsets.size());
+}
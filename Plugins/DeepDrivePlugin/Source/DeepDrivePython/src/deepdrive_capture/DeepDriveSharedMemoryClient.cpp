@@ -10,6 +10,58 @@
 #include <iostream>
 #include <string>
 
+/*	True if length bytes at offset lie within size bytes, without overflowing
+*/
+static bool isInBounds(uint64 offset, uint64 length, uint64 size)
+{
+	return offset <= size && length <= size - offset;
+}
+
+/*	Make owner the base object of array, which references owner's memory, so owner lives as long as array
+*/
+static PyArrayObject* setDataOwner(PyArrayObject *array, PyObject *owner)
+{
+	if(array && owner)
+	{
+		// the reference is stolen even if setting it fails
+		Py_INCREF(owner);
+		if(PyArray_SetBaseObject(array, owner) != 0)
+		{
+			PyErr_Clear();
+			Py_DECREF(array);
+			array = 0;
+		}
+	}
+	return array;
+}
+
+/*	Raw depth is stored in cm, convert it into the half float depth divided by 65535 published for the Half format
+*/
+static PyArrayObject* normalizeRawDepth(PyArrayObject *rawDepth)
+{
+	PyObject *normalizedDepth = 0;
+
+	// divide in single precision like the server does for the Half format
+	PyObject *depth = rawDepth ? PyArray_Cast(rawDepth, NPY_FLOAT32) : 0;
+	PyObject *divisor = PyFloat_FromDouble(65535.0);
+	PyObject *scaledDepth = depth && divisor ? PyNumber_InPlaceTrueDivide(depth, divisor) : 0;
+	if(scaledDepth)
+		normalizedDepth = PyArray_Cast(reinterpret_cast<PyArrayObject*> (scaledDepth), NPY_FLOAT16);
+
+	Py_XDECREF(scaledDepth);
+	Py_XDECREF(divisor);
+	Py_XDECREF(depth);
+
+	if(normalizedDepth == 0)
+	{
+		PyErr_Clear();
+		Py_INCREF(Py_None);
+		normalizedDepth = Py_None;
+	}
+
+	return reinterpret_cast<PyArrayObject*> (normalizedDepth);
+}
+
 DeepDriveSharedMemoryClient::DeepDriveSharedMemoryClient()
 	:	m_SharedMemory(new SharedMemory)
 {
@@ -56,78 +108,7 @@ PyCaptureSnapshotObject* DeepDriveSharedMemoryClient::readMessage()
 //				dumpSharedMemContent(captureMsg);
 				if(captureMsg->message_type == DeepDriveMessageType::Capture)
 				{
-					msg = reinterpret_cast<PyCaptureSnapshotObject*> (PyCaptureSnapshotType.tp_new(&PyCaptureSnapshotType, 0, 0));
-
-					if(msg)
-					{
-//						std::cout << "PyCaptureSnapshotObject created\n";
-
-						msg->capture_timestamp = captureMsg->creation_timestamp;
-						msg->sequence_number = captureMsg->sequence_number;
-						msg->speed = captureMsg->speed;
-						msg->is_game_driving = captureMsg->is_game_driving;
-						msg->is_resetting = captureMsg->is_resetting;
-						msg->camera_count = captureMsg->num_cameras;
-						msg->distance_along_route = captureMsg->distance_along_route;
-						msg->distance_to_center_of_lane = captureMsg->distance_to_center_of_lane;
-						msg->lap_number = captureMsg->lap_number;
-
-						msg->steering = captureMsg->steering;
-						msg->throttle = captureMsg->throttle;
-						msg->brake = captureMsg->brake;
-						msg->handbrake = captureMsg->handbrake;
-
-						NumPyUtils::copyVector3(captureMsg->position, msg->position);
-						NumPyUtils::copyVector3(captureMsg->rotation, msg->rotation);
-						NumPyUtils::copyVector3(captureMsg->velocity, msg->velocity);
-						NumPyUtils::copyVector3(captureMsg->acceleration, msg->acceleration);
-						NumPyUtils::copyVector3(captureMsg->dimension, msg->dimension);
-						NumPyUtils::copyVector3(captureMsg->angular_velocity, msg->angular_velocity);
-						NumPyUtils::copyVector3(captureMsg->angular_acceleration, msg->angular_acceleration);
-						NumPyUtils::copyVector3(captureMsg->forward_vector, msg->forward_vector);
-						NumPyUtils::copyVector3(captureMsg->forward_vector, msg->forward_vector);
-						NumPyUtils::copyVector3(captureMsg->up_vector, msg->up_vector);
-						NumPyUtils::copyVector3(captureMsg->right_vector, msg->right_vector);
-
-//						std::cout << "Vector stuff done captureMsg num_cameras" << captureMsg->num_cameras << " cameras obj " << captureMsg->cameras << "\n";
-
-						if (captureMsg->num_cameras)
-						{
-//							std::cout << "Before camera read\n";
-
-							const DeepDriveCaptureCamera *ddCam = &captureMsg->cameras[0];
-
-//							std::cout << "Before PyList_New " << captureMsg->num_cameras << "\n";
-							PyObject *camList = PyList_New(captureMsg->num_cameras);
-//							std::cout << "After PyList_New " << camList << "\n";
-
-							uint32 offsetToNext = 0;
-							uint32 curInd = 0;
-							do
-							{
-//								std::cout << "Camera built Before " << captureMsg->num_cameras << "\n";
-
-								PyCaptureCameraObject *pyCam = buildCamera(*ddCam);
-
-//								std::cout << "Camera built After " << captureMsg->num_cameras << "\n";
-
-								PyList_SetItem(camList, curInd++, reinterpret_cast<PyObject*> (pyCam));
-
-								offsetToNext = ddCam->offset_to_next_camera;
-								ddCam = reinterpret_cast<const DeepDriveCaptureCamera*> (reinterpret_cast<const uint8*> (ddCam) + offsetToNext);
-							} while (offsetToNext);
-
-							msg->cameras = reinterpret_cast<PyListObject*> (camList);
-						}
-						else
-						{
-							// Retaining old cameras causes segfault
-							msg->cameras = 0;
-//							std::cout << "No cameras\n";
-						}
-
-					}
-
+					msg = buildSnapshot(*captureMsg, m_maxSize);
 				}
 				else
 				{
@@ -152,8 +133,105 @@ void DeepDriveSharedMemoryClient::close()
 }
 
 
-PyCaptureCameraObject* DeepDriveSharedMemoryClient::buildCamera(const DeepDriveCaptureCamera &srcCam)
+PyCaptureSnapshotObject* DeepDriveSharedMemoryClient::buildSnapshot(const DeepDriveCaptureMessage &captureMsg, uint64 size, PyObject *dataOwner)
 {
+	if(size < sizeof(DeepDriveCaptureMessage))
+		return 0;
+
+	PyCaptureSnapshotObject *msg = reinterpret_cast<PyCaptureSnapshotObject*> (PyCaptureSnapshotType.tp_new(&PyCaptureSnapshotType, 0, 0));
+
+	if(msg)
+	{
+//		std::cout << "PyCaptureSnapshotObject created\n";
+
+		msg->capture_timestamp = captureMsg.creation_timestamp;
+		msg->sequence_number = captureMsg.sequence_number;
+		msg->speed = captureMsg.speed;
+		msg->is_game_driving = captureMsg.is_game_driving;
+		msg->is_resetting = captureMsg.is_resetting;
+		msg->camera_count = captureMsg.num_cameras;
+		msg->distance_along_route = captureMsg.distance_along_route;
+		msg->distance_to_center_of_lane = captureMsg.distance_to_center_of_lane;
+		msg->lap_number = captureMsg.lap_number;
+
+		msg->steering = captureMsg.steering;
+		msg->throttle = captureMsg.throttle;
+		msg->brake = captureMsg.brake;
+		msg->handbrake = captureMsg.handbrake;
+
+		NumPyUtils::copyVector3(captureMsg.position, msg->position);
+		NumPyUtils::copyVector3(captureMsg.rotation, msg->rotation);
+		NumPyUtils::copyVector3(captureMsg.velocity, msg->velocity);
+		NumPyUtils::copyVector3(captureMsg.acceleration, msg->acceleration);
+		NumPyUtils::copyVector3(captureMsg.dimension, msg->dimension);
+		NumPyUtils::copyVector3(captureMsg.angular_velocity, msg->angular_velocity);
+		NumPyUtils::copyVector3(captureMsg.angular_acceleration, msg->angular_acceleration);
+		NumPyUtils::copyVector3(captureMsg.forward_vector, msg->forward_vector);
+		NumPyUtils::copyVector3(captureMsg.forward_vector, msg->forward_vector);
+		NumPyUtils::copyVector3(captureMsg.up_vector, msg->up_vector);
+		NumPyUtils::copyVector3(captureMsg.right_vector, msg->right_vector);
+
+//		std::cout << "Vector stuff done captureMsg num_cameras" << captureMsg.num_cameras << " cameras obj " << captureMsg.cameras << "\n";
+
+		if (captureMsg.num_cameras)
+		{
+//			std::cout << "Before camera read\n";
+
+//			std::cout << "Before PyList_New " << captureMsg.num_cameras << "\n";
+			PyObject *camList = PyList_New(captureMsg.num_cameras);
+//			std::cout << "After PyList_New " << camList << "\n";
+
+			// walk the camera chain, every camera has to follow its predecessor and lie within size together with its data
+			uint64 camOffset = offsetof(DeepDriveCaptureMessage, cameras);
+			uint32 curInd = 0;
+			bool isValid = camList != 0;
+			while(isValid && curInd < captureMsg.num_cameras)
+			{
+				const DeepDriveCaptureCamera *ddCam = reinterpret_cast<const DeepDriveCaptureCamera*> (reinterpret_cast<const uint8*> (&captureMsg) + camOffset);
+				PyCaptureCameraObject *pyCam = isInBounds(camOffset, offsetof(DeepDriveCaptureCamera, data), size) ? buildCamera(*ddCam, size - camOffset, dataOwner) : 0;
+				if(pyCam == 0)
+				{
+					isValid = false;
+					break;
+				}
+
+				PyList_SetItem(camList, curInd++, reinterpret_cast<PyObject*> (pyCam));
+
+				const uint32 offsetToNext = ddCam->offset_to_next_camera;
+				if(offsetToNext == 0)
+					break;
+				if(offsetToNext < offsetof(DeepDriveCaptureCamera, data) || curInd == captureMsg.num_cameras)
+					isValid = false;
+				camOffset += offsetToNext;
+			}
+
+			if(!isValid || curInd != captureMsg.num_cameras)
+			{
+				std::cout << "Invalid capture message " << captureMsg.sequence_number << ", camera " << curInd << " of " << captureMsg.num_cameras << " exceeds the message\n";
+				Py_XDECREF(camList);
+				Py_DECREF(msg);
+				return 0;
+			}
+
+			msg->cameras = reinterpret_cast<PyListObject*> (camList);
+		}
+		else
+		{
+			// Retaining old cameras causes segfault
+			msg->cameras = 0;
+//			std::cout << "No cameras\n";
+		}
+
+	}
+
+	return msg;
+}
+
+PyCaptureCameraObject* DeepDriveSharedMemoryClient::buildCamera(const DeepDriveCaptureCamera &srcCam, uint64 size, PyObject *dataOwner)
+{
+	if(srcCam.capture_width < 0 || srcCam.capture_height < 0)
+		return 0;
+
 	PyCaptureCameraObject *dstCam = reinterpret_cast<PyCaptureCameraObject*> (PyCaptureCameraType.tp_new(&PyCaptureCameraType, 0, 0));
 
 	if(dstCam)
@@ -166,11 +244,122 @@ PyCaptureCameraObject* DeepDriveSharedMemoryClient::buildCamera(const DeepDriveC
 		dstCam->capture_width = srcCam.capture_width;
 		dstCam->capture_height = srcCam.capture_height;
 
-		npy_intp dims[1] = {srcCam.capture_width * srcCam.capture_height * 3};
-		dstCam->image_data = reinterpret_cast<PyArrayObject*> (PyArray_SimpleNewFromData(1, dims, NPY_FLOAT16, const_cast<uint8*> (srcCam.data)));
+		dstCam->region_offset_x = srcCam.region_offset_x;
+		dstCam->region_offset_y = srcCam.region_offset_y;
+		dstCam->downscale_factor = srcCam.downscale_factor > 0 ? srcCam.downscale_factor : 1;
+
+		// data may live outside of the camera structure when published without copying
+		uint8 *data = srcCam.data_offset ? const_cast<uint8*> (reinterpret_cast<const uint8*> (&srcCam)) + srcCam.data_offset : const_cast<uint8*> (srcCam.data);
+
+		// servers not recording formats only write the default layouts, which follow from bytes_per_pixel
+		DeepDriveCaptureColorFormat colorFormat = static_cast<DeepDriveCaptureColorFormat> (srcCam.color_format);
+		DeepDriveCaptureDepthFormat depthFormat = static_cast<DeepDriveCaptureDepthFormat> (srcCam.depth_format);
+		if(colorFormat == DeepDriveCaptureColorFormat::Undefined)
+		{
+			switch(srcCam.bytes_per_pixel)
+			{
+				case 8:		// raw half float RGBA
+					colorFormat = DeepDriveCaptureColorFormat::RawRGBAHalf;
+					depthFormat = DeepDriveCaptureDepthFormat::RawHalf;
+					break;
+
+				case 6:		// half float RGB
+					colorFormat = DeepDriveCaptureColorFormat::RGBHalf;
+					depthFormat = DeepDriveCaptureDepthFormat::Half;
+					break;
+
+				case 3:		// packed captures, 8 bit RGB and depth in cm
+					colorFormat = DeepDriveCaptureColorFormat::RGB8;
+					depthFormat = DeepDriveCaptureDepthFormat::UInt16Centimeters;
+					break;
+
+				default:	// unknown layout, don't guess its size
+					colorFormat = DeepDriveCaptureColorFormat::None;
+					depthFormat = DeepDriveCaptureDepthFormat::None;
+					break;
+			}
+		}
+		dstCam->color_format = static_cast<uint32> (colorFormat);
+		dstCam->depth_format = static_cast<uint32> (depthFormat);
+
+		const uint64 dataOffset = srcCam.data_offset ? srcCam.data_offset : offsetof(DeepDriveCaptureCamera, data);
+		const uint64 numPixels = static_cast<uint64> (srcCam.capture_width) * static_cast<uint64> (srcCam.capture_height);
+
+		if(colorFormat == DeepDriveCaptureColorFormat::RawRGBAHalf)
+		{
+			const uint64 rowSize = static_cast<uint64> (srcCam.capture_width) * srcCam.bytes_per_pixel;
+			if	(	srcCam.bytes_per_pixel < 4 * sizeof(uint16)
+				||	srcCam.depth_offset > srcCam.bytes_per_pixel - sizeof(uint16)
+				||	(numPixels > 0 && !isInBounds(dataOffset, static_cast<uint64> (srcCam.capture_height - 1) * srcCam.row_stride + rowSize, size))
+				)
+			{
+				Py_DECREF(dstCam);
+				return 0;
+			}
 
-		dims[0] = {srcCam.capture_width * srcCam.capture_height};
-		dstCam->depth_data = reinterpret_cast<PyArrayObject*> (PyArray_SimpleNewFromData(1, dims, NPY_FLOAT16, const_cast<uint8*> (srcCam.data) + srcCam.depth_offset));
+			// raw half float RGBA rows with depth in alpha, color is exposed as strided view
+			npy_intp imageDims[3] = {srcCam.capture_height, srcCam.capture_width, 3};
+			npy_intp imageStrides[3] = {srcCam.row_stride, srcCam.bytes_per_pixel, 2};
+			dstCam->image_data = setDataOwner(reinterpret_cast<PyArrayObject*> (PyArray_New(&PyArray_Type, 3, imageDims, NPY_FLOAT16, imageStrides, data, 0, NPY_ARRAY_ALIGNED, 0)), dataOwner);
+
+			// depth is normalized into an array of its own, so it has the same values as depth published in the Half format
+			npy_intp depthDims[2] = {srcCam.capture_height, srcCam.capture_width};
+			npy_intp depthStrides[2] = {srcCam.row_stride, srcCam.bytes_per_pixel};
+			PyArrayObject *rawDepth = reinterpret_cast<PyArrayObject*> (PyArray_New(&PyArray_Type, 2, depthDims, NPY_FLOAT16, depthStrides, data + srcCam.depth_offset, 0, NPY_ARRAY_ALIGNED, 0));
+			dstCam->depth_data = normalizeRawDepth(rawDepth);
+			Py_XDECREF(rawDepth);
+		}
+		else
+		{
+			int colorType = NPY_FLOAT16;
+			npy_intp numChannels = 3;
+			switch(colorFormat)
+			{
+				case DeepDriveCaptureColorFormat::RGB8:		colorType = NPY_UINT8;		break;
+				case DeepDriveCaptureColorFormat::RGBFloat:	colorType = NPY_FLOAT32;	break;
+				case DeepDriveCaptureColorFormat::Gray8:	colorType = NPY_UINT8;	numChannels = 1;	break;
+				case DeepDriveCaptureColorFormat::None:		numChannels = 0;			break;
+				default:															break;
+			}
+
+			int depthType = NPY_FLOAT16;
+			switch(depthFormat)
+			{
+				case DeepDriveCaptureDepthFormat::Float:				depthType = NPY_FLOAT32;	break;
+				case DeepDriveCaptureDepthFormat::UInt16Centimeters:	depthType = NPY_UINT16;		break;
+				case DeepDriveCaptureDepthFormat::UInt16Millimeters:	depthType = NPY_UINT16;		break;
+				case DeepDriveCaptureDepthFormat::None:					depthType = NPY_NOTYPE;		break;
+				default:																			break;
+			}
+
+			const uint64 colorValueSize = colorType == NPY_UINT8 ? 1 : (colorType == NPY_FLOAT32 ? 4 : 2);
+			const uint64 depthValueSize = depthType == NPY_FLOAT32 ? 4 : 2;
+			if	(	!isInBounds(dataOffset, numPixels * numChannels * colorValueSize, size)
+				||	(depthType != NPY_NOTYPE && !isInBounds(dataOffset + srcCam.depth_offset, numPixels * depthValueSize, size))
+				)
+			{
+				Py_DECREF(dstCam);
+				return 0;
+			}
+
+			npy_intp dims[1] = {static_cast<npy_intp> (numPixels * numChannels)};
+			if(numChannels > 0)
+				dstCam->image_data = setDataOwner(reinterpret_cast<PyArrayObject*> (PyArray_SimpleNewFromData(1, dims, colorType, data)), dataOwner);
+			else
+			{
+				Py_INCREF(Py_None);
+				dstCam->image_data = reinterpret_cast<PyArrayObject*> (Py_None);
+			}
+
+			dims[0] = static_cast<npy_intp> (numPixels);
+			if(depthType != NPY_NOTYPE)
+				dstCam->depth_data = setDataOwner(reinterpret_cast<PyArrayObject*> (PyArray_SimpleNewFromData(1, dims, depthType, data + srcCam.depth_offset)), dataOwner);
+			else
+			{
+				Py_INCREF(Py_None);
+				dstCam->depth_data = reinterpret_cast<PyArrayObject*> (Py_None);
+			}
+		}
 	}
 
 
@@ -1,6 +1,8 @@
 
 #pragma once
 
+#include "Python.h"
+
 #include "Engine.h"
 
 class SharedMemory;
@@ -25,9 +27,19 @@ public:
 
 	bool isConnected() const;
 
+	/**
+		Snapshot referencing the camera data of captureMsg without copying it, so captureMsg has to outlive it.
+		size is the number of bytes readable from captureMsg on, cameras and their data have to lie within them, otherwise 0 is returned.
+		If given, dataOwner becomes the base object of every array referencing captureMsg, keeping its memory alive.
+	*/
+	static PyCaptureSnapshotObject* buildSnapshot(const DeepDriveCaptureMessage &captureMsg, uint64 size, PyObject *dataOwner = 0);
+
 private:
 
-	PyCaptureCameraObject* buildCamera(const DeepDriveCaptureCamera &srcCam);
+	/**
+		Camera of size readable bytes, 0 if its data exceeds them
+	*/
+	static PyCaptureCameraObject* buildCamera(const DeepDriveCaptureCamera &srcCam, uint64 size, PyObject *dataOwner);
 
 	void dumpSharedMemContent(const DeepDriveCaptureMessage *data);
 
@@ -40,6 +40,13 @@ struct PyCaptureCameraObject
 	uint32				capture_width;
 	uint32				capture_height;
 
+	int32				region_offset_x;
+	int32				region_offset_y;
+	uint32				downscale_factor;
+
+	uint32				color_format;
+	uint32				depth_format;
+
 	PyArrayObject		*image_data;
 	PyArrayObject		*depth_data;
 
@@ -53,8 +60,13 @@ static PyMemberDef PyCaptureCameraMembers[] =
 ,	{"aspect_ratio", T_DOUBLE, offsetof(PyCaptureCameraObject, aspect_ratio), 0, "Aspect ratio"}
 ,	{"capture_width", T_UINT, offsetof(PyCaptureCameraObject, capture_width), 0, "Capture width"}
 ,	{"capture_height", T_UINT, offsetof(PyCaptureCameraObject, capture_height), 0, "Capture height"}
-,	{"image_data", T_OBJECT_EX, offsetof(PyCaptureCameraObject, image_data), 0, "Image data"}
-,	{"depth_data", T_OBJECT_EX, offsetof(PyCaptureCameraObject, depth_data), 0, "Depth data"}
+,	{"region_offset_x", T_INT, offsetof(PyCaptureCameraObject, region_offset_x), 0, "Horizontal position of captured region within the camera's render target"}
+,	{"region_offset_y", T_INT, offsetof(PyCaptureCameraObject, region_offset_y), 0, "Vertical position of captured region within the camera's render target"}
+,	{"downscale_factor", T_UINT, offsetof(PyCaptureCameraObject, downscale_factor), 0, "Factor capture width and height have been divided by"}
+,	{"color_format", T_UINT, offsetof(PyCaptureCameraObject, color_format), 0, "Format of image data, see DeepDriveCaptureColorFormat"}
+,	{"depth_format", T_UINT, offsetof(PyCaptureCameraObject, depth_format), 0, "Format of depth data, see DeepDriveCaptureDepthFormat"}
+,	{"image_data", T_OBJECT_EX, offsetof(PyCaptureCameraObject, image_data), 0, "Image data, None if omitted"}
+,	{"depth_data", T_OBJECT_EX, offsetof(PyCaptureCameraObject, depth_data), 0, "Depth data, None if omitted"}
 ,	{NULL}
 };
 
@@ -1,6 +1,7 @@
 #include "Python.h"
 
 #include "DeepDriveSharedMemoryClient.h"
+#include "DeepDriveEpisodeReader.h"
 
 #include "PyCaptureCameraObject.h"
 #include "PyCaptureSnapshotObject.h"
@@ -11,6 +12,8 @@ static PyObject *DeepDriveError;
 
 static DeepDriveSharedMemoryClient *g_SharedMemClient = 0;
 
+static DeepDriveEpisodeReader *g_EpisodeReader = 0;
+
 /*	Reset connection to UE environmnent by trying to open a connection to shared memory
  *
  *	@param	string		Name of shared memory
@@ -79,9 +82,74 @@ static PyObject* deepdrive_close(PyObject *self, PyObject *args)
 	return Py_BuildValue("i", 1);
 }
 
+/*	Open an episode recording written by the disk capture sink, replacing the one opened before
+ *
+ *	@param	string		Path of the recording
+ *	@return	Number of frames, -1 if the recording couldn't be opened
+*/
+static PyObject* deepdrive_open_episode(PyObject *self, PyObject *args)
+{
+	int32 res = -1;
+
+	const char *fileName = 0;
+	if(PyArg_ParseTuple(args, "s", &fileName))
+	{
+		if(g_EpisodeReader == 0)
+			g_EpisodeReader = new DeepDriveEpisodeReader();
+
+		if(g_EpisodeReader->open(fileName))
+			res = static_cast<int32> (g_EpisodeReader->getNumFrames());
+	}
+
+	return Py_BuildValue("i", res);
+}
+
+/*	Read a frame of the open episode recording
+ *
+ *	@param	uint32		Frame index
+ *	@return	CaptureSnapshot referencing the recording's memory, which stays mapped as long as its arrays exist. None if index is out of range or the frame is invalid.
+*/
+static PyObject* deepdrive_read_episode_frame(PyObject *self, PyObject *args)
+{
+	PyObject *res = 0;
+
+	uint32 index = 0;
+	if	(	g_EpisodeReader
+		&&	PyArg_ParseTuple(args, "I", &index)
+		)
+	{
+		res = reinterpret_cast<PyObject*> (g_EpisodeReader->readFrame(index));
+	}
+
+	if(res == 0)
+	{
+		Py_INCREF(Py_None);
+		res = Py_None;
+	}
+	return res;
+}
+
+/*	Close the open episode recording
+ *
+ *
+*/
+static PyObject* deepdrive_close_episode(PyObject *self, PyObject *args)
+{
+	if(g_EpisodeReader)
+	{
+		delete g_EpisodeReader;
+		g_EpisodeReader = 0;
+	}
+
+	return Py_BuildValue("i", 1);
+}
+
 static PyMethodDef DeepDriveMethods[] =	{	{"reset", deepdrive_reset, METH_VARARGS, "Reset environmnent and tries to open a connection to shared memory"}
 										,	{"step", deepdrive_step, METH_VARARGS, "Query next step from UE environment"}
 										,	{"close", deepdrive_close, METH_VARARGS, "Close connection to UE environmnent"}
+										,	{"open_episode", deepdrive_open_episode, METH_VARARGS, "Open an episode recording, returns its number of frames"}
+										,	{"read_episode_frame", deepdrive_read_episode_frame, METH_VARARGS, "Read a frame of the open episode recording"}
+										,	{"close_episode", deepdrive_close_episode, METH_VARARGS, "Close the open episode recording"}
 										,	{NULL,     NULL,             0,            NULL}        /* Sentinel */
 										};
 
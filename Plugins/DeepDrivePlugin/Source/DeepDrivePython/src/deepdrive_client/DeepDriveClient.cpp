@@ -20,11 +20,11 @@ DeepDriveClient::~DeepDriveClient()
 
 }
 
-int32 DeepDriveClient::registerClient(deepdrive::server::RegisterClientResponse &response)
+int32 DeepDriveClient::registerClient(deepdrive::server::RegisterClientResponse &response, uint32 captureProxyIndex)
 {
 	uint32 clientId = 0;
 
-	deepdrive::server::RegisterClientRequest req(true);
+	deepdrive::server::RegisterClientRequest req(true, captureProxyIndex);
 	int32 res = m_Socket.send(&req, sizeof(req));
 
 	if(res >= 0)
@@ -173,3 +173,50 @@ int32 DeepDriveClient::setControlValues(float steering, float throttle, float br
 	}
 	return res;
 }
+
+int32 DeepDriveClient::setLockstepMode(bool enabled, float fixedDeltaTime)
+{
+	int32 res = ClientErrorCode::NOT_CONNECTED;
+
+	deepdrive::server::SetLockstepModeRequest req(m_ClientId, enabled, fixedDeltaTime);
+	res = m_Socket.send(&req, sizeof(req));
+	if(res >= 0)
+	{
+		deepdrive::server::SetLockstepModeResponse response;
+		if(m_Socket.receive(&response, sizeof(response), 1000))
+			res = response.enabled ? 1 : 0;
+		else
+		{
+			std::cout << "Waiting for SetLockstepModeResponse, time out\n";
+			res = ClientErrorCode::TIME_OUT;
+		}
+	}
+
+	return res;
+}
+
+int32 DeepDriveClient::advanceSimulation(float steering, float throttle, float brake, uint32 handbrake, uint32 numSteps, uint32 &sequenceNumber)
+{
+	int32 res = ClientErrorCode::NOT_CONNECTED;
+	sequenceNumber = 0;
+
+	deepdrive::server::AdvanceSimulationRequest req(m_ClientId, steering, throttle, brake, handbrake, numSteps);
+	res = m_Socket.send(&req, sizeof(req));
+	if(res >= 0)
+	{
+		// the response is sent once the capture after the last step has been published
+		deepdrive::server::AdvanceSimulationResponse response;
+		if(m_Socket.receive(&response, sizeof(response), 10000))
+		{
+			res = response.advanced ? 1 : 0;
+			sequenceNumber = response.sequence_number;
+		}
+		else
+		{
+			std::cout << "Waiting for AdvanceSimulationResponse, time out\n";
+			res = ClientErrorCode::TIME_OUT;
+		}
+	}
+
+	return res;
+}
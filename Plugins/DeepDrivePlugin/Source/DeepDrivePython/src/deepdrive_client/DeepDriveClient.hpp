@@ -18,7 +18,10 @@ public:
 
 	~DeepDriveClient();
 
-	int32 registerClient(deepdrive::server::RegisterClientResponse &response);
+	/**
+		Register with the server, captureProxyIndex selects the agent whose shared memory the client reads
+	*/
+	int32 registerClient(deepdrive::server::RegisterClientResponse &response, uint32 captureProxyIndex = 0);
 
 	void close();
 
@@ -35,6 +38,17 @@ public:
 
 	int32 setControlValues(float steering, float throttle, float brake, uint32 handbrake);
 
+	/**
+		Returns 1 if lockstep mode is enabled afterwards, 0 if not
+	*/
+	int32 setLockstepMode(bool enabled, float fixedDeltaTime);
+
+	/**
+		Advance simulation by numSteps fixed steps in lockstep mode. Returns 1 if advanced, sequenceNumber then is the sequence number
+		of the capture published afterwards.
+	*/
+	int32 advanceSimulation(float steering, float throttle, float brake, uint32 handbrake, uint32 numSteps, uint32 &sequenceNumber);
+
 	uint32							m_ClientId = 0;
 	bool							m_isMaster = false;
 
@@ -54,7 +54,8 @@ static PyObject* handleError(int32 errorCode)
 /*	Create a new client, tries to connect to specified DeepDriveServer
  *
  *	@param	address		IP4 address of server
- *	@param	uint32		Request master role
+ *	@param	uint32		Port of server
+ *	@param	uint32		Index of the capture proxy, i.e. agent, whose shared memory is read, in the order proxies were created
  *
  *	@return	Client id, 0 in case of error
 */
@@ -67,7 +68,8 @@ static PyObject* deepdrive_client_create(PyObject *self, PyObject *args)
 
 	const char *ipStr;
 	uint32 port = 19768;
-	int32 ok = PyArg_ParseTuple(args, "s|i", &ipStr, &port);
+	uint32 captureProxyIndex = 0;
+	int32 ok = PyArg_ParseTuple(args, "s|iI", &ipStr, &port, &captureProxyIndex);
 
 	if(ok && port > 0 && port < 65536)
 	{
@@ -84,7 +86,7 @@ static PyObject* deepdrive_client_create(PyObject *self, PyObject *args)
 			{
 				std::cout << "Successfully connected to " << ip4Address.toStr(true) << "\n";
 				deepdrive::server::RegisterClientResponse registerClientResponse;
-				const int32 res = client->registerClient(registerClientResponse);
+				const int32 res = client->registerClient(registerClientResponse, captureProxyIndex);
 				if(res >= 0)
 				{
 					clientId = registerClientResponse.client_id;
@@ -362,6 +364,90 @@ static PyObject* deepdrive_client_set_control_values(PyObject *self, PyObject *a
 	return Py_BuildValue("");
 }
 
+/*	Switch lockstep mode, the simulation then only advances by advance_simulation
+ *
+ *	@param	uint32		Client Id
+ *	@param	bool		Enable lockstep mode
+ *	@param	number		Fixed delta time of a step in seconds
+ *
+ *	@return	True, if lockstep mode is enabled afterwards, otherwise false
+*/
+static PyObject* deepdrive_client_set_lockstep_mode(PyObject *self, PyObject *args, PyObject *keyWords)
+{
+	uint32 clientId = 0;
+	int32 enabled = 1;
+	float fixedDeltaTime = 0.05f;
+
+	char *keyWordList[] = {"client_id", "enabled", "fixed_delta_time", NULL};
+	int32 ok = PyArg_ParseTupleAndKeywords(args, keyWords, "I|pf", keyWordList, &clientId, &enabled, &fixedDeltaTime);
+
+	int32 res = 0;
+	if(ok)
+	{
+		DeepDriveClient *client = getClient(clientId);
+		if(client)
+		{
+			res = client->setLockstepMode(enabled != 0, fixedDeltaTime);
+			if(res < 0)
+				return handleError(res);
+		}
+		else
+		{
+			PyErr_SetString(ClientDoesntExistError, "Client doesn't exist");
+			return 0;
+		}
+	}
+	else
+		std::cout << "Wrong arguments\n";
+
+	return PyBool_FromLong(res > 0);
+}
+
+/*	Apply control values and advance simulation in lockstep mode, returns once the capture after the last step has been published
+ *
+ *	@param	uint32		Client Id
+ *	@param	number		Steering
+ *	@param	number		Throttle
+ *	@param	number		Brake
+ *	@param	uint32		Handbrake
+ *	@param	uint32		Number of fixed steps
+ *
+ *	@return	uint32		Sequence number of the published capture, 0 if simulation wasn't advanced or nothing was captured
+*/
+static PyObject* deepdrive_client_advance_simulation(PyObject *self, PyObject *args, PyObject *keyWords)
+{
+	uint32 clientId = 0;
+	float steering = 0.0f;
+	float throttle = 0.0f;
+	float brake = 0.0f;
+	uint32 handbrake = 0;
+	uint32 numSteps = 1;
+
+	char *keyWordList[] = {"client_id", "steering", "throttle", "brake", "handbrake", "num_steps", NULL};
+	int32 ok = PyArg_ParseTupleAndKeywords(args, keyWords, "I|fffII", keyWordList, &clientId, &steering, &throttle, &brake, &handbrake, &numSteps);
+
+	uint32 sequenceNumber = 0;
+	if(ok)
+	{
+		DeepDriveClient *client = getClient(clientId);
+		if(client)
+		{
+			const int32 res = client->advanceSimulation(steering, throttle, brake, handbrake, numSteps, sequenceNumber);
+			if(res < 0)
+				return handleError(res);
+		}
+		else
+		{
+			PyErr_SetString(ClientDoesntExistError, "Client doesn't exist");
+			return 0;
+		}
+	}
+	else
+		std::cout << "Wrong arguments\n";
+
+	return PyLong_FromUnsignedLong(sequenceNumber);
+}
+
 /*	Send control values to server
  *
  *	@param	uint32		Client Id
@@ -398,6 +484,8 @@ static PyMethodDef DeepDriveClientMethods[] =	{	{"create", deepdrive_client_crea
 												,	{"release_agent_control", deepdrive_client_release_agent_control, METH_VARARGS, "Release control over agent"}
 												,	{"reset_agent", deepdrive_client_reset_agent, METH_VARARGS, "Reset the agent"}
 												,	{"set_control_values", (PyCFunction) deepdrive_client_set_control_values, METH_VARARGS | METH_KEYWORDS, "Send control value set to server"}
+												,	{"set_lockstep_mode", (PyCFunction) deepdrive_client_set_lockstep_mode, METH_VARARGS | METH_KEYWORDS, "Switch lockstep mode, the simulation then only advances on request"}
+												,	{"advance_simulation", (PyCFunction) deepdrive_client_advance_simulation, METH_VARARGS | METH_KEYWORDS, "Apply control values and advance simulation in lockstep mode"}
 												,	{NULL,     NULL,             0,            NULL}        /* Sentinel */
 												};
 